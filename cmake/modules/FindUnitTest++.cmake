@@ -0,0 +1,25 @@
+# - Try to find the UnitTest++ library
+# Once done this will define
+#
+#  UNITTEST++_FOUND - system has UnitTest++
+#  UNITTEST++_INCLUDE_DIR - the UnitTest++ include directory
+#  UNITTEST++_LIBRARY - the UnitTest++ library
+
+# Redistribution and use is allowed according to the terms of the BSD license.
+# For details see the accompanying COPYING-CMAKE-SCRIPTS file.
+
+if(UNITTEST++_INCLUDE_DIR AND UNITTEST++_LIBRARY)
+	set(UNITTEST++_FOUND true)
+else()
+	find_path(UNITTEST++_INCLUDE_DIR UnitTest++.h PATH_SUFFIXES UnitTest++ unittest++)
+	find_library(UNITTEST++_LIBRARY NAMES UnitTest++ unittest++)
+
+	if(UNITTEST++_INCLUDE_DIR AND UNITTEST++_LIBRARY)
+		set(UNITTEST++_FOUND true)
+		message(STATUS "Found library UnitTest++: ${UNITTEST++_LIBRARY}")
+	else()
+		set(UNITTEST++_FOUND false)
+	endif()
+
+	mark_as_advanced(UNITTEST++_INCLUDE_DIR UNITTEST++_LIBRARY)
+endif()
@@ -513,6 +513,8 @@ void UnitActions()
 	if (isASecondCycle) {
 		UnitActionsEachSecond(table.begin(), table.end());
 	}
+	// Search the paths needed in this cycle at once
+	PathfinderBatchRequests(table);
 	// Do all actions
 	UnitActionsEachCycle(table.begin(), table.end());
 }
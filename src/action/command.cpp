@@ -899,14 +899,14 @@ void CommandSharedVision(int player, bool state, int opponent)
 			CMapField &mf = *Map.Field(i);
 			CMapFieldPlayerInfo &mfp = mf.playerInfo;
 
-			if (mfp.Visible[player] && !mfp.Visible[opponent]) {
-				mfp.Visible[opponent] = 1;
+			if (mfp.Visible(player) && !mfp.Visible(opponent)) {
+				mfp.Visible(opponent) = 1;
 				if (opponent == ThisPlayer->Index) {
 					Map.MarkSeenTile(mf);
 				}
 			}
-			if (mfp.Visible[opponent] && !mfp.Visible[player]) {
-				mfp.Visible[player] = 1;
+			if (mfp.Visible(opponent) && !mfp.Visible(player)) {
+				mfp.Visible(player) = 1;
 				if (player == ThisPlayer->Index) {
 					Map.MarkSeenTile(mf);
 				}
@@ -921,6 +921,7 @@ void CommandSharedVision(int player, bool state, int opponent)
 			MapMarkUnitSight(unit);
 		}
 	}
+	InvalidateFogOfWar();
 }
 
 /**
@@ -51,6 +51,7 @@
 #include "interface.h"
 #include "iocompat.h"
 #include "iolib.h"
+#include "luacallback.h"
 #include "map.h"
 #include "minimap.h"
 #include "missile.h"
@@ -59,6 +60,7 @@
 #include "parameters.h"
 #include "pathfinder.h"
 #include "player.h"
+#include "profiler.h"
 #include "replay.h"
 #include "results.h"
 #include "settings.h"
@@ -1432,6 +1434,32 @@ static int CclSetMenuRace(lua_State *l)
 	return 0;
 }
 
+/**
+**  Save the game in the background.
+**
+**  @param l  Lua state.
+**
+**  The optional function is called with the file name and 0 on success,
+**  -1 on failure, once the save game is written.
+*/
+static int CclSaveGameAsync(lua_State *l)
+{
+	const int args = lua_gettop(l);
+	if (args != 1 && args != 2) {
+		LuaError(l, "incorrect argument");
+	}
+	const std::string filename = LuaToString(l, 1);
+	LuaCallback *callback = NULL;
+	if (args == 2) {
+		if (!lua_isfunction(l, 2)) {
+			LuaError(l, "incorrect argument");
+		}
+		callback = new LuaCallback(l, 2);
+	}
+	lua_pushnumber(l, SaveGameAsync(filename, callback));
+	return 1;
+}
+
 /**
 **  Load the SavedGameInfo Header
 **
@@ -1502,6 +1530,7 @@ void LuaRegisterModules()
 	lua_register(Lua, "GetStratagusHomepage", CclGetStratagusHomepage);
 
 	lua_register(Lua, "SavedGameInfo", CclSavedGameInfo);
+	lua_register(Lua, "SaveGameAsync", CclSaveGameAsync);
 
 	AiCclRegister();
 	AnimationCclRegister();
@@ -1515,6 +1544,7 @@ void LuaRegisterModules()
 	NetworkCclRegister();
 	PathfinderCclRegister();
 	PlayerCclRegister();
+	ProfilerCclRegister();
 	ReplayCclRegister();
 	ScriptRegister();
 	SelectionCclRegister();
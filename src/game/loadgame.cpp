@@ -41,6 +41,7 @@
 #include "construct.h"
 #include "depend.h"
 #include "font.h"
+#include "game.h"
 #include "map.h"
 #include "minimap.h"
 #include "missile.h"
@@ -103,6 +104,7 @@ void CleanModules()
 	Map.CleanFogOfWar();
 	CParticleManager::exit();
 	CleanReplayLog();
+	FreeLastReplay();
 	CleanSpells();
 	FreePathfinder();
 
@@ -189,11 +191,9 @@ static void PlaceUnits()
 }
 
 /**
-**  Load a game to file.
-**
-**  @param filename  File name to be loaded.
+**  Prepare the modules to run a save game.
 */
-void LoadGame(const std::string &filename)
+static void LoadGameBegin()
 {
 	// log will be enabled if found in the save game
 	CommandLogDisabled = true;
@@ -204,7 +204,13 @@ void LoadGame(const std::string &filename)
 
 	LuaGarbageCollect();
 	InitUnitTypes(1);
-	LuaLoadFile(filename);
+}
+
+/**
+**  Initialize the modules once the save game has run.
+*/
+static void LoadGameEnd()
+{
 	LuaGarbageCollect();
 
 	PlaceUnits();
@@ -222,4 +228,31 @@ void LoadGame(const std::string &filename)
 	SelectionChanged();
 }
 
+/**
+**  Load a game to file.
+**
+**  @param filename  File name to be loaded.
+*/
+void LoadGame(const std::string &filename)
+{
+	LoadGameBegin();
+	const unsigned long ticks = GetTicks();
+	LoadSaveGameFile(filename);
+	DebugPrint("Loaded '%s' in %lu ms\n" _C_ filename.c_str() _C_ GetTicks() - ticks);
+	LoadGameEnd();
+}
+
+/**
+**  Load a game already in memory.
+**
+**  @param content   The save game, uncompressed.
+**  @param name      Name of the save game, for the messages.
+*/
+void LoadGameFromContent(const std::string &content, const std::string &name)
+{
+	LoadGameBegin();
+	LoadSaveGameContent(content, name);
+	LoadGameEnd();
+}
+
 //@}
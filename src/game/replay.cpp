@@ -46,7 +46,9 @@
 #include "netconnect.h"
 #include "network.h"
 #include "parameters.h"
+#include "pathfinder.h"
 #include "player.h"
+#include "results.h"
 #include "script.h"
 #include "settings.h"
 #include "sound.h"
@@ -55,10 +57,16 @@
 #include "unit_manager.h"
 #include "unittype.h"
 #include "version.h"
+#include "video.h"
 
+#include <map>
 #include <sstream>
 #include <time.h>
 
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
 extern void ExpandPath(std::string &newpath, const std::string &path);
 extern void StartMap(const std::string &filename, bool clean);
 
@@ -92,6 +100,19 @@ public:
 	LogEntry *Next;
 };
 
+/**
+**  Saved game at a cycle of a replay, to seek in it.
+*/
+class ReplayKeyframe
+{
+public:
+	ReplayKeyframe() : Cycle(0), Size(0) {}
+
+	unsigned long Cycle; /// Game cycle of the save game
+	unsigned long Size;  /// Size of the save game, 0 if Data isn't compressed
+	std::string Data;    /// The save game (see SaveGameContent)
+};
+
 /**
 **  Multiplayer Player definition
 */
@@ -117,7 +138,7 @@ public:
 	FullReplay() :
 		MapId(0), Type(0), Race(0), LocalPlayer(0),
 		Resource(0), NumUnits(0), Difficulty(0), NoFow(false), Inside(false), RevealMap(0),
-		MapRichness(0), GameType(0), Opponents(0), Commands(NULL)
+		MapRichness(0), GameType(0), Opponents(0), BatchSearch(false), Commands(NULL), LastCommand(NULL)
 	{
 		memset(Engine, 0, sizeof(Engine));
 		memset(Network, 0, sizeof(Network));
@@ -144,15 +165,27 @@ public:
 	int MapRichness;
 	int GameType;
 	int Opponents;
+	bool BatchSearch; /// The paths were searched in batches (see AStarBatchSearch)
 	int Engine[3];
 	int Network[3];
 	LogEntry *Commands;
+	LogEntry *LastCommand; /// Last of Commands, to append in constant time
+	std::vector<ReplayKeyframe> Keyframes; /// Save games, by cycle
 };
 
 //----------------------------------------------------------------------------
 // Constants
 //----------------------------------------------------------------------------
 
+/// Size of the commands kept before writing them to LogFile
+static const size_t LogBufferSize = 64 * 1024;
+/// Time in ms after which the kept commands are written to LogFile
+static const unsigned long LogBufferDelay = 1000;
+
+/// Start of the binary replays
+static const char ReplayMagic[8] = {'S', 't', 'r', 'R', 'p', 'l', 'y', '\n'};
+/// Version of the binary replays
+static const unsigned int ReplayVersion = 2;
 
 //----------------------------------------------------------------------------
 // Variables
@@ -162,11 +195,23 @@ bool CommandLogDisabled;           /// True if command log is off
 ReplayType ReplayGameType;         /// Replay game type
 static bool DisabledLog;           /// Disabled log for replay
 static CFile *LogFile;             /// Replay log file
+static std::string LogBuffer;      /// Commands not yet written to LogFile
+static unsigned long LogBufferTicks; /// Time LogBuffer was last written
 static unsigned long NextLogCycle; /// Next log cycle number
 static int InitReplay;             /// Initialize replay
 static FullReplay *CurrentReplay;
+static FullReplay *LastReplay;     /// Replay of the last game, for SaveReplay
 static LogEntry *ReplayStep;
 
+/// Cycles between two keyframes of the replay, 0 for none (the default)
+static unsigned long ReplayKeyframeInterval;
+/// Bytes the keyframes of a replay may use, the older are thinned out past it
+static size_t ReplayKeyframeMaxSize = 32 * 1024 * 1024;
+static bool SavingKeyframe;        /// A keyframe of the replay is being saved
+static FullReplay *SeekReplay;     /// Replay to restart by ReplaySeek
+static unsigned long SeekCycle;    /// Cycle to seek to
+static bool ReplayFromKeyframe;    /// The replay started from a keyframe
+
 //----------------------------------------------------------------------------
 // Log commands
 //----------------------------------------------------------------------------
@@ -220,6 +265,7 @@ static FullReplay *StartReplay()
 	replay->RevealMap = GameSettings.RevealMap;
 	replay->MapRichness = GameSettings.MapRichness;
 	replay->Opponents = GameSettings.Opponents;
+	replay->BatchSearch = AStarBatchSearch && !IsNetworkGame();
 
 	replay->Engine[0] = StratagusMajorVersion;
 	replay->Engine[1] = StratagusMinorVersion;
@@ -293,111 +339,178 @@ static void DeleteReplay(FullReplay *replay)
 	delete replay;
 }
 
-static void PrintLogCommand(const LogEntry &log, CFile &file)
+/**
+**  Append the lua code of a LogEntry to a string
+**
+**  @param log  The replay log entry
+**  @param out  The string to append to
+*/
+static void PrintLogCommand(const LogEntry &log, std::string &out)
 {
-	file.printf("Log( { ");
-	file.printf("GameCycle = %lu, ", log.GameCycle);
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "Log( { GameCycle = %lu, ", log.GameCycle);
+	out += buf;
 	if (log.UnitNumber != -1) {
-		file.printf("UnitNumber = %d, ", log.UnitNumber);
+		snprintf(buf, sizeof(buf), "UnitNumber = %d, ", log.UnitNumber);
+		out += buf;
 	}
 	if (!log.UnitIdent.empty()) {
-		file.printf("UnitIdent = \"%s\", ", log.UnitIdent.c_str());
+		out += "UnitIdent = \"";
+		out += log.UnitIdent;
+		out += "\", ";
 	}
-	file.printf("Action = \"%s\", ", log.Action.c_str());
-	file.printf("Flush = %d, ", log.Flush);
+	out += "Action = \"";
+	out += log.Action;
+	snprintf(buf, sizeof(buf), "\", Flush = %d, ", log.Flush);
+	out += buf;
 	if (log.PosX != -1 || log.PosY != -1) {
-		file.printf("PosX = %d, PosY = %d, ", log.PosX, log.PosY);
+		snprintf(buf, sizeof(buf), "PosX = %d, PosY = %d, ", log.PosX, log.PosY);
+		out += buf;
 	}
 	if (log.DestUnitNumber != -1) {
-		file.printf("DestUnitNumber = %d, ", log.DestUnitNumber);
+		snprintf(buf, sizeof(buf), "DestUnitNumber = %d, ", log.DestUnitNumber);
+		out += buf;
 	}
 	if (!log.Value.empty()) {
-		file.printf("Value = [[%s]], ", log.Value.c_str());
+		out += "Value = [[";
+		out += log.Value;
+		out += "]], ";
 	}
 	if (log.Num != -1) {
-		file.printf("Num = %d, ", log.Num);
+		snprintf(buf, sizeof(buf), "Num = %d, ", log.Num);
+		out += buf;
 	}
-	file.printf("SyncRandSeed = %d } )\n", (signed)log.SyncRandSeed);
+	snprintf(buf, sizeof(buf), "SyncRandSeed = %d } )\n", (signed)log.SyncRandSeed);
+	out += buf;
 }
 
 /**
-**  Output the FullReplay list to file
+**  Output the FullReplay definition to file
 **
-**  @param file  The file to output to
+**  @param replay  The replay to output
+**  @param file    The file to output to
 */
-static void SaveFullLog(CFile &file)
+static void SaveReplayHeader(const FullReplay &replay, CFile &file)
 {
 	file.printf("\n--- -----------------------------------------\n");
 	file.printf("--- MODULE: replay list\n");
 
 	file.printf("\n");
 	file.printf("ReplayLog( {\n");
-	file.printf("  Comment1 = \"%s\",\n", CurrentReplay->Comment1.c_str());
-	file.printf("  Comment2 = \"%s\",\n", CurrentReplay->Comment2.c_str());
-	file.printf("  Date = \"%s\",\n", CurrentReplay->Date.c_str());
-	file.printf("  Map = \"%s\",\n", CurrentReplay->Map.c_str());
-	file.printf("  MapPath = \"%s\",\n", CurrentReplay->MapPath.c_str());
-	file.printf("  MapId = %u,\n", CurrentReplay->MapId);
-	file.printf("  Type = %d,\n", CurrentReplay->Type);
-	file.printf("  Race = %d,\n", CurrentReplay->Race);
-	file.printf("  LocalPlayer = %d,\n", CurrentReplay->LocalPlayer);
+	file.printf("  Comment1 = \"%s\",\n", replay.Comment1.c_str());
+	file.printf("  Comment2 = \"%s\",\n", replay.Comment2.c_str());
+	file.printf("  Date = \"%s\",\n", replay.Date.c_str());
+	file.printf("  Map = \"%s\",\n", replay.Map.c_str());
+	file.printf("  MapPath = \"%s\",\n", replay.MapPath.c_str());
+	file.printf("  MapId = %u,\n", replay.MapId);
+	file.printf("  Type = %d,\n", replay.Type);
+	file.printf("  Race = %d,\n", replay.Race);
+	file.printf("  LocalPlayer = %d,\n", replay.LocalPlayer);
 	file.printf("  Players = {\n");
 	for (int i = 0; i < PlayerMax; ++i) {
-		if (!CurrentReplay->Players[i].Name.empty()) {
-			file.printf("\t{ Name = \"%s\",", CurrentReplay->Players[i].Name.c_str());
+		if (!replay.Players[i].Name.empty()) {
+			file.printf("\t{ Name = \"%s\",", replay.Players[i].Name.c_str());
 		} else {
 			file.printf("\t{");
 		}
-		file.printf(" AIScript = \"%s\",", CurrentReplay->Players[i].AIScript.c_str());
-		file.printf(" PlayerColor = %d,", CurrentReplay->Players[i].PlayerColor);
-		file.printf(" Race = %d,", CurrentReplay->Players[i].Race);
-		file.printf(" Team = %d,", CurrentReplay->Players[i].Team);
-		file.printf(" Type = %d }%s", CurrentReplay->Players[i].Type,
+		file.printf(" AIScript = \"%s\",", replay.Players[i].AIScript.c_str());
+		file.printf(" PlayerColor = %d,", replay.Players[i].PlayerColor);
+		file.printf(" Race = %d,", replay.Players[i].Race);
+		file.printf(" Team = %d,", replay.Players[i].Team);
+		file.printf(" Type = %d }%s", replay.Players[i].Type,
 					i != PlayerMax - 1 ? ",\n" : "\n");
 	}
 	file.printf("  },\n");
-	file.printf("  Resource = %d,\n", CurrentReplay->Resource);
-	file.printf("  NumUnits = %d,\n", CurrentReplay->NumUnits);
-	file.printf("  Difficulty = %d,\n", CurrentReplay->Difficulty);
-	file.printf("  NoFow = %s,\n", CurrentReplay->NoFow ? "true" : "false");
-	file.printf("  Inside = %s,\n", CurrentReplay->Inside ? "true" : "false");
-	file.printf("  RevealMap = %d,\n", CurrentReplay->RevealMap);
-	file.printf("  GameType = %d,\n", CurrentReplay->GameType);
-	file.printf("  Opponents = %d,\n", CurrentReplay->Opponents);
-	file.printf("  MapRichness = %d,\n", CurrentReplay->MapRichness);
+	file.printf("  Resource = %d,\n", replay.Resource);
+	file.printf("  NumUnits = %d,\n", replay.NumUnits);
+	file.printf("  Difficulty = %d,\n", replay.Difficulty);
+	file.printf("  NoFow = %s,\n", replay.NoFow ? "true" : "false");
+	file.printf("  Inside = %s,\n", replay.Inside ? "true" : "false");
+	file.printf("  RevealMap = %d,\n", replay.RevealMap);
+	file.printf("  GameType = %d,\n", replay.GameType);
+	file.printf("  Opponents = %d,\n", replay.Opponents);
+	file.printf("  MapRichness = %d,\n", replay.MapRichness);
+	file.printf("  BatchSearch = %s,\n", replay.BatchSearch ? "true" : "false");
 	file.printf("  Engine = { %d, %d, %d },\n",
-				CurrentReplay->Engine[0], CurrentReplay->Engine[1], CurrentReplay->Engine[2]);
+				replay.Engine[0], replay.Engine[1], replay.Engine[2]);
 	file.printf("  Network = { %d, %d, %d }\n",
-				CurrentReplay->Network[0], CurrentReplay->Network[1], CurrentReplay->Network[2]);
+				replay.Network[0], replay.Network[1], replay.Network[2]);
 	file.printf("} )\n");
-	const LogEntry *log = CurrentReplay->Commands;
-	while (log) {
-		PrintLogCommand(*log, file);
-		log = log->Next;
+}
+
+/**
+**  Output the FullReplay list to file
+**
+**  @param file  The file to output to
+*/
+static void SaveFullLog(CFile &file)
+{
+	SaveReplayHeader(*CurrentReplay, file);
+	if (SavingKeyframe) {
+		// The replay holds the commands of the keyframes
+		return;
+	}
+	std::string buf;
+	for (const LogEntry *log = CurrentReplay->Commands; log; log = log->Next) {
+		PrintLogCommand(*log, buf);
+		if (buf.size() >= LogBufferSize) {
+			file.write(buf.data(), buf.size());
+			buf.clear();
+		}
+	}
+	if (!buf.empty()) {
+		file.write(buf.data(), buf.size());
 	}
 }
 
 /**
-**  Append the LogEntry structure at the end of currentLog, and to LogFile
+**  Append the LogEntry structure at the end of the commands list
 **
-**  @param log   Pointer the replay log entry to be added
-**  @param dest  The file to output to
+**  @param replay  The replay to add to
+**  @param log     Pointer the replay log entry to be added
 */
-static void AppendLog(LogEntry *log, CFile &file)
+static void AddLogEntry(FullReplay &replay, LogEntry *log)
 {
-	LogEntry **last;
+	log->Next = NULL;
+	if (replay.LastCommand) {
+		replay.LastCommand->Next = log;
+	} else {
+		replay.Commands = log;
+	}
+	replay.LastCommand = log;
+}
 
-	// Append to linked list
-	last = &CurrentReplay->Commands;
-	while (*last) {
-		last = &(*last)->Next;
+/**
+**  Write the commands kept in LogBuffer to LogFile.
+**
+**  Called when the buffer is full or old enough, and when the log ends
+**  or the game exits, so a crash loses at most LogBufferDelay ms of
+**  commands.
+*/
+void FlushReplayLog()
+{
+	if (LogFile && !LogBuffer.empty()) {
+		LogFile->write(LogBuffer.data(), LogBuffer.size());
+		LogFile->flush();
 	}
+	LogBuffer.clear();
+	LogBufferTicks = GetTicks();
+}
 
-	*last = log;
-	log->Next = 0;
+/**
+**  Append the LogEntry structure at the end of currentLog, and to LogFile
+**
+**  @param log  Pointer the replay log entry to be added
+*/
+static void AppendLog(LogEntry *log)
+{
+	AddLogEntry(*CurrentReplay, log);
 
-	PrintLogCommand(*log, file);
-	file.flush();
+	PrintLogCommand(*log, LogBuffer);
+	if (LogBuffer.size() >= LogBufferSize || GetTicks() - LogBufferTicks >= LogBufferDelay) {
+		FlushReplayLog();
+	}
 }
 
 /**
@@ -453,6 +566,8 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 			return;
 		}
 
+		LogBuffer.clear();
+		LogBufferTicks = GetTicks();
 		if (CurrentReplay) {
 			SaveFullLog(*LogFile);
 		}
@@ -461,6 +576,7 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 	if (!CurrentReplay) {
 		CurrentReplay = StartReplay();
 
+		FlushReplayLog();
 		SaveFullLog(*LogFile);
 	}
 
@@ -505,7 +621,464 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 	log->SyncRandSeed = SyncRandSeed;
 
 	// Append it to ReplayLog list
-	AppendLog(log, *LogFile);
+	AppendLog(log);
+}
+
+//----------------------------------------------------------------------------
+// Binary replays
+//----------------------------------------------------------------------------
+
+/*
+**  SaveReplay writes the replays in a binary format made of chunks, as the
+**  save games:
+**
+**    magic "StrRply\n", version (uint32)
+**    chunks: tag (4 chars), size (uint32), size bytes of data
+**
+**  "STRS" is the string table: count, then length and chars of each.
+**  "CMDS" is the count of commands then the commands: cycle delta, action,
+**  unit + 1, unit ident, flush, x, y, dest unit + 1, value, num as
+**  variable length integers (strings by index in the table) and the
+**  sync seed as uint32.
+**  "KEYF" is a keyframe: its cycle, the size of the save game if it is
+**  compressed else 0, then the save game.
+**  "LUA " comes last, it is the ReplayLog definition. Version 1 saved 0 as
+**  its size and the definition ran until the end of the file.
+*/
+
+/**
+**  Append a variable length integer: 7 bits by byte, low bits first.
+*/
+static void ReplayWriteVarint(std::string &out, unsigned long value)
+{
+	while (value >= 0x80) {
+		out += static_cast<char>((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	out += static_cast<char>(value);
+}
+
+/**
+**  Append a signed variable length integer, small negative values short.
+*/
+static void ReplayWriteSigned(std::string &out, int value)
+{
+	ReplayWriteVarint(out, (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(value >> 31));
+}
+
+/**
+**  Append a little endian integer.
+*/
+static void ReplayWriteUInt32(std::string &out, unsigned int value)
+{
+	for (int i = 0; i < 4; ++i) {
+		out += static_cast<char>((value >> (8 * i)) & 0xFF);
+	}
+}
+
+/**
+**  Read a variable length integer.
+**
+**  @param in     Data to read.
+**  @param pos    Position in data, moved after the integer.
+**  @param value  Integer read.
+**
+**  @return       false if the data is truncated.
+*/
+static bool ReplayReadVarint(const std::string &in, size_t &pos, unsigned long &value)
+{
+	value = 0;
+	for (int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+		const unsigned char c = in[pos++];
+
+		value |= static_cast<unsigned long>(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+**  Read a signed variable length integer.
+*/
+static bool ReplayReadSigned(const std::string &in, size_t &pos, int &value)
+{
+	unsigned long zigzag;
+
+	if (!ReplayReadVarint(in, pos, zigzag)) {
+		return false;
+	}
+	value = static_cast<int>(zigzag >> 1) ^ -static_cast<int>(zigzag & 1);
+	return true;
+}
+
+/**
+**  Read a little endian integer.
+*/
+static bool ReplayReadUInt32(const std::string &in, size_t &pos, unsigned int &value)
+{
+	if (in.size() < pos + 4) {
+		return false;
+	}
+	const unsigned char *data = reinterpret_cast<const unsigned char *>(in.data() + pos);
+	value = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+	pos += 4;
+	return true;
+}
+
+/**
+**  Write a chunk of a binary replay.
+**
+**  @param file  Output file.
+**  @param tag   Name of the chunk, 4 chars.
+**  @param data  Content of the chunk.
+*/
+static void ReplayWriteChunk(CFile &file, const char *tag, const std::string &data)
+{
+	std::string size;
+
+	ReplayWriteUInt32(size, data.size());
+	file.write(tag, 4);
+	file.write(size.data(), size.size());
+	file.write(data.data(), data.size());
+}
+
+/**
+**  Get the index of a string in the string table of a binary replay.
+*/
+static unsigned long ReplayStringIndex(std::map<std::string, unsigned long> &indexes, std::string &table, const std::string &str)
+{
+	std::map<std::string, unsigned long>::iterator it = indexes.find(str);
+
+	if (it != indexes.end()) {
+		return it->second;
+	}
+	const unsigned long index = indexes.size();
+	indexes[str] = index;
+	ReplayWriteVarint(table, str.size());
+	table += str;
+	return index;
+}
+
+/**
+**  Compress a save game into a keyframe.
+*/
+static void PackReplayKeyframe(const std::string &content, ReplayKeyframe &keyframe)
+{
+#ifdef USE_ZLIB
+	uLongf size = compressBound(content.size());
+
+	keyframe.Data.resize(size);
+	if (compress(reinterpret_cast<Bytef *>(&keyframe.Data[0]), &size,
+				 reinterpret_cast<const Bytef *>(content.data()), content.size()) == Z_OK) {
+		keyframe.Data.resize(size);
+		keyframe.Size = content.size();
+		return;
+	}
+#endif
+	keyframe.Data = content;
+	keyframe.Size = 0;
+}
+
+/**
+**  Uncompress the save game of a keyframe.
+**
+**  @return  false if the keyframe can't be read.
+*/
+static bool UnpackReplayKeyframe(const ReplayKeyframe &keyframe, std::string &content)
+{
+	if (!keyframe.Size) {
+		content = keyframe.Data;
+		return true;
+	}
+#ifdef USE_ZLIB
+	uLongf size = keyframe.Size;
+
+	content.resize(size);
+	if (uncompress(reinterpret_cast<Bytef *>(&content[0]), &size,
+				   reinterpret_cast<const Bytef *>(keyframe.Data.data()), keyframe.Data.size()) == Z_OK
+		&& size == keyframe.Size) {
+		return true;
+	}
+#endif
+	content.clear();
+	return false;
+}
+
+/**
+**  Write a replay in the binary format.
+**
+**  @param replay  The replay to write.
+**  @param file    The file to write to.
+*/
+static void SaveBinaryReplay(const FullReplay &replay, CFile &file)
+{
+	std::map<std::string, unsigned long> indexes;
+	std::string strings;
+	std::string commands;
+	unsigned long count = 0;
+	unsigned long lastCycle = 0;
+
+	for (const LogEntry *log = replay.Commands; log; log = log->Next) {
+		ReplayWriteVarint(commands, log->GameCycle - lastCycle);
+		ReplayWriteVarint(commands, ReplayStringIndex(indexes, strings, log->Action));
+		ReplayWriteVarint(commands, log->UnitNumber + 1);
+		ReplayWriteVarint(commands, ReplayStringIndex(indexes, strings, log->UnitIdent));
+		ReplayWriteVarint(commands, log->Flush);
+		ReplayWriteSigned(commands, log->PosX);
+		ReplayWriteSigned(commands, log->PosY);
+		ReplayWriteVarint(commands, log->DestUnitNumber + 1);
+		ReplayWriteVarint(commands, ReplayStringIndex(indexes, strings, log->Value));
+		ReplayWriteSigned(commands, log->Num);
+		ReplayWriteUInt32(commands, log->SyncRandSeed);
+		lastCycle = log->GameCycle;
+		++count;
+	}
+
+	std::string data;
+	file.write(ReplayMagic, sizeof(ReplayMagic));
+	ReplayWriteUInt32(data, ReplayVersion);
+	file.write(data.data(), data.size());
+
+	data.clear();
+	ReplayWriteVarint(data, indexes.size());
+	ReplayWriteChunk(file, "STRS", data + strings);
+	data.clear();
+	ReplayWriteVarint(data, count);
+	ReplayWriteChunk(file, "CMDS", data + commands);
+	for (size_t i = 0; i != replay.Keyframes.size(); ++i) {
+		const ReplayKeyframe &keyframe = replay.Keyframes[i];
+
+		data.clear();
+		ReplayWriteVarint(data, keyframe.Cycle);
+		ReplayWriteVarint(data, keyframe.Size);
+		ReplayWriteChunk(file, "KEYF", data + keyframe.Data);
+	}
+	data.clear();
+	CFile header;
+	header.openBuffer(data);
+	SaveReplayHeader(replay, header);
+	header.close();
+	ReplayWriteChunk(file, "LUA ", data);
+}
+
+/**
+**  Read the commands of a binary replay.
+**
+**  @param replay    The replay to fill.
+**  @param strings   The "STRS" chunk.
+**  @param commands  The "CMDS" chunk.
+**
+**  @return          false if the chunks are invalid.
+*/
+static bool ParseBinaryReplayCommands(FullReplay &replay, const std::string &strings, const std::string &commands)
+{
+	std::vector<std::string> table;
+	unsigned long count;
+	size_t pos = 0;
+
+	if (!ReplayReadVarint(strings, pos, count)) {
+		return false;
+	}
+	for (unsigned long i = 0; i != count; ++i) {
+		unsigned long size;
+
+		if (!ReplayReadVarint(strings, pos, size) || size > strings.size() - pos) {
+			return false;
+		}
+		table.push_back(strings.substr(pos, size));
+		pos += size;
+	}
+
+	pos = 0;
+	if (!ReplayReadVarint(commands, pos, count)) {
+		return false;
+	}
+	unsigned long cycle = 0;
+	for (unsigned long i = 0; i != count; ++i) {
+		unsigned long delta, action, unit, ident, flush, dest, value;
+		int x, y, num;
+		unsigned int seed;
+
+		if (!ReplayReadVarint(commands, pos, delta)
+			|| !ReplayReadVarint(commands, pos, action) || action >= table.size()
+			|| !ReplayReadVarint(commands, pos, unit)
+			|| !ReplayReadVarint(commands, pos, ident) || ident >= table.size()
+			|| !ReplayReadVarint(commands, pos, flush)
+			|| !ReplayReadSigned(commands, pos, x) || !ReplayReadSigned(commands, pos, y)
+			|| !ReplayReadVarint(commands, pos, dest)
+			|| !ReplayReadVarint(commands, pos, value) || value >= table.size()
+			|| !ReplayReadSigned(commands, pos, num)
+			|| !ReplayReadUInt32(commands, pos, seed)) {
+			return false;
+		}
+		LogEntry *log = new LogEntry;
+
+		cycle += delta;
+		log->GameCycle = cycle;
+		log->Action = table[action];
+		log->UnitNumber = static_cast<int>(unit) - 1;
+		log->UnitIdent = table[ident];
+		log->Flush = flush;
+		log->PosX = x;
+		log->PosY = y;
+		log->DestUnitNumber = static_cast<int>(dest) - 1;
+		log->Value = table[value];
+		log->Num = num;
+		log->SyncRandSeed = seed;
+		AddLogEntry(replay, log);
+	}
+	return true;
+}
+
+/**
+**  Load a replay in the binary format.
+**
+**  The "LUA " chunk defines the replay with ReplayLog, the other chunks
+**  are its commands and keyframes.
+**
+**  @param content  Content of the replay file.
+**  @param name     Name of the replay file.
+**
+**  @return         0 for success, -1 for failure.
+*/
+static int LoadBinaryReplay(const std::string &content, const std::string &name)
+{
+	size_t pos = sizeof(ReplayMagic);
+	unsigned int version;
+
+	if (!ReplayReadUInt32(content, pos, version) || version < 1 || version > ReplayVersion) {
+		fprintf(stderr, "Unsupported replay version in `%s'\n", name.c_str());
+		return -1;
+	}
+	std::string strings;
+	std::string commands;
+	std::vector<ReplayKeyframe> keyframes;
+	bool valid = false;
+
+	while (pos + 8 <= content.size()) {
+		const std::string tag = content.substr(pos, 4);
+		unsigned int size;
+
+		pos += 4;
+		ReplayReadUInt32(content, pos, size);
+		if (tag == "LUA " && version == 1) {
+			size = content.size() - pos;
+		}
+		if (size > content.size() - pos) {
+			fprintf(stderr, "Truncated replay chunk `%s' in `%s'\n", tag.c_str(), name.c_str());
+			break;
+		}
+		if (tag == "LUA ") {
+			valid = LuaLoadBuffer(content.c_str() + pos, size, name) == 0;
+			break;
+		}
+		const std::string data = content.substr(pos, size);
+		pos += size;
+		if (tag == "STRS") {
+			strings = data;
+		} else if (tag == "CMDS") {
+			commands = data;
+		} else if (tag == "KEYF") {
+			size_t keyPos = 0;
+			ReplayKeyframe keyframe;
+
+			if (ReplayReadVarint(data, keyPos, keyframe.Cycle)
+				&& ReplayReadVarint(data, keyPos, keyframe.Size)) {
+				keyframe.Data = data.substr(keyPos);
+				keyframes.push_back(keyframe);
+			}
+		}
+	}
+	if (!valid || !CurrentReplay || !ParseBinaryReplayCommands(*CurrentReplay, strings, commands)) {
+		fprintf(stderr, "Invalid replay `%s'\n", name.c_str());
+		return -1;
+	}
+	CurrentReplay->Keyframes.swap(keyframes);
+	return 0;
+}
+
+/**
+**  Find the last keyframe of a replay before a cycle.
+*/
+static const ReplayKeyframe *FindReplayKeyframe(const FullReplay &replay, unsigned long cycle)
+{
+	const ReplayKeyframe *best = NULL;
+
+	for (size_t i = 0; i != replay.Keyframes.size(); ++i) {
+		if (replay.Keyframes[i].Cycle <= cycle) {
+			best = &replay.Keyframes[i];
+		}
+	}
+	return best;
+}
+
+/**
+**  Drop every other keyframe, keeping the newest, until the keyframes fit
+**  in ReplayKeyframeMaxSize. The seek stays possible over the whole game,
+**  from fewer keyframes.
+*/
+static void ThinReplayKeyframes(std::vector<ReplayKeyframe> &keyframes)
+{
+	size_t total = 0;
+
+	for (size_t i = 0; i != keyframes.size(); ++i) {
+		total += keyframes[i].Data.size();
+	}
+	while (total > ReplayKeyframeMaxSize && keyframes.size() > 1) {
+		std::vector<ReplayKeyframe> kept;
+		const size_t last = keyframes.size() - 1;
+
+		total = 0;
+		for (size_t i = last % 2; i <= last; i += 2) {
+			kept.push_back(ReplayKeyframe());
+			kept.back().Cycle = keyframes[i].Cycle;
+			kept.back().Size = keyframes[i].Size;
+			kept.back().Data.swap(keyframes[i].Data);
+			total += kept.back().Data.size();
+		}
+		keyframes.swap(kept);
+	}
+	if (total > ReplayKeyframeMaxSize) {
+		keyframes.clear();
+	}
+}
+
+/**
+**  Save a keyframe of the logged game, every ReplayKeyframeInterval cycles.
+**
+**  Called at the start of the cycle, before its commands.
+**  Only single player games have keyframes: the network state isn't
+**  in the save games.
+**  The save game is made on the game thread, so the keyframes are off
+**  unless SetReplayKeyframeInterval asks for them.
+*/
+void ReplayKeyframesEachCycle()
+{
+	if (CommandLogDisabled || !LogFile || !CurrentReplay || !ReplayKeyframeInterval
+		|| !GameCycle || GameCycle % ReplayKeyframeInterval || IsNetworkGame()) {
+		return;
+	}
+	std::vector<ReplayKeyframe> &keyframes = CurrentReplay->Keyframes;
+	if (!keyframes.empty() && keyframes.back().Cycle >= GameCycle) {
+		return;
+	}
+	const unsigned long ticks = GetTicks();
+	std::string content;
+
+	SavingKeyframe = true;
+	const int ret = SaveGameContent(content);
+	SavingKeyframe = false;
+	if (ret) {
+		return;
+	}
+	keyframes.push_back(ReplayKeyframe());
+	keyframes.back().Cycle = GameCycle;
+	PackReplayKeyframe(content, keyframes.back());
+	DebugPrint("Replay keyframe at %lu: %lu bytes in %lu ms\n" _C_ GameCycle
+			   _C_ (unsigned long)keyframes.back().Data.size() _C_ GetTicks() - ticks);
+	ThinReplayKeyframes(keyframes);
 }
 
 /**
@@ -514,7 +1087,6 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 static int CclLog(lua_State *l)
 {
 	LogEntry *log;
-	LogEntry **last;
 	const char *value;
 
 	LuaCheckArgs(l, 1);
@@ -562,13 +1134,7 @@ static int CclLog(lua_State *l)
 		lua_pop(l, 1);
 	}
 
-	// Append to linked list
-	last = &CurrentReplay->Commands;
-	while (*last) {
-		last = &(*last)->Next;
-	}
-
-	*last = log;
+	AddLogEntry(*CurrentReplay, log);
 
 	return 0;
 }
@@ -666,6 +1232,8 @@ static int CclReplayLog(lua_State *l)
 			replay->Opponents = LuaToNumber(l, -1);
 		} else if (!strcmp(value, "MapRichness")) {
 			replay->MapRichness = LuaToNumber(l, -1);
+		} else if (!strcmp(value, "BatchSearch")) {
+			replay->BatchSearch = LuaToBoolean(l, -1);
 		} else if (!strcmp(value, "Engine")) {
 			if (!lua_istable(l, -1) || lua_rawlen(l, -1) != 3) {
 				LuaError(l, "incorrect argument");
@@ -706,6 +1274,17 @@ bool IsReplayGame()
 	return ReplayGameType != ReplayNone;
 }
 
+/**
+**  Check if the replayed game searched its paths in batches.
+**
+**  The batched searches give other paths than the searches done during
+**  the actions, so a replay must batch as the logged game did.
+*/
+bool IsReplayBatchSearch()
+{
+	return CurrentReplay && CurrentReplay->BatchSearch;
+}
+
 /**
 **  Save generated replay
 **
@@ -726,7 +1305,18 @@ int LoadReplay(const std::string &name)
 	CleanReplayLog();
 	ReplayGameType = ReplaySinglePlayer;
 
-	LuaLoadFile(name);
+	std::string content;
+	if (GetFileContent(name, content) == false) {
+		return -1;
+	}
+	if (content.size() >= sizeof(ReplayMagic) && !content.compare(0, sizeof(ReplayMagic), ReplayMagic, sizeof(ReplayMagic))) {
+		if (LoadBinaryReplay(content, name) == -1) {
+			CleanReplayLog();
+			return -1;
+		}
+	} else {
+		LuaLoadBuffer(content.c_str(), content.size(), name);
+	}
 
 	NextLogCycle = ~0UL;
 	if (!CommandLogDisabled) {
@@ -745,12 +1335,17 @@ int LoadReplay(const std::string &name)
 void EndReplayLog()
 {
 	if (LogFile) {
+		FlushReplayLog();
 		LogFile->close();
 		delete LogFile;
 		LogFile = NULL;
 	}
 	if (CurrentReplay) {
-		DeleteReplay(CurrentReplay);
+		// Keep it for SaveReplay
+		if (LastReplay) {
+			DeleteReplay(LastReplay);
+		}
+		LastReplay = CurrentReplay;
 		CurrentReplay = NULL;
 	}
 	ReplayStep = NULL;
@@ -761,6 +1356,7 @@ void EndReplayLog()
 */
 void CleanReplayLog()
 {
+	FlushReplayLog();
 	if (CurrentReplay) {
 		DeleteReplay(CurrentReplay);
 		CurrentReplay = 0;
@@ -776,6 +1372,17 @@ void CleanReplayLog()
 	ReplayGameType = ReplayNone;
 }
 
+/**
+**  Free the replay kept for SaveReplay once its game is over.
+*/
+void FreeLastReplay()
+{
+	if (LastReplay) {
+		DeleteReplay(LastReplay);
+		LastReplay = NULL;
+	}
+}
+
 /**
 **  Do next replay
 */
@@ -927,13 +1534,28 @@ static void ReplayEachCycle()
 			}
 		}
 		ReplayStep = CurrentReplay->Commands;
+		// Started from a keyframe, the earlier commands are done. The
+		// keyframe of a cycle is saved after the commands given during
+		// that cycle, so these are done too.
+		while (ReplayStep && (ReplayStep->GameCycle < GameCycle
+							  || (ReplayFromKeyframe && ReplayStep->GameCycle == GameCycle))) {
+			ReplayStep = ReplayStep->Next;
+		}
+		ReplayFromKeyframe = false;
 		NextLogCycle = (ReplayStep ? (unsigned)ReplayStep->GameCycle : ~0UL);
+		if (SeekCycle > GameCycle) {
+			FastForwardCycle = SeekCycle;
+		}
+		SeekCycle = 0;
 		InitReplay = 0;
 	}
 
 	if (!ReplayStep) {
 		SetMessage("%s", _("End of replay"));
 		GameObserve = false;
+		if (HeadlessMode) {
+			StopGame(GameNoResult);
+		}
 		return;
 	}
 
@@ -948,6 +1570,9 @@ static void ReplayEachCycle()
 	if (!ReplayStep) {
 		SetMessage("%s", _("End of replay"));
 		GameObserve = false;
+		if (HeadlessMode) {
+			StopGame(GameNoResult);
+		}
 	}
 }
 
@@ -974,6 +1599,9 @@ void MultiPlayerReplayEachCycle()
 /**
 **  Save the replay
 **
+**  The replay of the current or last game is saved in the binary format,
+**  with its keyframes. Without one, the command log file is copied.
+**
 **  @param filename  Name of the file to save to
 **
 **  @return          0 for success, -1 for failure
@@ -992,8 +1620,23 @@ int SaveReplay(const std::string &filename)
 		return -1;
 	}
 
+	FlushReplayLog();
+
 	destination = Parameters::Instance.GetUserDirectory() + "/" + GameName + "/logs/" + filename;
 
+	const FullReplay *replay = CurrentReplay ? CurrentReplay : LastReplay;
+	if (replay) {
+		CFile file;
+
+		if (file.open(destination.c_str(), CL_OPEN_WRITE) == -1) {
+			fprintf(stderr, "Can't save to `%s'\n", destination.c_str());
+			return -1;
+		}
+		SaveBinaryReplay(*replay, file);
+		file.close();
+		return 0;
+	}
+
 	logfile << Parameters::Instance.GetUserDirectory() << "/" << GameName << "/logs/log_of_stratagus_" << ThisPlayer->Index << ".log";
 
 	if (stat(logfile.str().c_str(), &sb)) {
@@ -1028,6 +1671,43 @@ int SaveReplay(const std::string &filename)
 	return 0;
 }
 
+/**
+**  Start the replay held by SeekReplay again, from its last keyframe
+**  before SeekCycle or else from its beginning.
+**
+**  @param reveal  Reveal the map.
+*/
+static void RestartReplay(bool reveal)
+{
+	FullReplay *replay = SeekReplay;
+	const ReplayKeyframe *keyframe = FindReplayKeyframe(*replay, SeekCycle);
+	std::string content;
+
+	SeekReplay = NULL;
+	if (keyframe && UnpackReplayKeyframe(*keyframe, content) && LoadGameContent(content) == 0) {
+		// The keyframe has its own replay, without the commands
+		if (CurrentReplay) {
+			DeleteReplay(CurrentReplay);
+		}
+	} else {
+		CleanPlayers();
+		keyframe = NULL;
+	}
+	CurrentReplay = replay;
+	ReplayFromKeyframe = keyframe != NULL;
+	ApplyReplaySettings();
+
+	NextLogCycle = ~0UL;
+	CommandLogDisabled = true;
+	DisabledLog = true;
+	GameObserve = true;
+	InitReplay = 1;
+	ReplayRevealMap = reveal;
+
+	DebugPrint("Seek replay to %lu from %lu\n" _C_ SeekCycle _C_ (keyframe ? keyframe->Cycle : 0UL));
+	StartMap(CurrentMapPath, false);
+}
+
 void StartReplay(const std::string &filename, bool reveal)
 {
 	std::string replay;
@@ -1039,6 +1719,85 @@ void StartReplay(const std::string &filename, bool reveal)
 	ReplayRevealMap = reveal;
 
 	StartMap(CurrentMapPath, false);
+
+	// ReplaySeek stopped the game to start it again nearer to its target
+	while (SeekReplay) {
+		RestartReplay(reveal);
+	}
+}
+
+/**
+**  Start a replay at a game cycle: from its last keyframe before the
+**  cycle, fast forwarded to the cycle.
+**
+**  @param filename  Replay to start.
+**  @param cycle     Game cycle to start at.
+**  @param reveal    Reveal the map.
+*/
+void StartReplayAt(const std::string &filename, unsigned long cycle, bool reveal)
+{
+	std::string replay;
+
+	CleanPlayers();
+	ExpandPath(replay, filename);
+	if (LoadReplay(replay) == -1 || !CurrentReplay) {
+		fprintf(stderr, "Can't load the replay `%s'\n", replay.c_str());
+		return;
+	}
+	SeekReplay = CurrentReplay;
+	SeekCycle = cycle;
+	CurrentReplay = NULL;
+	while (SeekReplay) {
+		RestartReplay(reveal);
+	}
+}
+
+/**
+**  Go to a cycle of the replay being watched.
+**
+**  Forward, the game is fast forwarded. Backward or when a keyframe is
+**  nearer, the game is started again from the last keyframe before the
+**  cycle and fast forwarded from there.
+**
+**  @param cycle  Game cycle to go to.
+*/
+void ReplaySeek(unsigned long cycle)
+{
+	if (!IsReplayGame() || !CurrentReplay || !GameRunning) {
+		return;
+	}
+	const ReplayKeyframe *keyframe = FindReplayKeyframe(*CurrentReplay, cycle);
+	const unsigned long start = keyframe ? keyframe->Cycle : 0;
+
+	if (cycle >= GameCycle && start <= GameCycle) {
+		FastForwardCycle = cycle;
+		return;
+	}
+	SeekReplay = CurrentReplay;
+	SeekCycle = cycle;
+	CurrentReplay = NULL;
+	ReplayStep = NULL;
+	StopGame(GameRestart);
+}
+
+/**
+**  Set the cycles between two keyframes of the logged games, 0 for none,
+**  and optionally the bytes their keyframes may use.
+**
+**  @param l  Lua state.
+*/
+static int CclSetReplayKeyframeInterval(lua_State *l)
+{
+	const int args = lua_gettop(l);
+
+	if (args != 1 && args != 2) {
+		LuaError(l, "incorrect argument");
+	}
+	ReplayKeyframeInterval = LuaToNumber(l, 1);
+	if (args == 2) {
+		ReplayKeyframeMaxSize = LuaToNumber(l, 2);
+	}
+	return 0;
 }
 
 /**
@@ -1048,6 +1807,7 @@ void ReplayCclRegister()
 {
 	lua_register(Lua, "Log", CclLog);
 	lua_register(Lua, "ReplayLog", CclReplayLog);
+	lua_register(Lua, "SetReplayKeyframeInterval", CclSetReplayKeyframeInterval);
 }
 
 //@}
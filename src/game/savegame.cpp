@@ -41,11 +41,13 @@
 #include "ai.h"
 #include "iocompat.h"
 #include "iolib.h"
+#include "luacallback.h"
 #include "map.h"
 #include "missile.h"
 #include "parameters.h"
 #include "player.h"
 #include "replay.h"
+#include "script.h"
 #include "spells.h"
 #include "trigger.h"
 #include "ui.h"
@@ -54,20 +56,191 @@
 #include "unittype.h"
 #include "upgrade.h"
 #include "version.h"
+#include "video.h"
 
+#include <map>
 #include <time.h>
 
+#include "SDL.h"
+
 extern void StartMap(const std::string &filename, bool clean);
 
 
+/*----------------------------------------------------------------------------
+--  Documentation
+----------------------------------------------------------------------------*/
+
+/**
+**  @file savegame.cpp
+**
+**  Save games are gzipped files, either a Lua script (the export format)
+**  or a binary file made of chunks:
+**
+**    magic "StrSave\n", version (uint32)
+**    chunks: tag (4 chars), size (uint32), size bytes of data
+**
+**  All the integers are little endian. Only the map fields are binary, in
+**  the "MAPF" chunk (see CMap::SaveFields). The "LUA " chunk comes last
+**  and holds the script of the rest of the game: the units and their
+**  orders, the missiles, the players and the AI are still parsed by Lua
+**  on load. The game is serialized into memory first, so the size
+**  of the script is known; version 1 saved 0 for it and the script ran
+**  until the end of the file. The chunks are kept in memory while the
+**  script runs, it asks for them with GetSaveGameChunk.
+*/
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
 
+/// Start of the binary save games
+static const char SaveGameMagic[8] = {'S', 't', 'r', 'S', 'a', 'v', 'e', '\n'};
+/// Version of the binary save games
+static const unsigned int SaveGameVersion = 2;
+
+/// Chunks of the save game being loaded
+static std::map<std::string, std::string> SaveGameChunks;
+
+/// A background save game is running
+static bool AsyncSaveRunning;
+/// Thread writing the background save game, NULL if none
+static SDL_Thread *AsyncSaveThread;
+/// Posted by the thread when the background save game is written
+static SDL_sem *AsyncSaveDone;
+/// Content of the background save game, uncompressed
+static std::string AsyncSaveContent;
+/// Path of the file of the background save game
+static std::string AsyncSavePath;
+/// Result of the background save game
+static int AsyncSaveResult;
+/// File name of the background save game
+static std::string AsyncSaveFilename;
+/// Function to call when the background save game is finished
+static LuaCallback *AsyncSaveCallback;
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Append a little endian integer.
+*/
+static void SaveGameAppendUInt32(std::string &content, unsigned int value)
+{
+	content += static_cast<char>(value & 0xFF);
+	content += static_cast<char>((value >> 8) & 0xFF);
+	content += static_cast<char>((value >> 16) & 0xFF);
+	content += static_cast<char>(value >> 24);
+}
+
+/**
+**  Overwrite a little endian integer.
+*/
+static void SaveGameSetUInt32(std::string &content, size_t pos, unsigned int value)
+{
+	content[pos] = static_cast<char>(value & 0xFF);
+	content[pos + 1] = static_cast<char>((value >> 8) & 0xFF);
+	content[pos + 2] = static_cast<char>((value >> 16) & 0xFF);
+	content[pos + 3] = static_cast<char>(value >> 24);
+}
+
+/**
+**  Read a little endian integer.
+*/
+static unsigned int SaveGameReadUInt32(const std::string &content, size_t pos)
+{
+	const unsigned char *data = reinterpret_cast<const unsigned char *>(content.data() + pos);
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+}
+
+/**
+**  Append a chunk of a binary save game.
+**
+**  @param content  Save game.
+**  @param tag      Name of the chunk, 4 chars.
+**  @param data     Content of the chunk.
+*/
+static void SaveGameAppendChunk(std::string &content, const char *tag, const std::string &data)
+{
+	content.append(tag, 4);
+	SaveGameAppendUInt32(content, data.size());
+	content += data;
+}
+
+/**
+**  Get a chunk of the save game being loaded.
+**
+**  @param tag  Name of the chunk, 4 chars.
+**
+**  @return     The content of the chunk or NULL if not found.
+*/
+const std::string *GetSaveGameChunk(const char *tag)
+{
+	std::map<std::string, std::string>::const_iterator it = SaveGameChunks.find(tag);
+
+	return it != SaveGameChunks.end() ? &it->second : NULL;
+}
+
+/**
+**  Execute a save game already in memory, binary or Lua script.
+**
+**  @param content   The save game, uncompressed.
+**  @param filename  Name of the save game, for the messages.
+**
+**  @return          0 for success, else exit.
+*/
+int LoadSaveGameContent(const std::string &content, const std::string &filename)
+{
+	if (content.size() < 12 || content.compare(0, 8, SaveGameMagic, 8)) {
+		return LuaLoadBuffer(content.c_str(), content.size(), filename);
+	}
+	const unsigned int version = SaveGameReadUInt32(content, 8);
+	if (version < 1 || version > SaveGameVersion) {
+		fprintf(stderr, "Unsupported save game version %u in `%s'\n", version, filename.c_str());
+		return -1;
+	}
+	int status = -1;
+	for (size_t pos = 12; pos + 8 <= content.size();) {
+		const std::string tag = content.substr(pos, 4);
+		size_t size = SaveGameReadUInt32(content, pos + 4);
+
+		pos += 8;
+		if (tag == "LUA " && version == 1) {
+			size = content.size() - pos;
+		}
+		if (size > content.size() - pos) {
+			fprintf(stderr, "Truncated save game chunk `%s' in `%s'\n", tag.c_str(), filename.c_str());
+			break;
+		}
+		if (tag == "LUA ") {
+			status = LuaLoadBuffer(content.c_str() + pos, size, filename);
+			break;
+		}
+		SaveGameChunks[tag] = content.substr(pos, size);
+		pos += size;
+	}
+	SaveGameChunks.clear();
+	return status;
+}
+
+/**
+**  Load and execute a save game, binary or Lua script.
+**
+**  @param filename  File to load.
+**
+**  @return          0 for success, else exit.
+*/
+int LoadSaveGameFile(const std::string &filename)
+{
+	DebugPrint("Loading '%s'\n" _C_ filename.c_str());
+
+	std::string content;
+	if (GetFileContent(filename, content) == false) {
+		return -1;
+	}
+	return LoadSaveGameContent(content, filename);
+}
+
 void ExpandPath(std::string &newpath, const std::string &path)
 {
 	if (path[0] == '~') {
@@ -101,25 +274,14 @@ static std::string GetSaveDir()
 }
 
 /**
-**  Save a game to file.
-**
-**  @param filename  File name to be stored.
-**  @return  -1 if saving failed, 0 if all OK
+**  Write the script of a save game.
 **
-**  @note  Later we want to store in a more compact binary format.
+**  @param file      Output file.
+**  @param filename  File name of the save game.
+**  @param binary    The map fields are in the MAPF chunk.
 */
-int SaveGame(const std::string &filename)
+static void SaveGameScript(CFile &file, const std::string &filename, bool binary)
 {
-	CFile file;
-	std::string fullpath(GetSaveDir());
-
-	fullpath += "/";
-	fullpath += filename;
-	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
-		fprintf(stderr, "Can't save to `%s'\n", filename.c_str());
-		return -1;
-	}
-
 	time_t now;
 	char dateStr[64];
 
@@ -164,7 +326,7 @@ int SaveGame(const std::string &filename)
 	SaveUnitTypes(file);
 	SaveUpgrades(file);
 	SavePlayers(file);
-	Map.Save(file);
+	Map.Save(file, binary);
 	UnitManager.Save(file);
 	SaveUserInterface(file);
 	SaveAi(file);
@@ -179,10 +341,230 @@ int SaveGame(const std::string &filename)
 		file.printf("-- Lua state\n\n %s\n", s.c_str());
 	}
 	SaveTriggers(file); //Triggers are saved in SaveGlobal, so load it after Global
+}
+
+/**
+**  Save a game into memory.
+**
+**  @param filename  File name of the save game.
+**  @param binary    Save the binary format, else a Lua script.
+**  @param content   The save game, uncompressed.
+*/
+static void SaveGameToContent(const std::string &filename, bool binary, std::string &content)
+{
+	CFile file;
+	size_t scriptPos = 0;
+
+	content.clear();
+	if (binary) {
+		std::string fields;
+
+		Map.SaveFields(fields);
+		content.append(SaveGameMagic, sizeof(SaveGameMagic));
+		SaveGameAppendUInt32(content, SaveGameVersion);
+		SaveGameAppendChunk(content, "MAPF", fields);
+		// The size of the script is set once it is written.
+		SaveGameAppendChunk(content, "LUA ", std::string());
+		scriptPos = content.size();
+	}
+	file.openBuffer(content);
+	// FIXME: save the units, their orders, the missiles, the players and
+	// the AI in binary chunks too, they are the bulk of the script.
+	SaveGameScript(file, filename, binary);
 	file.close();
+	if (binary) {
+		SaveGameSetUInt32(content, scriptPos - 4, content.size() - scriptPos);
+	}
+}
+
+/**
+**  Write a save game to a gzipped file.
+**
+**  @param fullpath  Path of the file.
+**  @param content   The save game, uncompressed.
+**  @return  -1 if saving failed, 0 if all OK
+*/
+static int WriteSaveGameFile(const std::string &fullpath, const std::string &content)
+{
+	CFile file;
+
+	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to `%s'\n", fullpath.c_str());
+		return -1;
+	}
+	const bool ok = content.empty() || file.write(content.data(), content.size()) > 0;
+	return (file.close() == 0 && ok) ? 0 : -1;
+}
+
+/**
+**  Save a game to file.
+**
+**  @param filename  File name to be stored.
+**  @param binary    Save the binary format, else a Lua script.
+**  @return  -1 if saving failed, 0 if all OK
+*/
+static int SaveGameFile(const std::string &filename, bool binary)
+{
+	std::string content;
+
+	SaveGameToContent(filename, binary, content);
+	return WriteSaveGameFile(GetSaveDir() + "/" + filename, content);
+}
+
+/**
+**  Save a game to file, in the binary format.
+**
+**  @param filename  File name to be stored.
+**  @return  -1 if saving failed, 0 if all OK
+*/
+int SaveGame(const std::string &filename)
+{
+	const unsigned long ticks = GetTicks();
+	const int ret = SaveGameFile(filename, true);
+
+	DebugPrint("Saved '%s' in %lu ms\n" _C_ filename.c_str() _C_ GetTicks() - ticks);
+	return ret;
+}
+
+/**
+**  Save the game into memory, in the binary format.
+**
+**  @param content  The save game, uncompressed, as LoadGameContent wants it.
+**  @return  -1 if saving failed, 0 if all OK
+*/
+int SaveGameContent(std::string &content)
+{
+	SaveGameToContent("keyframe", true, content);
+	return 0;
+}
+
+/**
+**  Load a game saved by SaveGameContent, as StartSavedGame does before
+**  starting the map.
+**
+**  @param content  The save game.
+**  @return  -1 if loading failed, 0 if all OK
+*/
+int LoadGameContent(const std::string &content)
+{
+	SaveGameLoading = true;
+	CleanPlayers();
+	LoadGameFromContent(content, "keyframe");
+	return 0;
+}
+
+/**
+**  Main function of the thread writing the background save game.
+*/
+static int AsyncSaveLoop(void *)
+{
+	AsyncSaveResult = WriteSaveGameFile(AsyncSavePath, AsyncSaveContent);
+	SDL_SemPost(AsyncSaveDone);
 	return 0;
 }
 
+/**
+**  Save a game to file without stopping the game for the compression.
+**
+**  The game is serialized into memory at once, in the game thread, as the
+**  scripts and the modules aren't thread safe. A thread then compresses
+**  and writes it while the game goes on. If the thread can't be created,
+**  it is written at once.
+**
+**  Only the compression and the writing leave the game thread: the game
+**  still stalls for the whole serialization, the Lua script of the units
+**  and the Lua state included. "benchmark -l" prints that stall.
+**  A cheap snapshot of the game to serialize in the thread would need
+**  copies of every module and isn't done. In both cases the callback is called later from
+**  CheckAsyncSaveGame, with the file name and the result of the save.
+**
+**  @param filename  File name to be stored.
+**  @param callback  Function to call when done, or NULL. Owned by the save.
+**  @return  -1 if a background save is already running, 0 if started
+*/
+int SaveGameAsync(const std::string &filename, LuaCallback *callback)
+{
+	if (IsAsyncSaveGameRunning()) {
+		fprintf(stderr, "Can't save `%s', a save game is already running\n", filename.c_str());
+		delete callback;
+		return -1;
+	}
+	AsyncSaveRunning = true;
+	AsyncSaveFilename = filename;
+	AsyncSaveCallback = callback;
+	AsyncSavePath = GetSaveDir() + "/" + filename;
+	SaveGameToContent(filename, true, AsyncSaveContent);
+
+	if (!AsyncSaveDone) {
+		AsyncSaveDone = SDL_CreateSemaphore(0);
+	}
+	AsyncSaveThread = SDL_CreateThread(AsyncSaveLoop, NULL);
+	if (!AsyncSaveThread) {
+		fprintf(stderr, "Can't create a thread to save in the background\n");
+		AsyncSaveLoop(NULL);
+		AsyncSaveThread = NULL;
+	}
+	return 0;
+}
+
+/**
+**  Check if a background save game is running.
+*/
+bool IsAsyncSaveGameRunning()
+{
+	return AsyncSaveRunning;
+}
+
+/**
+**  Finish the background save game when it is done.
+**
+**  The thread only compresses and writes the file, so waiting for it
+**  doesn't depend on the game.
+**
+**  @param wait  Wait for the save to be finished.
+*/
+void CheckAsyncSaveGame(bool wait)
+{
+	if (!IsAsyncSaveGameRunning()) {
+		return;
+	}
+	if (wait) {
+		SDL_SemWait(AsyncSaveDone);
+	} else if (SDL_SemTryWait(AsyncSaveDone) != 0) {
+		return;
+	}
+	if (AsyncSaveThread) {
+		SDL_WaitThread(AsyncSaveThread, NULL);
+		AsyncSaveThread = NULL;
+	}
+	AsyncSaveRunning = false;
+	// Free the memory of the save game.
+	std::string().swap(AsyncSaveContent);
+	if (AsyncSaveResult) {
+		fprintf(stderr, "Can't save to `%s'\n", AsyncSaveFilename.c_str());
+	}
+	LuaCallback *callback = AsyncSaveCallback;
+	AsyncSaveCallback = NULL;
+	if (callback) {
+		callback->pushPreamble();
+		callback->pushString(AsyncSaveFilename);
+		callback->pushInteger(AsyncSaveResult);
+		callback->run();
+		delete callback;
+	}
+}
+
+/**
+**  Save a game to file, as a Lua script.
+**
+**  @param filename  File name to be stored.
+**  @return  -1 if saving failed, 0 if all OK
+*/
+int ExportSaveGame(const std::string &filename)
+{
+	return SaveGameFile(filename, false);
+}
+
 /**
 **  Delete save game
 **
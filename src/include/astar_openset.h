@@ -0,0 +1,194 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name astar_openset.h - The a* open set headerfile. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __ASTAR_OPENSET_H__
+#define __ASTAR_OPENSET_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <vector>
+
+#include "stratagus.h"
+#include "vec2i.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Open set of the a* path finder.
+**
+**  Binary min-heap ordered by complete costs, then by estimated cost to
+**  goal, then by distance to goal (the historical tie-breaking).
+**  Every matrix offset remembers its slot in the heap, so looking up a
+**  node is O(1) and decreasing its cost is O(log n).
+**  The heap grows on demand: pushing a node never fails.
+*/
+class AStarOpenSet
+{
+public:
+	struct Node {
+		Vec2i pos;       /// Tile position
+		int O;           /// Offset into matrix
+		int Costs;       /// Complete costs to goal
+		int CostToGoal;  /// Estimated cost to goal
+		int Dist;        /// Distance to goal, last tie-breaker
+	};
+
+public:
+	/// Reserve the offset index for a matrix of matrixSize nodes
+	void Init(unsigned int matrixSize)
+	{
+		m_index.assign(matrixSize, 0);
+		m_heap.clear();
+	}
+
+	void Clear() { m_heap.clear(); }
+	bool Empty() const { return m_heap.empty(); }
+	size_t Size() const { return m_heap.size(); }
+
+	/// Node with the lowest costs
+	const Node &Top() const { return m_heap[0]; }
+	const Node &operator[](unsigned int i) const { return m_heap[i]; }
+
+	/**
+	**  Add a new node to the open set.
+	*/
+	void Push(const Vec2i &pos, int o, int costs, int costToGoal, int dist)
+	{
+		Node node;
+		node.pos = pos;
+		node.O = o;
+		node.Costs = costs;
+		node.CostToGoal = costToGoal;
+		node.Dist = dist;
+		m_heap.push_back(node);
+		SiftUp(m_heap.size() - 1, node);
+	}
+
+	/**
+	**  Remove the node with the lowest costs.
+	*/
+	void Pop()
+	{
+		const Node last = m_heap.back();
+		m_heap.pop_back();
+		if (!m_heap.empty()) {
+			SiftDown(0, last);
+		}
+	}
+
+	/**
+	**  Check if a node is in the open set.
+	**
+	**  @return  -1 if not found and the position of the node in the heap if found.
+	*/
+	int Find(int o) const
+	{
+		const unsigned int i = m_index[o];
+		return (i < m_heap.size() && m_heap[i].O == o) ? i : -1;
+	}
+
+	/**
+	**  Lower the costs of the node at position i in the heap.
+	**
+	**  The node is ordered by its new costs. The former sorted array
+	**  re-inserted the node with its old costs, so a cheaper path to an
+	**  open node didn't bring it forward.
+	*/
+	void Decrease(unsigned int i, int costs, int costToGoal)
+	{
+		Node node = m_heap[i];
+		Assert(costs <= node.Costs);
+		node.Costs = costs;
+		node.CostToGoal = costToGoal;
+		SiftUp(i, node);
+	}
+
+private:
+	static bool IsBetter(const Node &lhs, const Node &rhs)
+	{
+		if (lhs.Costs != rhs.Costs) {
+			return lhs.Costs < rhs.Costs;
+		}
+		if (lhs.CostToGoal != rhs.CostToGoal) {
+			return lhs.CostToGoal < rhs.CostToGoal;
+		}
+		return lhs.Dist < rhs.Dist;
+	}
+
+	void Place(unsigned int i, const Node &node)
+	{
+		m_heap[i] = node;
+		m_index[node.O] = i;
+	}
+
+	/// Move the hole at i up until node fits in it
+	void SiftUp(unsigned int i, const Node &node)
+	{
+		while (i != 0) {
+			const unsigned int parent = (i - 1) / 2;
+			if (!IsBetter(node, m_heap[parent])) {
+				break;
+			}
+			Place(i, m_heap[parent]);
+			i = parent;
+		}
+		Place(i, node);
+	}
+
+	/// Move the hole at i down until node fits in it
+	void SiftDown(unsigned int i, const Node &node)
+	{
+		const unsigned int size = m_heap.size();
+		for (unsigned int child = 2 * i + 1; child < size; child = 2 * i + 1) {
+			if (child + 1 < size && IsBetter(m_heap[child + 1], m_heap[child])) {
+				++child;
+			}
+			if (!IsBetter(m_heap[child], node)) {
+				break;
+			}
+			Place(i, m_heap[child]);
+			i = child;
+		}
+		Place(i, node);
+	}
+
+private:
+	std::vector<Node> m_heap;          /// heap of open nodes
+	std::vector<unsigned int> m_index; /// matrix offset -> position in m_heap
+};
+
+//@}
+
+#endif // !__ASTAR_OPENSET_H__
@@ -0,0 +1,140 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name blend.h - The alpha blending kernels headerfile. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __BLEND_H__
+#define __BLEND_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <vector>
+
+#include "SDL.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Blend a span of 16-bit RGB565 pixels with a color.
+**
+**  @param pixels  First pixel of the span.
+**  @param width   Number of pixels.
+**  @param color   Color in the format of the pixels.
+**  @param alpha   Alpha of the color, 255 is opaque.
+*/
+typedef void BlendSpan16Func(Uint16 *pixels, int width, Uint32 color, unsigned char alpha);
+
+/**
+**  Blend a span of 32-bit RGB888 pixels with a color.
+**
+**  @param pixels  First pixel of the span.
+**  @param width   Number of pixels.
+**  @param color   Color in the format of the pixels.
+**  @param alpha   Alpha of the color, 255 is opaque.
+*/
+typedef void BlendSpan32Func(Uint32 *pixels, int width, Uint32 color, unsigned char alpha);
+
+/**
+**  Blending kernels of an instruction set.
+**
+**  All the kernels give exactly the pixels of BlendPixel16 and
+**  BlendPixel32.
+*/
+struct BlendKernels {
+	const char *Name;          /// Instruction set of the kernels
+	BlendSpan16Func *Span16;   /// 16-bit kernel
+	BlendSpan32Func *Span32;   /// 32-bit kernel
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+extern BlendSpan16Func *BlendSpan16;  /// Fastest 16-bit kernel of the CPU
+extern BlendSpan32Func *BlendSpan32;  /// Fastest 32-bit kernel of the CPU
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Kernels supported by the CPU, the portable ones first
+extern std::vector<BlendKernels> GetBlendKernels();
+/// Select the fastest kernels supported by the CPU
+extern void InitBlendKernels();
+
+/**
+**  Blend a 16-bit RGB565 pixel with a color.
+**
+**  Loses the 3 low bits of alpha for speed.
+**
+**  @param p      Pixel to blend.
+**  @param color  Color in the format of the pixel.
+**  @param alpha  Alpha of the color, 255 is opaque.
+*/
+inline void BlendPixel16(Uint16 *p, Uint32 color, unsigned char alpha)
+{
+	alpha = (255 - alpha) >> 3;
+
+	color = (((color << 16) | color) & 0x07E0F81F);
+	unsigned long dp = *p;
+	dp = ((dp << 16) | dp) & 0x07E0F81F;
+	dp = ((((dp - color) * alpha) >> 5) + color) & 0x07E0F81F;
+	*p = (Uint16)((dp >> 16) | dp);
+}
+
+/**
+**  Blend a 32-bit RGB888 pixel with a color.
+**
+**  @param p      Pixel to blend.
+**  @param color  Color in the format of the pixel.
+**  @param alpha  Alpha of the color, 255 is opaque.
+*/
+inline void BlendPixel32(Uint32 *p, Uint32 color, unsigned char alpha)
+{
+	alpha = 255 - alpha;
+
+	const unsigned long sp2 = (color & 0xFF00FF00) >> 8;
+	color &= 0x00FF00FF;
+
+	unsigned long dp1 = *p;
+	unsigned long dp2 = (dp1 & 0xFF00FF00) >> 8;
+	dp1 &= 0x00FF00FF;
+
+	dp1 = ((((dp1 - color) * alpha) >> 8) + color) & 0x00FF00FF;
+	dp2 = ((((dp2 - sp2) * alpha) >> 8) + sp2) & 0x00FF00FF;
+	*p = (dp1 | (dp2 << 8));
+}
+
+//@}
+
+#endif // !__BLEND_H__
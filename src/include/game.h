@@ -32,9 +32,20 @@
 #include <string>
 
 class CFile;
+class LuaCallback;
 
 extern void LoadGame(const std::string &filename); /// Load saved game
+extern void LoadGameFromContent(const std::string &content, const std::string &name); /// Load saved game in memory
 extern int SaveGame(const std::string &filename); /// Save game
+extern int ExportSaveGame(const std::string &filename); /// Save game as a Lua script
+extern int SaveGameContent(std::string &content); /// Save game into memory
+extern int LoadGameContent(const std::string &content); /// Load game from memory
+extern int SaveGameAsync(const std::string &filename, LuaCallback *callback); /// Save game in the background
+extern bool IsAsyncSaveGameRunning(); /// A background save game is running
+extern void CheckAsyncSaveGame(bool wait = false); /// Finish the background save game
+extern int LoadSaveGameFile(const std::string &filename); /// Execute a save game
+extern int LoadSaveGameContent(const std::string &content, const std::string &filename); /// Execute a save game in memory
+extern const std::string *GetSaveGameChunk(const char *tag); /// Binary chunk of the loaded save game
 extern void DeleteSaveGame(const std::string &filename); /// Delete save game
 extern bool SaveGameLoading;                 /// Save game is in progress of loading
 
@@ -105,6 +105,7 @@ public:
 	~CFile();
 
 	int open(const char *name, long flags);
+	int openBuffer(std::string &buffer);
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
@@ -112,6 +113,7 @@ public:
 	long tell();
 
 	int printf(const char *format, ...) PRINTF_VAARG_ATTRIBUTE(2, 3); // Don't forget to count this
+	int write(const void *buf, size_t len);
 private:
 	CFile(const CFile &rhs); // No implementation
 	const CFile &operator = (const CFile &rhs); // No implementation
@@ -124,7 +126,8 @@ enum {
 	CLF_TYPE_INVALID,  /// invalid file handle
 	CLF_TYPE_PLAIN,    /// plain text file handle
 	CLF_TYPE_GZIP,     /// gzip file handle
-	CLF_TYPE_BZIP2     /// bzip2 file handle
+	CLF_TYPE_BZIP2,    /// bzip2 file handle
+	CLF_TYPE_BUFFER    /// memory output handle
 };
 
 #define CL_OPEN_READ 0x1
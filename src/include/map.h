@@ -203,8 +203,12 @@ public:
 	void RegenerateForest();
 	/// Reveal the complete map, make everything known.
 	void Reveal();
-	/// Save the map.
-	void Save(CFile &file) const;
+	/// Save the map, the fields going to a binary chunk or to the script.
+	void Save(CFile &file, bool binaryFields = false) const;
+	/// Save the map fields in a binary chunk.
+	void SaveFields(std::string &chunk) const;
+	/// Load the map fields from a binary chunk.
+	bool LoadFields(const std::string &chunk);
 
 	//
 	// Wall
@@ -257,6 +261,8 @@ private:
 
 public:
 	CMapField *Fields;              /// fields on map
+	CUnitBuckets UnitBuckets;       /// coarse index of the unit caches
+	CMapSightPlanes Sight;          /// per player sight counters of the fields
 	bool NoFogOfWar;           /// fog of war disabled
 
 	CTileset *Tileset;          /// tileset data
@@ -315,8 +321,13 @@ extern MapMarkerFunc MapUnmarkTileDetectCloak;
 /// Mark sight changes
 extern void MapSight(const CPlayer &player, const Vec2i &pos, int w,
 					 int h, int range, MapMarkerFunc *marker);
+/// Mark sight changes of a moving unit
+extern void MapSightDelta(const CPlayer &player, const Vec2i &pos, const Vec2i &otherPos,
+						  int w, int h, int range, MapMarkerFunc *marker);
 /// Update fog of war
 extern void UpdateFogOfWarChange();
+/// Recompute the fog of war of all the fields at the next draw
+extern void InvalidateFogOfWar();
 
 //
 // in map_radar.c
@@ -335,6 +346,14 @@ extern MapMarkerFunc MapMarkTileRadarJammer;
 extern MapMarkerFunc MapUnmarkTileRadarJammer;
 
 
+//
+// in map_draw.cpp
+//
+/// Free the cached terrain chunks
+extern void FreeTerrainCache();
+/// Redraw the cached fields using the colors of the color cycling
+extern void RedrawTerrainCycledTiles();
+
 //
 // in map_wall.c
 //
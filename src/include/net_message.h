@@ -44,7 +44,8 @@
  */
 #define NetPlayerNameSize 16
 
-#define MaxNetworkCommands 9  /// Max Commands In A Packet
+#define NetworkMaxPacketSize 1400  /// Max bytes of a packet, below the usual MTU
+#define NetworkMaxGroupUnits 500   /// Max units of a group command, to fit in a packet
 
 /**
 **  Network systems active in current game.
@@ -313,7 +314,10 @@ enum _message_type_ {
 	MessageExtendedCommand,        /// Command is the next byte
 
 	// ATTN: __MUST__ be last due to spellid encoding!!!
-	MessageCommandSpellCast        /// Unit command spell cast
+	MessageCommandSpellCast,       /// Unit command spell cast
+
+	// Last type value, taken from the spell ids to keep the other values
+	MessageCommandGroup = 0x7F     /// Same unit command for several units
 };
 
 /**
@@ -321,7 +325,8 @@ enum _message_type_ {
 */
 enum _extended_message_type_ {
 	ExtendedMessageDiplomacy,     /// Change diplomacy
-	ExtendedMessageSharedVision   /// Change shared vision
+	ExtendedMessageSharedVision,  /// Change shared vision
+	ExtendedMessageNetworkLag     /// Change the network lag wanted by a player
 };
 
 /**
@@ -408,6 +413,28 @@ public:
 	uint16_t player;
 };
 
+/**
+**  Network group command, a unit command for several units.
+*/
+class CNetworkCommandGroup
+{
+public:
+	CNetworkCommandGroup() : Type(0), X(0), Y(0), Dest(0) {}
+
+	size_t Serialize(unsigned char *buf) const;
+	size_t Deserialize(const unsigned char *buf);
+	size_t Size() const;
+
+	bool Contains(uint8_t type, const CNetworkCommand &nc) const;
+
+public:
+	uint8_t Type;                 /// Unit command type, with the flush flag
+	uint16_t X;                   /// Map position X
+	uint16_t Y;                   /// Map position Y
+	uint16_t Dest;                /// Destination unit
+	std::vector<uint16_t> Units;  /// Commanded units
+};
+
 /**
 **  Network Selection Update
 */
@@ -425,44 +452,56 @@ public:
 	std::vector<uint16_t> Units;  /// Selection Units
 };
 
+/**
+**  Is the message a unit command, delta encoded in the packets.
+**
+**  @param type  Message type, with the flush flag.
+*/
+inline bool IsNetworkUnitCommand(uint8_t type)
+{
+	type &= 0x7F;
+	return type >= MessageCommandStop && type != MessageExtendedCommand && type != MessageCommandGroup;
+}
+
 /**
 **  Network packet header.
 **
-**  Header for the packet.
+**  Header for the packet: the types of the commands ended by MessageNone,
+**  so the first byte is never an init message type.
 */
 class CNetworkPacketHeader
 {
 public:
-	CNetworkPacketHeader()
-	{
-		Cycle = 0;
-		memset(Type, 0, sizeof(Type));
-		OrigPlayer = 255;
-	}
+	CNetworkPacketHeader() : Cycle(0), OrigPlayer(255) {}
 
 	size_t Serialize(unsigned char *buf) const;
-	size_t Deserialize(const unsigned char *buf);
-	static size_t Size() { return 1 + 1 + 1 * MaxNetworkCommands; }
+	size_t Deserialize(const unsigned char *buf, size_t len);
+	size_t Size() const { return Type.size() + 1 + 1 + 1; }
 
-	uint8_t Type[MaxNetworkCommands];  /// Commands in packet
-	uint8_t Cycle;                     /// Destination game cycle
-	uint8_t OrigPlayer;                /// Host address
+	std::vector<uint8_t> Type;  /// Commands in packet
+	uint8_t Cycle;              /// Destination game cycle
+	uint8_t OrigPlayer;         /// Host address
 };
 
 /**
 **  Network packet.
 **
-**  This is sent over the network.
+**  This is sent over the network, with any number of commands. The unit
+**  commands are sent as deltas to the previous unit command of the packet.
 */
 class CNetworkPacket
 {
 public:
-	size_t Serialize(unsigned char *buf, int numcommands) const;
-	void Deserialize(const unsigned char *buf, unsigned int len, int *numcommands);
-	size_t Size(int numcommands) const;
+	void Clear() { Header.Type.clear(); Command.clear(); }
+	void Add(uint8_t type, const std::vector<unsigned char> &command);
+	void RemoveLast() { Header.Type.pop_back(); Command.pop_back(); }
+
+	size_t Serialize(unsigned char *buf) const;
+	bool Deserialize(const unsigned char *buf, size_t len);
+	size_t Size() const { return Serialize(NULL); }
 
 	CNetworkPacketHeader Header;  /// Packet Header Info
-	std::vector<unsigned char> Command[MaxNetworkCommands];
+	std::vector<std::vector<unsigned char> > Command;  /// Data of the commands
 };
 
 //@}
@@ -39,12 +39,18 @@ class CHost;
 --  Defines
 ----------------------------------------------------------------------------*/
 
+/*
+**  The network protocol has its own version, raised when the messages
+**  change, so that the engines of a same version but with different
+**  messages don't connect.
+*/
+
 /// Network protocol major version
-#define NetworkProtocolMajorVersion StratagusMajorVersion
+#define NetworkProtocolMajorVersion 2
 /// Network protocol minor version (maximal 99)
-#define NetworkProtocolMinorVersion StratagusMinorVersion
-/// Network protocol patch level (maximal 99)
-#define NetworkProtocolPatchLevel   StratagusPatchLevel
+#define NetworkProtocolMinorVersion 3
+/// Network protocol patch level (maximal 99), 1: variable size packets, 2: group commands
+#define NetworkProtocolPatchLevel   2
 /// Network protocol version (1,2,3) -> 10203
 #define NetworkProtocolVersion \
 	(NetworkProtocolMajorVersion * 10000 + NetworkProtocolMinorVersion * 100 + \
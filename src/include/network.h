@@ -55,6 +55,7 @@ public:
 	unsigned int gameCyclesPerUpdate;  /// Network update each # game cycles
 	unsigned int NetworkLag;      /// Network lag (# update cycles)
 	unsigned int timeoutInS;      /// Number of seconds until player times out
+	bool adaptiveLag;             /// Request lag changes from the measured packet delays
 
 public:
 	static const int defaultPort = 6660; /// Default communication port
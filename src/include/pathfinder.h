@@ -42,7 +42,7 @@
 --  Declarations
 ----------------------------------------------------------------------------*/
 
-#include <queue>
+#include <vector>
 #include "vec2i.h"
 
 class CUnit;
@@ -131,14 +131,28 @@ enum VisitResult {
 	VisitResult_Cancel
 };
 
+/**
+**  Breadth first traversal of the map, each visited field keeps its
+**  distance to the start.
+**
+**  The fields and the queue come from a pool and are reused by the next
+**  traversals. The fields are stamped with a generation, so Init doesn't
+**  clear the whole map for a short range search.
+*/
 class TerrainTraversal
 {
 public:
 	typedef short int dataType;
 public:
+	TerrainTraversal();
+	~TerrainTraversal();
+
 	void SetSize(unsigned int width, unsigned int height);
 	void Init();
 
+	/// Free the unused storages of the pool
+	static void FreeStorages();
+
 	void PushPos(const Vec2i &pos);
 	void PushNeighboor(const Vec2i &pos);
 	void PushUnitPosAndNeighboor(const CUnit &unit);
@@ -154,6 +168,9 @@ public:
 	dataType Get(const Vec2i &pos) const;
 
 private:
+	TerrainTraversal(const TerrainTraversal &); // not implemented
+	void operator=(const TerrainTraversal &);   // not implemented
+
 	void Set(const Vec2i &pos, dataType value);
 
 	struct PosNode {
@@ -162,18 +179,33 @@ private:
 		Vec2i from;
 	};
 
+	/// Fields and queue of a traversal, kept in the pool between the traversals
+	struct Storage {
+		Storage() : extendedWidth(0), height(0), generation(0) {}
+
+		std::vector<unsigned int> values;  /// Generation in the high bits, value in the low bits
+		std::vector<PosNode> queue;        /// Fields to visit, a field is queued once by traversal
+		unsigned int extendedWidth;        /// Width with the border
+		unsigned int height;               /// Height without the border
+		unsigned int generation;           /// Generation of the current traversal
+	};
+
+	static std::vector<Storage *> Pool;  /// Storages free for the next traversals
+
 private:
-	std::vector<dataType> m_values;
-	std::queue<PosNode> m_queue;
-	unsigned int m_extented_width;
-	unsigned int m_height;
+	Storage *m_storage;
+	unsigned int m_generation;  /// Generation of the traversal, in the high bits
+	size_t m_queueHead;         /// Next field to visit in the queue
 };
 
 template <typename T>
 bool TerrainTraversal::Run(T &context)
 {
-	for (; m_queue.empty() == false; m_queue.pop()) {
-		const PosNode &posNode = m_queue.front();
+	std::vector<PosNode> &queue = m_storage->queue;
+
+	for (; m_queueHead != queue.size(); ++m_queueHead) {
+		// Copy, pushing the neighboors may move the queue
+		const PosNode posNode = queue[m_queueHead];
 
 		switch (context.Visit(*this, posNode.pos, posNode.from)) {
 			case VisitResult_Finished: return true;
@@ -199,6 +231,28 @@ extern int AStarMovingUnitCrossingCost;
 extern bool AStarKnowUnseenTerrain;
 /// Cost of using a square we haven't seen before.
 extern int AStarUnknownTerrainCost;
+/// Whether to use the hierarchical path finder for long paths
+extern bool HierarchicalPathfinder;
+/// Size in tiles of the clusters of the hierarchical path finder
+extern int HierarchicalClusterSize;
+/// Whether units moving to the same goal share a flow field
+extern bool FlowFieldPathfinder;
+/// Number of units moving to the same goal before a flow field is built
+extern int FlowFieldMinUnits;
+/// Whether the paths needed in a cycle are searched at once at its start.
+/// The paths differ from the searches done during the actions, so network
+/// games never batch and replays batch as the logged game did.
+extern bool AStarBatchSearch;
+/// Number of threads helping the main thread to search the batched paths
+extern int AStarBatchThreads;
+/// Whether a blocked path is repaired with a short detour before searching a new one
+extern bool PathRepair;
+/// Max distance in tiles from the unit of the detours
+extern int PathRepairRange;
+/// Number of blocked paths repaired, each one saves a new search
+extern int PathRepairsDone;
+/// Number of blocked paths which couldn't be repaired
+extern int PathRepairsFailed;
 
 //
 //  Convert heading into direction.
@@ -223,6 +277,10 @@ extern int UnitReachable(const CUnit &unit, const CUnit &dst, int range);
 /// Can the unit 'src' reach the place x,y
 extern int PlaceReachable(const CUnit &src, const Vec2i &pos, int w, int h,
 						  int minrange, int maxrange);
+/// Notify the pathfinder that the passability of an area changed
+extern void PathfinderTerrainChanged(const Vec2i &pos, int w, int h);
+/// Search at once the paths the units will need this cycle
+extern void PathfinderBatchRequests(const std::vector<CUnit *> &units);
 
 //
 // in astar.cpp
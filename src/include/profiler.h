@@ -0,0 +1,112 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name profiler.h - The frame profiler headerfile. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <string>
+
+#include "SDL.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Stages of a frame timed by the profiler.
+*/
+enum ProfileStage {
+	ProfileStageNetwork,   /// NetworkCommands
+	ProfileStageTriggers,  /// TriggersEachCycle
+	ProfileStageUnits,     /// UnitActions
+	ProfileStageMissiles,  /// MissileActions
+	ProfileStagePlayers,   /// PlayersEachCycle
+	ProfileStageAi,        /// PlayersEachSecond
+	ProfileStageDisplay,   /// UpdateDisplay
+	ProfileStageMax
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+extern bool ProfilerEnabled;  /// Record the time of the stages
+extern bool ProfilerOverlay;  /// Draw the frame time graph
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/// Current time in microseconds
+extern Uint64 ProfileTime();
+/// Record the time of a stage
+extern void ProfileRecord(ProfileStage stage, Uint64 start, Uint64 end);
+/// End the current frame of the graph
+extern void ProfileEndFrame();
+/// Draw the frame time graph
+extern void DrawProfiler();
+/// Save the recorded stages as CSV
+extern int SaveProfileCsv(const std::string &filename);
+/// Save the recorded stages as Chrome trace
+extern int SaveProfileTrace(const std::string &filename);
+/// Register ccl features
+extern void ProfilerCclRegister();
+
+/**
+**  Time a stage from the construction to the end of the scope.
+**
+**  Only a test of ProfilerEnabled when the profiler is off.
+*/
+class ProfileScope
+{
+public:
+	explicit ProfileScope(ProfileStage stage) :
+		Stage(stage), Start(ProfilerEnabled ? ProfileTime() : 0), Enabled(ProfilerEnabled) {}
+	~ProfileScope()
+	{
+		if (Enabled) {
+			ProfileRecord(Stage, Start, ProfileTime());
+		}
+	}
+
+private:
+	ProfileStage Stage;  /// Timed stage
+	Uint64 Start;        /// Start of the stage
+	bool Enabled;        /// Profiler was on at the start
+};
+
+//@}
+
+#endif // !__PROFILER_H__
@@ -64,16 +64,28 @@ extern ReplayType ReplayGameType;  /// Replay game type
 /// Log commands into file
 extern void CommandLog(const char *action, const CUnit *unit, int flush,
 					   int x, int y, const CUnit *dest, const char *value, int num);
+/// Save the keyframes of the logged game each cycle
+extern void ReplayKeyframesEachCycle();
 /// Replay user commands from log each cycle, single player games
 extern void SinglePlayerReplayEachCycle();
 /// Replay user commands from log each cycle, multiplayer games
 extern void MultiPlayerReplayEachCycle();
 /// Load replay
 extern int LoadReplay(const std::string &name);
+/// Whether a replay is running
+extern bool IsReplayGame();
+/// Whether the replayed game searched its paths in batches
+extern bool IsReplayBatchSearch();
+/// Start a replay at a game cycle
+extern void StartReplayAt(const std::string &filename, unsigned long cycle, bool reveal);
+/// Write the logged commands to the log file
+extern void FlushReplayLog();
 /// End logging
 extern void EndReplayLog();
 /// Clean replay
 extern void CleanReplayLog();
+/// Free the replay of the last game
+extern void FreeLastReplay();
 /// Save the replay list to file
 extern void SaveReplayList(CFile &file);
 /// Register ccl functions related to network
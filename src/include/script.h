@@ -69,6 +69,8 @@ enum {
 extern lua_State *Lua;
 
 extern int LuaLoadFile(const std::string &file);
+extern int LuaLoadBuffer(const char *buffer, size_t size, const std::string &name);
+extern bool GetFileContent(const std::string &file, std::string &content);
 extern int LuaCall(int narg, int clear, bool exitOnError = true);
 
 #define LuaError(l, args) \
@@ -110,6 +110,9 @@ extern void PrintLocation(const char *file, int line, const char *funcName);
 extern bool EnableDebugPrint;
 extern bool EnableAssert;
 extern bool EnableUnitDebug;
+extern bool HeadlessMode;
+extern unsigned long HeadlessCycles;
+extern void (*HeadlessCycleCallback)();
 
 extern void AbortAt(const char *file, int line, const char *funcName, const char *conditionStr);
 extern void PrintOnStdOut(const char *format, ...);
@@ -47,23 +47,32 @@
 **    This is the tile number, that the player sitting on the computer
 **    currently knows. Idea: Can be uses for illusions.
 **
-**  CMapFieldPlayerInfo::Visible[]
+**  CMapFieldPlayerInfo::Index
+**
+**    Index of the field in the map, to find its counters in the planes
+**    of CMapSightPlanes.
+**
+**  CMapSightPlanes::Visible[]
 **
 **    Counter how many units of the player can see this field. 0 the
 **    field is not explored, 1 explored, n-1 unit see it. Currently
 **    no more than 253 units can see a field.
 **
-**  CMapFieldPlayerInfo::VisCloak[]
+**  CMapSightPlanes::VisCloak[]
 **
 **    Visiblity for cloaking.
 **
-**  CMapFieldPlayerInfo::Radar[]
+**  CMapSightPlanes::Radar[]
 **
 **    Visiblity for radar.
 **
-**  CMapFieldPlayerInfo::RadarJammer[]
+**  CMapSightPlanes::RadarJammer[]
 **
 **    Jamming capabilities.
+**
+**    The counters of each player are stored in their own plane, indexed
+**    like the map fields, so that the sight of a unit is marked row by
+**    row on contiguous memory.
 */
 
 /**
@@ -147,17 +156,95 @@ struct lua_State;
 --  Map - field
 ----------------------------------------------------------------------------*/
 
-class CMapFieldPlayerInfo
+/// Per player counters of all the fields of the map
+class CMapSightPlanes
 {
 public:
-	CMapFieldPlayerInfo() : SeenTile(0)
+	/// Allocate the planes of a map with size fields
+	void Init(unsigned int size);
+	/// Free the planes
+	void Clean();
+
+	/**
+	**  Increase the seen counters of a row of fields.
+	**
+	**  Only done when all the fields are already seen by the player, the
+	**  others need their units to be marked too.
+	**
+	**  @param player  Index of the player.
+	**  @param index   First field of the row.
+	**  @param count   Number of fields in the row.
+	**
+	**  @return        true if the row was marked, false if untouched.
+	*/
+	bool MarkSeenRow(int player, unsigned int index, int count)
+	{
+		unsigned short *v = &Visible[player][index];
+		unsigned short minimum = 65535;
+
+		for (int i = 0; i < count; ++i) {
+			minimum = std::min(minimum, v[i]);
+		}
+		if (minimum < 2) {
+			return false;
+		}
+		for (int i = 0; i < count; ++i) {
+			++v[i];
+		}
+		return true;
+	}
+
+	/**
+	**  Decrease the seen counters of a row of fields.
+	**
+	**  Only done when all the fields stay seen by the player, the others
+	**  need their units to be unmarked too.
+	**
+	**  @param player  Index of the player.
+	**  @param index   First field of the row.
+	**  @param count   Number of fields in the row.
+	**
+	**  @return        true if the row was unmarked, false if untouched.
+	*/
+	bool UnmarkSeenRow(int player, unsigned int index, int count)
 	{
-		memset(Visible, 0, sizeof(Visible));
-		memset(VisCloak, 0, sizeof(VisCloak));
-		memset(Radar, 0, sizeof(Radar));
-		memset(RadarJammer, 0, sizeof(RadarJammer));
+		unsigned short *v = &Visible[player][index];
+		unsigned short minimum = 65535;
+
+		for (int i = 0; i < count; ++i) {
+			minimum = std::min(minimum, v[i]);
+		}
+		if (minimum < 3) {
+			return false;
+		}
+		for (int i = 0; i < count; ++i) {
+			--v[i];
+		}
+		return true;
 	}
 
+public:
+	std::vector<unsigned short> Visible[PlayerMax];    /// Seen counter 0 unexplored
+	std::vector<unsigned char> VisCloak[PlayerMax];    /// Visiblity for cloaking.
+	std::vector<unsigned char> Radar[PlayerMax];       /// Visiblity for radar.
+	std::vector<unsigned char> RadarJammer[PlayerMax]; /// Jamming capabilities.
+};
+
+class CMapFieldPlayerInfo
+{
+public:
+	CMapFieldPlayerInfo() : SeenTile(0), Index(0)
+	{}
+
+	/// Seen counter of a player, 0 unexplored
+	unsigned short &Visible(int player) const;
+	/// Visiblity of a player for cloaking
+	unsigned char &VisCloak(int player) const;
+	/// Visiblity of a player for radar
+	unsigned char &Radar(int player) const;
+	/// Jamming capabilities of a player
+	unsigned char &RadarJammer(int player) const;
+
 	/// Check if a field for the user is explored.
 	bool IsExplored(const CPlayer &player) const;
 
@@ -176,10 +263,7 @@ public:
 
 public:
 	unsigned short SeenTile;              /// last seen tile (FOW)
-	unsigned short Visible[PlayerMax];    /// Seen counter 0 unexplored
-	unsigned char VisCloak[PlayerMax];    /// Visiblity for cloaking.
-	unsigned char Radar[PlayerMax];       /// Visiblity for radar.
-	unsigned char RadarJammer[PlayerMax]; /// Jamming capabilities.
+	unsigned int Index;                   /// index of the field in the map
 };
 
 /// Describes a field of the map
@@ -191,6 +275,13 @@ public:
 	void Save(CFile &file) const;
 	void parse(lua_State *l);
 
+	/// Size of a field in binary save games
+	enum { RecordSize = 10 };
+	/// Write the field in a binary save game record
+	void SaveRecord(unsigned char *record) const;
+	/// Read the field from a binary save game record
+	void parseRecord(const unsigned char *record);
+
 	void setTileIndex(const CTileset &tileset, unsigned int tileIndex, int value);
 
 	unsigned int getGraphicTile() const { return tile; }
@@ -38,6 +38,8 @@
 #include <vector>
 #include <algorithm>
 
+#include "vec2i.h"
+
 /*----------------------------------------------------------------------------
 --  Declarations
 ----------------------------------------------------------------------------*/
@@ -227,6 +229,105 @@ public:
 	std::vector<CUnit *> Units;
 };
 
+/**
+**  Coarse index of the unit caches of the map.
+**
+**  The map is split in buckets of BucketSize x BucketSize tiles, each
+**  one counting the units of each player touching it.  The finders use
+**  it to skip the tiles of the buckets without any interesting unit.
+*/
+class CUnitBuckets
+{
+public:
+	enum { BucketShift = 3, BucketSize = 1 << BucketShift };
+
+public:
+	CUnitBuckets() : Width(0), Height(0) {}
+
+	/**
+	**  Allocate the buckets for a map.
+	**
+	**  @param mapWidth   Width of the map in tiles.
+	**  @param mapHeight  Height of the map in tiles.
+	*/
+	void Init(int mapWidth, int mapHeight)
+	{
+		Width = (mapWidth + BucketSize - 1) >> BucketShift;
+		Height = (mapHeight + BucketSize - 1) >> BucketShift;
+		Masks.assign(Width * Height, 0);
+		Counts.assign(Width * Height * PlayerMax, 0);
+	}
+
+	/// Free the buckets
+	void Clear()
+	{
+		Width = 0;
+		Height = 0;
+		Masks.clear();
+		Counts.clear();
+	}
+
+	/**
+	**  Count a unit in the buckets touched by its tiles.
+	**
+	**  @param pos     Top left tile of the unit.
+	**  @param size    Size in tiles of the unit, clipped to the map.
+	**  @param player  Owner of the unit.
+	*/
+	void Insert(const Vec2i &pos, const Vec2i &size, int player)
+	{
+		const unsigned int bit = 1 << player;
+
+		for (int y = pos.y >> BucketShift; y <= (pos.y + size.y - 1) >> BucketShift; ++y) {
+			for (int x = pos.x >> BucketShift; x <= (pos.x + size.x - 1) >> BucketShift; ++x) {
+				const int index = y * Width + x;
+
+				if (Counts[index * PlayerMax + player]++ == 0) {
+					Masks[index] |= bit;
+				}
+			}
+		}
+	}
+
+	/**
+	**  Uncount a unit from the buckets touched by its tiles.
+	**
+	**  @param pos     Top left tile of the unit.
+	**  @param size    Size in tiles of the unit, clipped to the map.
+	**  @param player  Owner of the unit when it was counted.
+	*/
+	void Remove(const Vec2i &pos, const Vec2i &size, int player)
+	{
+		const unsigned int bit = 1 << player;
+
+		for (int y = pos.y >> BucketShift; y <= (pos.y + size.y - 1) >> BucketShift; ++y) {
+			for (int x = pos.x >> BucketShift; x <= (pos.x + size.x - 1) >> BucketShift; ++x) {
+				const int index = y * Width + x;
+
+				Assert(Counts[index * PlayerMax + player] != 0);
+				if (--Counts[index * PlayerMax + player] == 0) {
+					Masks[index] &= ~bit;
+				}
+			}
+		}
+	}
+
+	/// Bitmask of the players having units in the bucket of the tile
+	unsigned int GetPlayerMask(const Vec2i &pos) const
+	{
+		return Masks[(pos.y >> BucketShift) * Width + (pos.x >> BucketShift)];
+	}
+
+	/// Last column of the bucket of the tile column
+	static int GetBucketLastX(int x) { return x | (BucketSize - 1); }
+
+private:
+	int Width;                          /// Number of buckets in a row
+	int Height;                         /// Number of buckets in a column
+	std::vector<unsigned int> Masks;    /// Players having units in each bucket
+	std::vector<unsigned short> Counts; /// Units of each player in each bucket
+};
+
 
 //@}
 
@@ -220,15 +220,31 @@ void Select(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units)
 void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units);
 void SelectAroundUnit(const CUnit &unit, int range, std::vector<CUnit *> &around);
 
+/**
+**  Select the units in a rectangle of the map.
+**
+**  @param ltPos       Top left tile of the rectangle, on the map.
+**  @param rbPos       Bottom right tile of the rectangle, on the map.
+**  @param units       Filled with the selected units.
+**  @param pred        Predicate the units must satisfy.
+**  @param playerMask  Bitmask of the players whose units may satisfy
+**                     pred, the other buckets of the map are skipped.
+*/
 template <typename Pred>
-void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units, Pred pred)
+void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units, Pred pred,
+				 unsigned int playerMask = ~0u)
 {
 	Assert(Map.Info.IsPointOnMap(ltPos));
 	Assert(Map.Info.IsPointOnMap(rbPos));
 	Assert(units.empty());
 
 	for (Vec2i posIt = ltPos; posIt.y != rbPos.y + 1; ++posIt.y) {
-		for (posIt.x = ltPos.x; posIt.x != rbPos.x + 1; ++posIt.x) {
+		for (posIt.x = ltPos.x; posIt.x <= rbPos.x; ++posIt.x) {
+			if ((Map.UnitBuckets.GetPlayerMask(posIt) & playerMask) == 0) {
+				// Nothing to find in the rest of the bucket
+				posIt.x = CUnitBuckets::GetBucketLastX(posIt.x);
+				continue;
+			}
 			const CMapField &mf = *Map.Field(posIt);
 			const CUnitCache &cache = mf.UnitCache;
 
@@ -248,24 +264,26 @@ void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &u
 }
 
 template <typename Pred>
-void SelectAroundUnit(const CUnit &unit, int range, std::vector<CUnit *> &around, Pred pred)
+void SelectAroundUnit(const CUnit &unit, int range, std::vector<CUnit *> &around, Pred pred,
+					  unsigned int playerMask = ~0u)
 {
 	const Vec2i offset(range, range);
 	const Vec2i typeSize(unit.Type->TileWidth - 1, unit.Type->TileHeight - 1);
 
 	Select(unit.tilePos - offset,
 		   unit.tilePos + typeSize + offset, around,
-		   MakeAndPredicate(IsNotTheSameUnitAs(unit), pred));
+		   MakeAndPredicate(IsNotTheSameUnitAs(unit), pred), playerMask);
 }
 
 template <typename Pred>
-void Select(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units, Pred pred)
+void Select(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units, Pred pred,
+			unsigned int playerMask = ~0u)
 {
 	Vec2i minPos = ltPos;
 	Vec2i maxPos = rbPos;
 
 	Map.FixSelectionArea(minPos, maxPos);
-	SelectFixed(minPos, maxPos, units, pred);
+	SelectFixed(minPos, maxPos, units, pred, playerMask);
 }
 
 template <typename Pred>
@@ -275,7 +293,12 @@ CUnit *FindUnit_IfFixed(const Vec2i &ltPos, const Vec2i &rbPos, Pred pred)
 	Assert(Map.Info.IsPointOnMap(rbPos));
 
 	for (Vec2i posIt = ltPos; posIt.y != rbPos.y + 1; ++posIt.y) {
-		for (posIt.x = ltPos.x; posIt.x != rbPos.x + 1; ++posIt.x) {
+		for (posIt.x = ltPos.x; posIt.x <= rbPos.x; ++posIt.x) {
+			if (Map.UnitBuckets.GetPlayerMask(posIt) == 0) {
+				// No unit in the rest of the bucket
+				posIt.x = CUnitBuckets::GetBucketLastX(posIt.x);
+				continue;
+			}
 			const CMapField &mf = *Map.Field(posIt);
 			const CUnitCache &cache = mf.UnitCache;
 
@@ -337,6 +360,11 @@ extern CUnit *AttackUnitsInRange(const CUnit &unit);
 extern CUnit *AttackUnitsInReactRange(const CUnit &unit, CUnitFilter pred);
 extern CUnit *AttackUnitsInReactRange(const CUnit &unit);
 
+/// Cost bonus of the AiPriorityTarget flags of a type against a target type
+extern int AiPriorityTargetCost(const CUnitType &type, const CUnitType &dtype);
+/// Forget the cached AiPriorityTarget costs
+extern void CleanAiPriorityTargetCosts();
+
 
 
 //@}
@@ -155,6 +155,8 @@ class CPlayerColorGraphic : public CGraphic
 protected:
 	CPlayerColorGraphic()
 	{
+		memset(PlayerColorSurfaces, 0, sizeof(PlayerColorSurfaces));
+		memset(PlayerColorSurfaceUses, 0, sizeof(PlayerColorSurfaceUses));
 #if defined(USE_OPENGL) || defined(USE_GLES)
 		memset(PlayerColorTextures, 0, sizeof(PlayerColorTextures));
 #endif
@@ -164,11 +166,19 @@ public:
 	void DrawPlayerColorFrameClipX(int player, unsigned frame, int x, int y);
 	void DrawPlayerColorFrameClip(int player, unsigned frame, int x, int y);
 
+	void FreePlayerColorSurfaces();
+
 	static CPlayerColorGraphic *New(const std::string &file, int w = 0, int h = 0);
 	static CPlayerColorGraphic *ForceNew(const std::string &file, int w = 0, int h = 0);
 
 	CPlayerColorGraphic *Clone(bool grayscale = false) const;
 
+private:
+	SDL_Surface *GetPlayerColorSurface(int player, int flip);
+
+public:
+	SDL_Surface *PlayerColorSurfaces[PlayerMax][2];       /// Surfaces with player colors in the display format
+	unsigned long PlayerColorSurfaceUses[PlayerMax][2];  /// Last use of the surfaces with player colors
 #if defined(USE_OPENGL) || defined(USE_GLES)
 	GLuint *PlayerColorTextures[PlayerMax];/// Textures with player colors
 #endif
@@ -523,6 +533,11 @@ void DrawTexture(const CGraphic *g, GLuint *textures, int sx, int sy,
 				 int ex, int ey, int x, int y, int flip);
 #endif
 
+/// Size in bytes of the cache of the surfaces with player colors
+extern size_t PlayerColorSurfaceCacheSize;
+/// Free the cached surfaces with player colors of all graphics
+extern void FreeAllPlayerColorSurfaces();
+
 #ifdef DEBUG
 extern void FreeGraphics();
 #endif
@@ -548,6 +563,8 @@ extern void VideoPaletteListRemove(SDL_Surface *surface);
 extern void ClearAllColorCyclingRange();
 extern void AddColorCyclingRange(unsigned int begin, unsigned int end);
 extern void SetColorCycleAll(bool value);
+extern bool IsColorCycleAll();
+extern bool IsColorCycled(unsigned int index);
 extern void RestoreColorCyclingSurface();
 
 /// Does ColorCycling..
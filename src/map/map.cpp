@@ -39,6 +39,7 @@
 #include "map.h"
 
 #include "iolib.h"
+#include "pathfinder.h"
 #include "player.h"
 #include "tileset.h"
 #include "unit.h"
@@ -135,10 +136,11 @@ void CMap::Reveal()
 		CMapField &mf = *this->Field(i);
 		CMapFieldPlayerInfo &playerInfo = mf.playerInfo;
 		for (int p = 0; p < PlayerMax; ++p) {
-			playerInfo.Visible[p] = std::max<unsigned short>(1, playerInfo.Visible[p]);
+			playerInfo.Visible(p) = std::max<unsigned short>(1, playerInfo.Visible(p));
 		}
 		MarkSeenTile(mf);
 	}
+	InvalidateFogOfWar();
 	//  Global seen recount. Simple and effective.
 	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
 		CUnit &unit = **it;
@@ -325,7 +327,14 @@ void CMap::Create()
 {
 	Assert(!this->Fields);
 
-	this->Fields = new CMapField[this->Info.MapWidth * this->Info.MapHeight];
+	const unsigned int size = this->Info.MapWidth * this->Info.MapHeight;
+
+	this->Fields = new CMapField[size];
+	for (unsigned int i = 0; i != size; ++i) {
+		this->Fields[i].playerInfo.Index = i;
+	}
+	this->Sight.Init(size);
+	this->UnitBuckets.Init(this->Info.MapWidth, this->Info.MapHeight);
 }
 
 /**
@@ -348,9 +357,12 @@ void CMap::Clean()
 
 	this->Info.Clear();
 	this->Fields = NULL;
+	this->UnitBuckets.Clear();
+	this->Sight.Clean();
 	this->NoFogOfWar = false;
 	this->Tileset->clear();
 	this->TileModelsFileName.clear();
+	FreeTerrainCache();
 	CGraphic::Free(this->TileGraphic);
 	this->TileGraphic = NULL;
 
@@ -363,9 +375,11 @@ void CMap::Clean()
 /**
 ** Save the complete map.
 **
-** @param file Output file.
+** @param file          Output file.
+** @param binaryFields  Don't write the fields, they are in the binary
+**                      chunk of the save game (see CMap::SaveFields).
 */
-void CMap::Save(CFile &file) const
+void CMap::Save(CFile &file, bool binaryFields) const
 {
 	file.printf("\n--- -----------------------------------------\n");
 	file.printf("--- MODULE: map\n");
@@ -377,6 +391,10 @@ void CMap::Save(CFile &file) const
 	file.printf("  \"size\", {%d, %d},\n", this->Info.MapWidth, this->Info.MapHeight);
 	file.printf("  \"%s\",\n", this->NoFogOfWar ? "no-fog-of-war" : "fog-of-war");
 	file.printf("  \"filename\", \"%s\",\n", this->Info.Filename.c_str());
+	if (binaryFields) {
+		file.printf("  \"binary-map-fields\"})\n");
+		return;
+	}
 	file.printf("  \"map-fields\", {\n");
 	for (int h = 0; h < this->Info.MapHeight; ++h) {
 		file.printf("  -- %d\n", h);
@@ -394,6 +412,52 @@ void CMap::Save(CFile &file) const
 	file.printf("}})\n");
 }
 
+/**
+** Save the map fields in a binary chunk.
+**
+** The chunk starts with the map size, followed by one record per field.
+**
+** @param chunk  Output data.
+*/
+void CMap::SaveFields(std::string &chunk) const
+{
+	const unsigned int size = this->Info.MapWidth * this->Info.MapHeight;
+	std::vector<unsigned char> data(4 + size * CMapField::RecordSize);
+
+	data[0] = this->Info.MapWidth & 0xFF;
+	data[1] = this->Info.MapWidth >> 8;
+	data[2] = this->Info.MapHeight & 0xFF;
+	data[3] = this->Info.MapHeight >> 8;
+	for (unsigned int i = 0; i != size; ++i) {
+		this->Fields[i].SaveRecord(&data[4 + i * CMapField::RecordSize]);
+	}
+	chunk.assign(reinterpret_cast<const char *>(&data[0]), data.size());
+}
+
+/**
+** Load the map fields from a binary chunk.
+**
+** @param chunk  Data written by CMap::SaveFields.
+**
+** @return       false if the chunk doesn't match the map.
+*/
+bool CMap::LoadFields(const std::string &chunk)
+{
+	const unsigned char *data = reinterpret_cast<const unsigned char *>(chunk.data());
+	const unsigned int size = this->Info.MapWidth * this->Info.MapHeight;
+
+	if (chunk.size() != 4 + size * CMapField::RecordSize
+		|| (data[0] | (data[1] << 8)) != this->Info.MapWidth
+		|| (data[2] | (data[3] << 8)) != this->Info.MapHeight) {
+		fprintf(stderr, "Wrong map fields chunk size: %d\n", (int)chunk.size());
+		return false;
+	}
+	for (unsigned int i = 0; i != size; ++i) {
+		this->Fields[i].parseRecord(data + 4 + i * CMapField::RecordSize);
+	}
+	return true;
+}
+
 /*----------------------------------------------------------------------------
 -- Map Tile Update Functions
 ----------------------------------------------------------------------------*/
@@ -478,6 +542,7 @@ void CMap::FixTile(unsigned short type, int seen, const Vec2i &pos)
 			mf.Flags &= ~flags;
 			mf.Value = 0;
 			UI.Minimap.UpdateXY(pos);
+			PathfinderTerrainChanged(pos, 1, 1);
 		}
 	} else if (seen && this->Tileset->isEquivalentTile(tile, mf.playerInfo.SeenTile)) { //Same Type
 		return;
@@ -526,6 +591,7 @@ void CMap::ClearWoodTile(const Vec2i &pos)
 	mf.Value = 0;
 
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, 1, 1);
 	FixNeighbors(MapFieldForest, 0, pos);
 
 	//maybe isExplored
@@ -544,6 +610,7 @@ void CMap::ClearRockTile(const Vec2i &pos)
 	mf.Value = 0;
 
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, 1, 1);
 	FixNeighbors(MapFieldRocks, 0, pos);
 
 	//maybe isExplored
@@ -605,6 +672,7 @@ void CMap::RegenerateForestTile(const Vec2i &pos)
 		mf.Flags |= MapFieldForest | MapFieldUnpassable;
 		UI.Minimap.UpdateSeenXY(pos);
 		UI.Minimap.UpdateXY(pos);
+		PathfinderTerrainChanged(pos + offset, 1, 2);
 		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 			MarkSeenTile(mf);
 		}
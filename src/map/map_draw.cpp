@@ -43,7 +43,43 @@
 #include "unittype.h"
 #include "ui.h"
 #include "video.h"
+#include "../video/intern_video.h"
 
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/// Size in tiles of a chunk of the terrain cache
+static const int TerrainChunkSize = 16;
+/// Number of chunks kept in the terrain cache, more if a viewport needs them
+static const size_t TerrainChunkMax = 48;
+/// Tile number of a field not drawn in its chunk
+static const unsigned short TerrainTileNone = 0xFFFF;
+
+/**
+**  Chunk of the map terrain, drawn in a surface of the screen format.
+*/
+struct TerrainChunk {
+	SDL_Surface *Surface;    /// Drawn terrain of the chunk
+	Vec2i Pos;               /// Position of the chunk in chunks
+	unsigned long LastUse;   /// Last use of the chunk
+	unsigned short Tiles[TerrainChunkSize * TerrainChunkSize]; /// Tiles drawn in the surface
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+static std::vector<TerrainChunk *> TerrainChunks;    /// Cached chunk of each position, or NULL
+static std::vector<TerrainChunk *> TerrainChunkPool; /// All allocated chunks
+static Vec2i TerrainChunkCount;                      /// Number of chunks of the map
+static const CGraphic *TerrainChunkGraphic;          /// Tile graphic of the cached chunks
+static unsigned long TerrainChunkClock;              /// Counter of the uses of the chunks
+static std::vector<bool> TerrainTileCycled;          /// Tiles using colors of the color cycling
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
 
 CViewport::CViewport() : MapWidth(0), MapHeight(0), Unit(NULL)
 {
@@ -211,6 +247,210 @@ void CViewport::Center(const PixelPos &mapPixelPos)
 	this->Set(mapPixelPos - this->GetPixelSize() / 2);
 }
 
+/**
+**  Free the cached terrain chunks.
+*/
+void FreeTerrainCache()
+{
+	for (size_t i = 0; i != TerrainChunkPool.size(); ++i) {
+		SDL_FreeSurface(TerrainChunkPool[i]->Surface);
+		delete TerrainChunkPool[i];
+	}
+	TerrainChunkPool.clear();
+	TerrainChunks.clear();
+	TerrainChunkCount.x = TerrainChunkCount.y = 0;
+	TerrainChunkGraphic = NULL;
+	TerrainTileCycled.clear();
+}
+
+/**
+**  Find the tiles of the paletted tile graphic which use colors of the
+**  color cycling.
+*/
+static void FindTerrainCycledTiles()
+{
+	const CGraphic &g = *Map.TileGraphic;
+	bool cycled[256];
+
+	for (int i = 0; i != 256; ++i) {
+		cycled[i] = IsColorCycled(i);
+	}
+	TerrainTileCycled.assign(g.NumFrames, false);
+	SDL_LockSurface(g.Surface);
+	for (int frame = 0; frame != g.NumFrames; ++frame) {
+		for (int y = 0; y < g.Height && !TerrainTileCycled[frame]; ++y) {
+			const Uint8 *p = static_cast<const Uint8 *>(g.Surface->pixels)
+							 + (g.frame_map[frame].y + y) * g.Surface->pitch + g.frame_map[frame].x;
+
+			for (int x = 0; x < g.Width; ++x) {
+				if (cycled[p[x]]) {
+					TerrainTileCycled[frame] = true;
+					break;
+				}
+			}
+		}
+	}
+	SDL_UnlockSurface(g.Surface);
+}
+
+/**
+**  Redraw the fields of the cached chunks whose tile uses colors of the
+**  color cycling, the palette of the tile graphic changed.
+**
+**  The fields are only marked, they are redrawn with the next update of
+**  their chunk.
+*/
+void RedrawTerrainCycledTiles()
+{
+	if (TerrainChunkPool.empty() || TerrainChunkGraphic != Map.TileGraphic
+		|| Map.TileGraphic->Surface->format->BytesPerPixel != 1) {
+		return;
+	}
+	if (TerrainTileCycled.empty()) {
+		FindTerrainCycledTiles();
+	}
+	for (size_t i = 0; i != TerrainChunkPool.size(); ++i) {
+		unsigned short *tiles = TerrainChunkPool[i]->Tiles;
+
+		for (int j = 0; j != TerrainChunkSize * TerrainChunkSize; ++j) {
+			if (tiles[j] < TerrainTileCycled.size() && TerrainTileCycled[tiles[j]]) {
+				tiles[j] = TerrainTileNone;
+			}
+		}
+	}
+}
+
+/**
+**  Get the cached chunk of a position, reusing the least recently used
+**  chunk or allocating a new one if it isn't cached.
+**
+**  @param chunkPos  Position of the chunk in chunks.
+**  @param minUse    Chunks used since minUse are drawn in the current
+**                   viewport and aren't reused.
+**
+**  @return          The chunk, its tiles must be updated.
+*/
+static TerrainChunk &GetTerrainChunk(const Vec2i &chunkPos, unsigned long minUse)
+{
+	TerrainChunk *&cached = TerrainChunks[chunkPos.x + chunkPos.y * TerrainChunkCount.x];
+
+	if (cached) {
+		cached->LastUse = ++TerrainChunkClock;
+		return *cached;
+	}
+	TerrainChunk *chunk = NULL;
+	if (TerrainChunkPool.size() >= TerrainChunkMax) {
+		for (size_t i = 0; i != TerrainChunkPool.size(); ++i) {
+			TerrainChunk *c = TerrainChunkPool[i];
+			if (c->LastUse < minUse && (!chunk || c->LastUse < chunk->LastUse)) {
+				chunk = c;
+			}
+		}
+	}
+	if (chunk) {
+		TerrainChunks[chunk->Pos.x + chunk->Pos.y * TerrainChunkCount.x] = NULL;
+	} else {
+		// Chunks at the edge of the map use the same size, the surface is only partly drawn
+		const SDL_PixelFormat *f = TheScreen->format;
+		chunk = new TerrainChunk;
+		chunk->Surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
+											  TerrainChunkSize * PixelTileSize.x, TerrainChunkSize * PixelTileSize.y,
+											  f->BitsPerPixel, f->Rmask, f->Gmask, f->Bmask, 0);
+		TerrainChunkPool.push_back(chunk);
+	}
+	std::fill(chunk->Tiles, chunk->Tiles + TerrainChunkSize * TerrainChunkSize, TerrainTileNone);
+	chunk->Pos = chunkPos;
+	chunk->LastUse = ++TerrainChunkClock;
+	cached = chunk;
+	return *chunk;
+}
+
+/**
+**  Redraw the fields of a chunk whose tile changed since the last update.
+**
+**  @param chunk  Chunk to update.
+*/
+static void UpdateTerrainChunk(TerrainChunk &chunk)
+{
+	const Vec2i start(chunk.Pos.x * TerrainChunkSize, chunk.Pos.y * TerrainChunkSize);
+	const int w = std::min(TerrainChunkSize, Map.Info.MapWidth - start.x);
+	const int h = std::min(TerrainChunkSize, Map.Info.MapHeight - start.y);
+	const CGraphic &g = *Map.TileGraphic;
+
+	for (int y = 0; y < h; ++y) {
+		const CMapField *mf = Map.Field(start.x, start.y + y);
+		unsigned short *drawn = chunk.Tiles + y * TerrainChunkSize;
+
+		for (int x = 0; x < w; ++x, ++mf) {
+			const unsigned short tile = ReplayRevealMap ? mf->getGraphicTile() : mf->playerInfo.SeenTile;
+
+			if (drawn[x] == tile) {
+				continue;
+			}
+			drawn[x] = tile;
+			SDL_Rect srect = {g.frame_map[tile].x, g.frame_map[tile].y, Uint16(g.Width), Uint16(g.Height)};
+			SDL_Rect drect = {Sint16(x * PixelTileSize.x), Sint16(y * PixelTileSize.y), 0, 0};
+			SDL_BlitSurface(g.Surface, &srect, chunk.Surface, &drect);
+		}
+	}
+}
+
+/**
+**  Draw a chunk clipped.
+**
+**  @param chunk  Chunk to draw.
+**  @param x      X screen position of the chunk.
+**  @param y      Y screen position of the chunk.
+*/
+static void DrawTerrainChunk(const TerrainChunk &chunk, int x, int y)
+{
+	int w = std::min(TerrainChunkSize, Map.Info.MapWidth - chunk.Pos.x * TerrainChunkSize) * PixelTileSize.x;
+	int h = std::min(TerrainChunkSize, Map.Info.MapHeight - chunk.Pos.y * TerrainChunkSize) * PixelTileSize.y;
+	const int oldx = x;
+	const int oldy = y;
+
+	CLIP_RECTANGLE(x, y, w, h);
+	SDL_Rect srect = {Sint16(x - oldx), Sint16(y - oldy), Uint16(w), Uint16(h)};
+	SDL_Rect drect = {Sint16(x), Sint16(y), 0, 0};
+	SDL_BlitSurface(chunk.Surface, &srect, TheScreen, &drect);
+}
+
+/**
+**  Draw the map background from the terrain chunks.
+**
+**  The chunks keep the tiles they were drawn with, only the fields whose
+**  tile changed since (cut forest, destroyed wall, explored field) or
+**  whose colors cycled are redrawn, then each chunk is a single blit.
+**
+**  @param vp  Viewport to draw.
+*/
+static void DrawTerrainChunks(const CViewport &vp)
+{
+	if (TerrainChunkGraphic != Map.TileGraphic
+		|| TerrainChunkCount.x != (Map.Info.MapWidth + TerrainChunkSize - 1) / TerrainChunkSize
+		|| TerrainChunkCount.y != (Map.Info.MapHeight + TerrainChunkSize - 1) / TerrainChunkSize) {
+		FreeTerrainCache();
+		TerrainChunkGraphic = Map.TileGraphic;
+		TerrainChunkCount.x = (Map.Info.MapWidth + TerrainChunkSize - 1) / TerrainChunkSize;
+		TerrainChunkCount.y = (Map.Info.MapHeight + TerrainChunkSize - 1) / TerrainChunkSize;
+		TerrainChunks.resize(TerrainChunkCount.x * TerrainChunkCount.y, NULL);
+	}
+	const unsigned long minUse = TerrainChunkClock + 1;
+	const Vec2i start(std::max<int>(vp.MapPos.x, 0) / TerrainChunkSize, std::max<int>(vp.MapPos.y, 0) / TerrainChunkSize);
+	const Vec2i end(std::min((vp.MapPos.x + vp.MapWidth) / TerrainChunkSize, TerrainChunkCount.x - 1),
+					std::min((vp.MapPos.y + vp.MapHeight) / TerrainChunkSize, TerrainChunkCount.y - 1));
+
+	for (Vec2i chunkPos(start.x, start.y); chunkPos.y <= end.y; ++chunkPos.y) {
+		for (chunkPos.x = start.x; chunkPos.x <= end.x; ++chunkPos.x) {
+			TerrainChunk &chunk = GetTerrainChunk(chunkPos, minUse);
+			const PixelPos screenPos = vp.TilePosToScreen_TopLeft(chunkPos * TerrainChunkSize);
+
+			UpdateTerrainChunk(chunk);
+			DrawTerrainChunk(chunk, screenPos.x, screenPos.y);
+		}
+	}
+}
+
 /**
 **  Draw the map backgrounds.
 **
@@ -238,41 +478,47 @@ void CViewport::Center(const PixelPos &mapPixelPos)
 */
 void CViewport::DrawMapBackgroundInViewport() const
 {
-	int ex = this->BottomRightPos.x;
-	int ey = this->BottomRightPos.y;
-	int sy = this->MapPos.y;
-	int dy = this->TopLeftPos.y - this->Offset.y;
-	const int map_max = Map.Info.MapWidth * Map.Info.MapHeight;
-
-	while (sy  < 0) {
-		sy++;
-		dy += PixelTileSize.y;
-	}
-	sy *=  Map.Info.MapWidth;
-
-	while (dy <= ey && sy  < map_max) {
-		int sx = this->MapPos.x + sy;
-		int dx = this->TopLeftPos.x - this->Offset.x;
-		while (dx <= ex && (sx - sy < Map.Info.MapWidth)) {
-			if (sx - sy < 0) {
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	if (UseOpenGL) {
+		int ex = this->BottomRightPos.x;
+		int ey = this->BottomRightPos.y;
+		int sy = this->MapPos.y;
+		int dy = this->TopLeftPos.y - this->Offset.y;
+		const int map_max = Map.Info.MapWidth * Map.Info.MapHeight;
+
+		while (sy  < 0) {
+			sy++;
+			dy += PixelTileSize.y;
+		}
+		sy *=  Map.Info.MapWidth;
+
+		while (dy <= ey && sy  < map_max) {
+			int sx = this->MapPos.x + sy;
+			int dx = this->TopLeftPos.x - this->Offset.x;
+			while (dx <= ex && (sx - sy < Map.Info.MapWidth)) {
+				if (sx - sy < 0) {
+					++sx;
+					dx += PixelTileSize.x;
+					continue;
+				}
+				const CMapField &mf = Map.Fields[sx];
+				unsigned short int tile;
+				if (ReplayRevealMap) {
+					tile = mf.getGraphicTile();
+				} else {
+					tile = mf.playerInfo.SeenTile;
+				}
+				Map.TileGraphic->DrawFrameClip(tile, dx, dy);
 				++sx;
 				dx += PixelTileSize.x;
-				continue;
 			}
-			const CMapField &mf = Map.Fields[sx];
-			unsigned short int tile;
-			if (ReplayRevealMap) {
-				tile = mf.getGraphicTile();
-			} else {
-				tile = mf.playerInfo.SeenTile;
-			}
-			Map.TileGraphic->DrawFrameClip(tile, dx, dy);
-			++sx;
-			dx += PixelTileSize.x;
+			sy += Map.Info.MapWidth;
+			dy += PixelTileSize.y;
 		}
-		sy += Map.Info.MapWidth;
-		dy += PixelTileSize.y;
+		return;
 	}
+#endif
+	DrawTerrainChunks(*this);
 }
 
 /**
@@ -65,9 +65,17 @@ static const int FogTable[16] = {
 	0, 11, 10, 2,  13, 6, 14, 3,  12, 15, 4, 1,  8, 9, 7, 0,
 };
 
+/// Team visibility state of ThisPlayer of each field, as drawn
 static std::vector<unsigned short> VisibleTable;
+/// Fog tile of each field, low nibble, and black fog tile, high nibble
+static std::vector<unsigned char> FogOfWarTiles;
+/// Fields whose visibility changed since the last draw
+static std::vector<unsigned int> FogOfWarChanges;
+/// Recompute the fog of war of all the fields at the next draw
+static bool FogOfWarRefresh;
+static const CPlayer *FogOfWarPlayer;  /// Player of the computed fog of war
+static bool FogOfWarNoFog;             /// Map.NoFogOfWar of the computed fog of war
 
-static SDL_Surface *OnlyFogSurface;
 static CGraphic *AlphaFogG;
 
 /*----------------------------------------------------------------------------
@@ -207,6 +215,39 @@ static void UnitsOnTileUnmarkSeen(const CPlayer &player, CMapField &mf, int cloa
 }
 
 
+/**
+**  Record a field whose visibility changed for a player, the fog of war
+**  of the field and its neighbors is recomputed at the next draw.
+**
+**  @param player  Player whose visibility changed.
+**  @param index   Index of the field.
+*/
+static void FogOfWarChanged(const CPlayer &player, unsigned int index)
+{
+	if (FogOfWarRefresh || !ThisPlayer
+		|| (player.Index != ThisPlayer->Index && !ThisPlayer->IsBothSharedVision(player))) {
+		return;
+	}
+	// After many changes, recomputing all the fields is faster
+	if (FogOfWarChanges.size() >= VisibleTable.size() / 4) {
+		InvalidateFogOfWar();
+		return;
+	}
+	FogOfWarChanges.push_back(index);
+}
+
+/**
+**  Recompute the fog of war of all the fields at the next draw.
+**
+**  Must be called when the visibility changes without the marking
+**  functions: shared vision, revealed map, ...
+*/
+void InvalidateFogOfWar()
+{
+	FogOfWarRefresh = true;
+	FogOfWarChanges.clear();
+}
+
 /**
 **  Mark a tile's sight. (Explore and make visible.)
 **
@@ -216,13 +257,14 @@ static void UnitsOnTileUnmarkSeen(const CPlayer &player, CMapField &mf, int cloa
 void MapMarkTileSight(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &(mf.playerInfo.Visible[player.Index]);
+	unsigned short *v = &Map.Sight.Visible[player.Index][index];
 	if (*v == 0 || *v == 1) { // Unexplored or unseen
 		// When there is no fog only unexplored tiles are marked.
 		if (!Map.NoFogOfWar || *v == 0) {
 			UnitsOnTileMarkSeen(player, mf, 0);
 		}
 		*v = 2;
+		FogOfWarChanged(player, index);
 		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 			Map.MarkSeenTile(mf);
 		}
@@ -247,7 +289,7 @@ void MapMarkTileSight(const CPlayer &player, const Vec2i &pos)
 void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &mf.playerInfo.Visible[player.Index];
+	unsigned short *v = &Map.Sight.Visible[player.Index][index];
 	switch (*v) {
 		case 0:  // Unexplored
 		case 1:
@@ -258,6 +300,7 @@ void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 			if (!Map.NoFogOfWar) {
 				UnitsOnTileUnmarkSeen(player, mf, 0);
 			}
+			FogOfWarChanged(player, index);
 			// Check visible Tile, then deduct...
 			if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 				Map.MarkSeenTile(mf);
@@ -283,7 +326,7 @@ void MapUnmarkTileSight(const CPlayer &player, const Vec2i &pos)
 void MapMarkTileDetectCloak(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned char *v = &mf.playerInfo.VisCloak[player.Index];
+	unsigned char *v = &Map.Sight.VisCloak[player.Index][index];
 	if (*v == 0) {
 		UnitsOnTileMarkSeen(player, mf, 1);
 	}
@@ -305,7 +348,7 @@ void MapMarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
 void MapUnmarkTileDetectCloak(const CPlayer &player, const unsigned int index)
 {
 	CMapField &mf = *Map.Field(index);
-	unsigned char *v = &mf.playerInfo.VisCloak[player.Index];
+	unsigned char *v = &Map.Sight.VisCloak[player.Index][index];
 	Assert(*v != 0);
 	if (*v == 1) {
 		UnitsOnTileUnmarkSeen(player, mf, 1);
@@ -318,6 +361,73 @@ void MapUnmarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
 	MapUnmarkTileDetectCloak(player, Map.getIndex(pos));
 }
 
+/**
+**  Half widths of the sight circles, by range.
+**
+**  SightCircles[range][dy] is the number of fields marked on each side of
+**  the unit on the row dy fields above or below it.
+*/
+static std::vector<std::vector<int> > SightCircles;
+
+/**
+**  Get the half widths of the sight circle of a range.
+**
+**  @param range  Radius of the circle.
+**
+**  @return       The half width of each row, from the center to the border.
+*/
+static const std::vector<int> &SightCircle(int range)
+{
+	if (range >= (int)SightCircles.size()) {
+		SightCircles.resize(range + 1);
+	}
+	std::vector<int> &circle = SightCircles[range];
+	if (circle.empty()) {
+		circle.resize(range + 1);
+		for (int offsety = 0; offsety <= range; ++offsety) {
+			circle[offsety] = isqrt(square(range + 1) - square(offsety) - 1);
+		}
+	}
+	return circle;
+}
+
+/**
+**  Mark or unmark a row of fields.
+**
+**  Rows of normal sight are handled at once when no field becomes
+**  visible or fogged, the others field by field.
+**
+**  @param player  player to mark the sight for
+**  @param pos     first field of the row
+**  @param count   number of fields to mark
+**  @param marker  Function to mark or unmark sight
+*/
+static void MapSightRow(const CPlayer &player, const Vec2i &pos, int count, MapMarkerFunc *marker)
+{
+	if (count <= 0) {
+		return;
+	}
+	const unsigned int index = Map.getIndex(pos);
+
+	if (marker == static_cast<MapMarkerFunc *>(MapMarkTileSight)) {
+		if (Map.Sight.MarkSeenRow(player.Index, index, count)) {
+			return;
+		}
+	} else if (marker == static_cast<MapMarkerFunc *>(MapUnmarkTileSight)) {
+		if (Map.Sight.UnmarkSeenRow(player.Index, index, count)) {
+			return;
+		}
+	}
+	Vec2i mpos(pos);
+	for (int i = 0; i != count; ++i, ++mpos.x) {
+#ifdef MARKER_ON_INDEX
+		marker(player, index + i);
+#else
+		marker(player, mpos);
+#endif
+	}
+}
+
 /**
 **  Mark the sight of unit. (Explore and make visible.)
 **
@@ -334,59 +444,107 @@ void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range,
 	if (!range) {
 		return;
 	}
+	const std::vector<int> &circle = SightCircle(range);
+
 	// Up hemi-cyle
 	const int miny = std::max(-range, 0 - pos.y);
 	for (int offsety = miny; offsety != 0; ++offsety) {
-		const int offsetx = isqrt(square(range + 1) - square(-offsety) - 1);
+		const int offsetx = circle[-offsety];
 		const int minx = std::max(0, pos.x - offsetx);
 		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
-		Vec2i mpos(minx, pos.y + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
-		}
+		MapSightRow(player, Vec2i(minx, pos.y + offsety), maxx - minx, marker);
 	}
 	for (int offsety = 0; offsety < h; ++offsety) {
 		const int minx = std::max(0, pos.x - range);
 		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + range);
-		Vec2i mpos(minx, pos.y + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
-		}
+		MapSightRow(player, Vec2i(minx, pos.y + offsety), maxx - minx, marker);
 	}
 	// bottom hemi-cycle
 	const int maxy = std::min(range, Map.Info.MapHeight - pos.y - h);
 	for (int offsety = 0; offsety < maxy; ++offsety) {
-		const int offsetx = isqrt(square(range + 1) - square(offsety) - 1);
+		const int offsetx = circle[offsety];
 		const int minx = std::max(0, pos.x - offsetx);
 		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
-		Vec2i mpos(minx, pos.y + h + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
+		MapSightRow(player, Vec2i(minx, pos.y + h + offsety), maxx - minx, marker);
+	}
+}
+
+/**
+**  Get the fields of a map row in the sight of a unit.
+**
+**  @param pos     location of the unit
+**  @param w       width of the unit, in square
+**  @param h       height of the unit, in square
+**  @param range   Radius of the sight.
+**  @param y       row of the map.
+**  @param minx    first field of the row in sight.
+**  @param maxx    field after the last one in sight.
+**
+**  @return        false if no field of the row is in sight.
+*/
+static bool SightRowSpan(const Vec2i &pos, int w, int h, int range, int y, int *minx, int *maxx)
+{
+	int offsetx;
+
+	if (y < pos.y - range || y >= pos.y + h + range) {
+		return false;
+	} else if (y < pos.y) {
+		offsetx = SightCircle(range)[pos.y - y];
+	} else if (y < pos.y + h) {
+		offsetx = range;
+	} else {
+		offsetx = SightCircle(range)[y - pos.y - h];
+	}
+	*minx = std::max(0, pos.x - offsetx);
+	*maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
+	return *minx < *maxx;
+}
+
+/**
+**  Mark the sight changes of a moving unit.
+**
+**  Only the fields in sight at pos and not in sight at otherPos are
+**  (un)marked, the fields seen from both locations keep their counts.
+**  Unmark with the old location as pos before the move, and mark with
+**  the new location as pos after it.
+**
+**  @param player    player to mark the sight for (not unit owner)
+**  @param pos       location to mark
+**  @param otherPos  other location of the move
+**  @param w         width to mark, in square
+**  @param h         height to mark, in square
+**  @param range     Radius to mark.
+**  @param marker    Function to mark or unmark sight
+*/
+void MapSightDelta(const CPlayer &player, const Vec2i &pos, const Vec2i &otherPos,
+				   int w, int h, int range, MapMarkerFunc *marker)
+{
+	// Units under construction have no sight range.
+	if (!range) {
+		return;
+	}
+	const int miny = std::max(0, pos.y - range);
+	const int maxy = std::min(Map.Info.MapHeight, pos.y + h + range);
+
+	for (int y = miny; y < maxy; ++y) {
+		int minx;
+		int maxx;
+		if (!SightRowSpan(pos, w, h, range, y, &minx, &maxx)) {
+			continue;
+		}
+		int otherMinx;
+		int otherMaxx;
+		if (!SightRowSpan(otherPos, w, h, range, y, &otherMinx, &otherMaxx)
+			|| otherMaxx <= minx || maxx <= otherMinx) {
+			MapSightRow(player, Vec2i(minx, y), maxx - minx, marker);
+			continue;
 		}
+		// The fields on the left, then on the right of the other sight.
+		MapSightRow(player, Vec2i(minx, y), otherMinx - minx, marker);
+		MapSightRow(player, Vec2i(otherMaxx, y), maxx - otherMaxx, marker);
 	}
 }
 
@@ -396,6 +554,7 @@ void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range,
 void UpdateFogOfWarChange()
 {
 	DebugPrint("::UpdateFogOfWarChange\n");
+	InvalidateFogOfWar();
 	//  Mark all explored fields as visible again.
 	if (Map.NoFogOfWar) {
 		const unsigned int w = Map.Info.MapHeight * Map.Info.MapWidth;
@@ -432,26 +591,7 @@ void VideoDrawOnlyFog(int x, int y)
 	} else
 #endif
 	{
-		int oldx;
-		int oldy;
-		SDL_Rect srect;
-		SDL_Rect drect;
-
-		srect.x = 0;
-		srect.y = 0;
-		srect.w = OnlyFogSurface->w;
-		srect.h = OnlyFogSurface->h;
-
-		oldx = x;
-		oldy = y;
-		CLIP_RECTANGLE(x, y, srect.w, srect.h);
-		srect.x += x - oldx;
-		srect.y += y - oldy;
-
-		drect.x = x;
-		drect.y = y;
-
-		SDL_BlitSurface(OnlyFogSurface, &srect, TheScreen, &drect);
+		Video.FillTransRectangleClip(FogOfWarColorSDL, x, y, PixelTileSize.x, PixelTileSize.y, FogOfWarOpacity);
 	}
 }
 
@@ -582,16 +722,13 @@ static void GetFogOfWarTile(int sx, int sy, int *fogTile, int *blackFogTile)
 **  Draw fog of war tile.
 **
 **  @param sx  Offset into fields to current tile.
-**  @param sy  Start of the current row.
 **  @param dx  X position into video memory.
 **  @param dy  Y position into video memory.
 */
-static void DrawFogOfWarTile(int sx, int sy, int dx, int dy)
+static void DrawFogOfWarTile(int sx, int dx, int dy)
 {
-	int fogTile = 0;
-	int blackFogTile = 0;
-
-	GetFogOfWarTile(sx, sy, &fogTile, &blackFogTile);
+	const int fogTile = FogOfWarTiles[sx] & 0x0F;
+	const int blackFogTile = FogOfWarTiles[sx] >> 4;
 
 	if (IsMapFieldVisibleTable(sx) || ReplayRevealMap) {
 		if (fogTile && fogTile != blackFogTile) {
@@ -615,8 +752,79 @@ static void DrawFogOfWarTile(int sx, int sy, int dx, int dy)
 #undef IsMapFieldVisibleTable
 }
 
+/**
+**  Compute the fog tiles of a field and of its neighbors.
+**
+**  @param index  Index of the field.
+*/
+static void UpdateFogOfWarTiles(unsigned int index)
+{
+	const int w = Map.Info.MapWidth;
+	const int x = index % w;
+	const int y = index / w;
+
+	for (int j = std::max(y - 1, 0); j <= std::min(y + 1, Map.Info.MapHeight - 1); ++j) {
+		for (int i = std::max(x - 1, 0); i <= std::min(x + 1, w - 1); ++i) {
+			int fogTile;
+			int blackFogTile;
+
+			GetFogOfWarTile(i + j * w, j * w, &fogTile, &blackFogTile);
+			FogOfWarTiles[i + j * w] = fogTile | (blackFogTile << 4);
+		}
+	}
+}
+
+/**
+**  Update the visibility and the fog tiles of the fields whose visibility
+**  changed since the last draw, or of all the fields after an invalidation.
+*/
+static void UpdateFogOfWar()
+{
+	const unsigned int size = VisibleTable.size();
+
+	if (FogOfWarPlayer != ThisPlayer || FogOfWarNoFog != Map.NoFogOfWar) {
+		FogOfWarPlayer = ThisPlayer;
+		FogOfWarNoFog = Map.NoFogOfWar;
+		InvalidateFogOfWar();
+	}
+	if (FogOfWarRefresh) {
+		const int w = Map.Info.MapWidth;
+
+		for (unsigned int i = 0; i != size; ++i) {
+			VisibleTable[i] = Map.Field(i)->playerInfo.TeamVisibilityState(*ThisPlayer);
+		}
+		for (unsigned int i = 0; i != size; ++i) {
+			int fogTile;
+			int blackFogTile;
+
+			GetFogOfWarTile(i, i - i % w, &fogTile, &blackFogTile);
+			FogOfWarTiles[i] = fogTile | (blackFogTile << 4);
+		}
+		FogOfWarRefresh = false;
+		return;
+	}
+	// Only the fields whose state really changed update their neighbors
+	size_t changed = 0;
+	for (size_t i = 0; i != FogOfWarChanges.size(); ++i) {
+		const unsigned int index = FogOfWarChanges[i];
+		const unsigned short state = Map.Field(index)->playerInfo.TeamVisibilityState(*ThisPlayer);
+
+		if (VisibleTable[index] != state) {
+			VisibleTable[index] = state;
+			FogOfWarChanges[changed++] = index;
+		}
+	}
+	for (size_t i = 0; i != changed; ++i) {
+		UpdateFogOfWarTiles(FogOfWarChanges[i]);
+	}
+	FogOfWarChanges.clear();
+}
+
 /**
 **  Draw the map fog of war.
+**
+**  The visibility and the fog tiles are kept between the frames, only the
+**  fields whose visibility changed are recomputed.
 */
 void CViewport::DrawMapFogOfWar() const
 {
@@ -624,33 +832,19 @@ void CViewport::DrawMapFogOfWar() const
 	if (ReplayRevealMap) {
 		return;
 	}
+	UpdateFogOfWar();
 
-	int sx = std::max<int>(MapPos.x - 1, 0);
-	int ex = std::min<int>(MapPos.x + MapWidth + 1, Map.Info.MapWidth);
-	int my = std::max<int>(MapPos.y - 1, 0);
-	int ey = std::min<int>(MapPos.y + MapHeight + 1, Map.Info.MapHeight);
-
-	// Update for visibility all tile in viewport
-	// and 1 tile around viewport (for fog-of-war connection display)
-
-	unsigned int my_index = my * Map.Info.MapWidth;
-	for (; my < ey; ++my) {
-		for (int mx = sx; mx < ex; ++mx) {
-			VisibleTable[my_index + mx] = Map.Field(mx + my_index)->playerInfo.TeamVisibilityState(*ThisPlayer);
-		}
-		my_index += Map.Info.MapWidth;
-	}
-	ex = this->BottomRightPos.x;
+	const int ex = this->BottomRightPos.x;
+	const int ey = this->BottomRightPos.y;
 	int sy = MapPos.y * Map.Info.MapWidth;
 	int dy = this->TopLeftPos.y - Offset.y;
-	ey = this->BottomRightPos.y;
 
 	while (dy <= ey) {
-		sx = MapPos.x + sy;
+		int sx = MapPos.x + sy;
 		int dx = this->TopLeftPos.x - Offset.x;
 		while (dx <= ex) {
 			if (VisibleTable[sx]) {
-				DrawFogOfWarTile(sx, sy, dx, dy);
+				DrawFogOfWarTile(sx, dx, dy);
 			} else {
 				Video.FillRectangleClip(FogOfWarColorSDL, dx, dy, PixelTileSize.x, PixelTileSize.y);
 			}
@@ -680,21 +874,6 @@ void CMap::InitFogOfWar()
 	if (!UseOpenGL)
 #endif
 	{
-		//
-		// Generate Only Fog surface.
-		//
-		s = SDL_CreateRGBSurface(SDL_SWSURFACE, PixelTileSize.x, PixelTileSize.y,
-								 32, RMASK, GMASK, BMASK, AMASK);
-
-		SDL_GetRGB(FogOfWarColorSDL, TheScreen->format, &r, &g, &b);
-		Uint32 color = Video.MapRGB(s->format, r, g, b);
-
-		SDL_FillRect(s, NULL, color);
-		OnlyFogSurface = SDL_DisplayFormat(s);
-		SDL_SetAlpha(OnlyFogSurface, SDL_SRCALPHA | SDL_RLEACCEL, FogOfWarOpacity);
-		VideoPaletteListRemove(s);
-		SDL_FreeSurface(s);
-
 		//
 		// Generate Alpha Fog surface.
 		//
@@ -745,6 +924,9 @@ void CMap::InitFogOfWar()
 
 	VisibleTable.clear();
 	VisibleTable.resize(Info.MapWidth * Info.MapHeight);
+	FogOfWarTiles.clear();
+	FogOfWarTiles.resize(Info.MapWidth * Info.MapHeight);
+	InvalidateFogOfWar();
 }
 
 /**
@@ -753,6 +935,8 @@ void CMap::InitFogOfWar()
 void CMap::CleanFogOfWar()
 {
 	VisibleTable.clear();
+	FogOfWarTiles.clear();
+	FogOfWarChanges.clear();
 
 	CGraphic::Free(Map.FogGraphic);
 	FogGraphic = NULL;
@@ -761,11 +945,6 @@ void CMap::CleanFogOfWar()
 	if (!UseOpenGL)
 #endif
 	{
-		if (OnlyFogSurface) {
-			VideoPaletteListRemove(OnlyFogSurface);
-			SDL_FreeSurface(OnlyFogSurface);
-			OnlyFogSurface = NULL;
-		}
 		CGraphic::Free(AlphaFogG);
 		AlphaFogG = NULL;
 	}
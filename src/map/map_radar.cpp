@@ -49,31 +49,29 @@
 static inline unsigned char
 IsTileRadarVisible(const CPlayer &pradar, const CPlayer &punit, const CMapFieldPlayerInfo &mfp)
 {
-	if (mfp.RadarJammer[punit.Index]) {
+	if (mfp.RadarJammer(punit.Index)) {
 		return 0;
 	}
 
 	int p = pradar.Index;
 	if (pradar.IsVisionSharing()) {
-		const unsigned char *const radar = mfp.Radar;
-		const unsigned char *const jamming = mfp.RadarJammer;
 		unsigned char radarvision = 0;
 		// Check jamming first, if we are jammed, exit
 		for (int i = 0; i < PlayerMax; ++i) {
 			if (i != p) {
-				if (jamming[i] > 0 && punit.IsBothSharedVision(Players[i])) {
+				if (mfp.RadarJammer(i) > 0 && punit.IsBothSharedVision(Players[i])) {
 					// We are jammed, return nothing
 					return 0;
 				}
-				if (radar[i] > 0 && pradar.IsBothSharedVision(Players[i])) {
-					radarvision |= radar[i];
+				if (mfp.Radar(i) > 0 && pradar.IsBothSharedVision(Players[i])) {
+					radarvision |= mfp.Radar(i);
 				}
 			}
 		}
 		// Can't exit until the end, as we might be jammed
-		return (radarvision | mfp.Radar[p]);
+		return (radarvision | mfp.Radar(p));
 	}
-	return mfp.Radar[p];
+	return mfp.Radar(p);
 }
 
 
@@ -108,8 +106,8 @@ bool CUnit::IsVisibleOnRadar(const CPlayer &pradar) const
 */
 void MapMarkTileRadar(const CPlayer &player, const unsigned int index)
 {
-	Assert(Map.Field(index)->playerInfo.Radar[player.Index] != 255);
-	Map.Field(index)->playerInfo.Radar[player.Index]++;
+	Assert(Map.Sight.Radar[player.Index][index] != 255);
+	Map.Sight.Radar[player.Index][index]++;
 }
 
 void MapMarkTileRadar(const CPlayer &player, int x, int y)
@@ -129,7 +127,7 @@ void MapMarkTileRadar(const CPlayer &player, int x, int y)
 void MapUnmarkTileRadar(const CPlayer &player, const unsigned int index)
 {
 	// Reduce radar coverage if it exists.
-	unsigned char *v = &(Map.Field(index)->playerInfo.Radar[player.Index]);
+	unsigned char *v = &Map.Sight.Radar[player.Index][index];
 	if (*v) {
 		--*v;
 	}
@@ -151,8 +149,8 @@ void MapUnmarkTileRadar(const CPlayer &player, int x, int y)
 */
 void MapMarkTileRadarJammer(const CPlayer &player, const unsigned int index)
 {
-	Assert(Map.Field(index)->playerInfo.RadarJammer[player.Index] != 255);
-	Map.Field(index)->playerInfo.RadarJammer[player.Index]++;
+	Assert(Map.Sight.RadarJammer[player.Index][index] != 255);
+	Map.Sight.RadarJammer[player.Index][index]++;
 }
 
 void MapMarkTileRadarJammer(const CPlayer &player, int x, int y)
@@ -171,7 +169,7 @@ void MapMarkTileRadarJammer(const CPlayer &player, int x, int y)
 void MapUnmarkTileRadarJammer(const CPlayer &player, const unsigned int index)
 {
 	// Reduce radar coverage if it exists.
-	unsigned char *v = &(Map.Field(index)->playerInfo.RadarJammer[player.Index]);
+	unsigned char *v = &Map.Sight.RadarJammer[player.Index][index];
 	if (*v) {
 		--*v;
 	}
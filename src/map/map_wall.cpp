@@ -37,6 +37,7 @@
 
 #include "stratagus.h"
 #include "map.h"
+#include "pathfinder.h"
 #include "tileset.h"
 #include "ui.h"
 #include "player.h"
@@ -216,6 +217,7 @@ void CMap::RemoveWall(const Vec2i &pos)
 	mf.Flags &= ~(MapFieldHuman | MapFieldWall | MapFieldUnpassable);
 	MapFixWallNeighbors(pos);
 	UI.Minimap.UpdateXY(pos);
+	PathfinderTerrainChanged(pos, 1, 1);
 
 	if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 		UI.Minimap.UpdateSeenXY(pos);
@@ -246,6 +248,7 @@ void CMap::SetWall(const Vec2i &pos, bool humanwall)
 	UI.Minimap.UpdateXY(pos);
 	MapFixWallTile(pos);
 	MapFixWallNeighbors(pos);
+	PathfinderTerrainChanged(pos, 1, 1);
 
 	if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
 		UI.Minimap.UpdateSeenXY(pos);
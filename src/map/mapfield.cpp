@@ -98,7 +98,7 @@ void CMapField::Save(CFile &file) const
 {
 	file.printf("  {%3d, %3d, %2d, %2d", tile, playerInfo.SeenTile, Value, cost);
 	for (int i = 0; i != PlayerMax; ++i) {
-		if (playerInfo.Visible[i] == 1) {
+		if (playerInfo.Visible(i) == 1) {
 			file.printf(", \"explored\", %d", i);
 		}
 	}
@@ -170,7 +170,7 @@ void CMapField::parse(lua_State *l)
 
 		if (!strcmp(value, "explored")) {
 			++j;
-			this->playerInfo.Visible[LuaToNumber(l, -1, j + 1)] = 1;
+			this->playerInfo.Visible(LuaToNumber(l, -1, j + 1)) = 1;
 		} else if (!strcmp(value, "human")) {
 			this->Flags |= MapFieldHuman;
 		} else if (!strcmp(value, "land")) {
@@ -203,6 +203,60 @@ void CMapField::parse(lua_State *l)
 	}
 }
 
+/// Flags kept by the save games, the speed is given by the tile.
+static const unsigned short SavedFieldFlags = static_cast<unsigned short>(~MapFieldSpeedMask);
+
+/**
+**  Write the field in a binary save game record.
+**
+**  The record holds the same data as CMapField::Save, little endian:
+**  tile, seen tile, value, cost, flags and the explored mask of the players.
+**
+**  @param record  RecordSize bytes to fill.
+*/
+void CMapField::SaveRecord(unsigned char *record) const
+{
+	const unsigned short flags = Flags & SavedFieldFlags;
+	unsigned short explored = 0;
+
+	for (int i = 0; i != PlayerMax; ++i) {
+		if (playerInfo.Visible(i) == 1) {
+			explored |= 1 << i;
+		}
+	}
+	record[0] = tile & 0xFF;
+	record[1] = tile >> 8;
+	record[2] = playerInfo.SeenTile & 0xFF;
+	record[3] = playerInfo.SeenTile >> 8;
+	record[4] = Value;
+	record[5] = cost;
+	record[6] = flags & 0xFF;
+	record[7] = flags >> 8;
+	record[8] = explored & 0xFF;
+	record[9] = explored >> 8;
+}
+
+/**
+**  Read the field from a binary save game record.
+**
+**  @param record  RecordSize bytes written by CMapField::SaveRecord.
+*/
+void CMapField::parseRecord(const unsigned char *record)
+{
+	const unsigned short explored = record[8] | (record[9] << 8);
+
+	this->tile = record[0] | (record[1] << 8);
+	this->playerInfo.SeenTile = record[2] | (record[3] << 8);
+	this->Value = record[4];
+	this->cost = record[5];
+	this->Flags |= (record[6] | (record[7] << 8)) & SavedFieldFlags;
+	for (int i = 0; i != PlayerMax; ++i) {
+		if (explored & (1 << i)) {
+			this->playerInfo.Visible(i) = 1;
+		}
+	}
+}
+
 /// Check if a field flags.
 bool CMapField::CheckMask(int mask) const
 {
@@ -253,10 +307,54 @@ bool CMapField::isAOrcWall() const
 	return (Flags & humanWallFlag) == MapFieldWall;
 }
 
+//
+//  CMapSightPlanes
+//
+
+void CMapSightPlanes::Init(unsigned int size)
+{
+	for (int i = 0; i != PlayerMax; ++i) {
+		Visible[i].assign(size, 0);
+		VisCloak[i].assign(size, 0);
+		Radar[i].assign(size, 0);
+		RadarJammer[i].assign(size, 0);
+	}
+}
+
+void CMapSightPlanes::Clean()
+{
+	for (int i = 0; i != PlayerMax; ++i) {
+		std::vector<unsigned short>().swap(Visible[i]);
+		std::vector<unsigned char>().swap(VisCloak[i]);
+		std::vector<unsigned char>().swap(Radar[i]);
+		std::vector<unsigned char>().swap(RadarJammer[i]);
+	}
+}
+
 //
 //  CMapFieldPlayerInfo
 //
 
+unsigned short &CMapFieldPlayerInfo::Visible(int player) const
+{
+	return Map.Sight.Visible[player][Index];
+}
+
+unsigned char &CMapFieldPlayerInfo::VisCloak(int player) const
+{
+	return Map.Sight.VisCloak[player][Index];
+}
+
+unsigned char &CMapFieldPlayerInfo::Radar(int player) const
+{
+	return Map.Sight.Radar[player][Index];
+}
+
+unsigned char &CMapFieldPlayerInfo::RadarJammer(int player) const
+{
+	return Map.Sight.RadarJammer[player][Index];
+}
+
 unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) const
 {
 	if (IsVisible(player)) {
@@ -268,7 +366,7 @@ unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) co
 	}
 	for (int i = 0; i != PlayerMax ; ++i) {
 		if (player.IsBothSharedVision(Players[i])) {
-			maxVision = std::max<unsigned char>(maxVision, Visible[i]);
+			maxVision = std::max<unsigned char>(maxVision, Visible(i));
 			if (maxVision >= 2) {
 				return 2;
 			}
@@ -282,13 +380,13 @@ unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) co
 
 bool CMapFieldPlayerInfo::IsExplored(const CPlayer &player) const
 {
-	return Visible[player.Index] != 0;
+	return Visible(player.Index) != 0;
 }
 
 bool CMapFieldPlayerInfo::IsVisible(const CPlayer &player) const
 {
 	const bool fogOfWar = !Map.NoFogOfWar;
-	return Visible[player.Index] >= 2 || (!fogOfWar && IsExplored(player));
+	return Visible(player.Index) >= 2 || (!fogOfWar && IsExplored(player));
 }
 
 bool CMapFieldPlayerInfo::IsTeamVisible(const CPlayer &player) const
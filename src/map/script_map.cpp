@@ -37,7 +37,9 @@
 
 #include "map.h"
 
+#include "game.h"
 #include "iolib.h"
+#include "pathfinder.h"
 #include "script.h"
 #include "tileset.h"
 #include "translate.h"
@@ -89,7 +91,8 @@ static int CclStratagusMap(lua_State *l)
 					lua_pop(l, 1);
 
 					delete[] Map.Fields;
-					Map.Fields = new CMapField[Map.Info.MapWidth * Map.Info.MapHeight];
+					Map.Fields = NULL;
+					Map.Create();
 					// FIXME: this should be CreateMap or InitMap?
 				} else if (!strcmp(value, "fog-of-war")) {
 					Map.NoFogOfWar = false;
@@ -99,6 +102,12 @@ static int CclStratagusMap(lua_State *l)
 					--k;
 				} else if (!strcmp(value, "filename")) {
 					Map.Info.Filename = LuaToString(l, j + 1, k + 1);
+				} else if (!strcmp(value, "binary-map-fields")) {
+					const std::string *chunk = GetSaveGameChunk("MAPF");
+					if (chunk == NULL || !Map.LoadFields(*chunk)) {
+						LuaError(l, "missing or wrong map fields chunk");
+					}
+					--k;
 				} else if (!strcmp(value, "map-fields")) {
 					lua_rawgeti(l, j + 1, k + 1);
 					if (!lua_istable(l, -1)) {
@@ -355,6 +364,7 @@ void SetTile(unsigned int tileIndex, const Vec2i &pos, int value)
 		CMapField &mf = *Map.Field(pos);
 
 		mf.setTileIndex(*Map.Tileset, tileIndex, value);
+		PathfinderTerrainChanged(pos, 1, 1);
 	}
 }
 
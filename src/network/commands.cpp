@@ -456,6 +456,7 @@ void SendCommandSpellCast(CUnit &unit, const Vec2i &pos, CUnit *dest, int spelli
 		CommandLog("spell-cast", &unit, flush, pos.x, pos.y, dest, NULL, spellid);
 		CommandSpellCast(unit, pos, dest, *SpellTypeTable[spellid], flush);
 	} else {
+		Assert(MessageCommandSpellCast + spellid < MessageCommandGroup);
 		NetworkSendCommand(MessageCommandSpellCast + spellid,
 						   unit, pos.x, pos.y, dest, NULL, flush);
 	}
@@ -474,6 +475,7 @@ void SendCommandAutoSpellCast(CUnit &unit, int spellid, int on)
 		CommandLog("auto-spell-cast", &unit, FlushCommands, on, -1, NoUnitP, NULL, spellid);
 		CommandAutoSpellCast(unit, spellid, on);
 	} else {
+		Assert(MessageCommandSpellCast + spellid < MessageCommandGroup);
 		NetworkSendCommand(MessageCommandSpellCast + spellid,
 						   unit, on, -1, NoUnitP, NULL, FlushCommands);
 	}
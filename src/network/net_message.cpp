@@ -42,6 +42,8 @@
 #include "network.h"
 #include "version.h"
 
+#include <algorithm>
+
 size_t serialize32(unsigned char *buf, uint32_t data)
 {
 	if (buf) {
@@ -671,6 +673,59 @@ size_t CNetworkCommandQuit::Deserialize(const unsigned char *buf)
 	return p - buf;
 }
 
+//
+// CNetworkCommandGroup
+//
+
+size_t CNetworkCommandGroup::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+
+	p += serialize16(p, this->X);
+	p += serialize16(p, this->Y);
+	p += serialize16(p, this->Dest);
+	p += serialize16(p, uint16_t(this->Units.size()));
+	for (size_t i = 0; i != this->Units.size(); ++i) {
+		p += serialize16(p, Units[i]);
+	}
+	p += serialize8(p, this->Type);
+	return p - buf;
+}
+
+size_t CNetworkCommandGroup::Deserialize(const unsigned char *buf)
+{
+	const unsigned char *p = buf;
+
+	uint16_t size;
+	p += deserialize16(p, &this->X);
+	p += deserialize16(p, &this->Y);
+	p += deserialize16(p, &this->Dest);
+	p += deserialize16(p, &size);
+	this->Units.resize(size);
+	for (size_t i = 0; i != this->Units.size(); ++i) {
+		p += deserialize16(p, &Units[i]);
+	}
+	p += deserialize8(p, &this->Type);
+	return p - buf;
+}
+
+size_t CNetworkCommandGroup::Size() const
+{
+	return 2 + 2 + 2 + 2 + 2 * Units.size() + 1;
+}
+
+/**
+**  Check if the group gives a unit command.
+**
+**  @param type  Type of the unit command, with the flush flag.
+**  @param nc    Unit command.
+*/
+bool CNetworkCommandGroup::Contains(uint8_t type, const CNetworkCommand &nc) const
+{
+	return this->Type == type && this->X == nc.X && this->Y == nc.Y && this->Dest == nc.Dest
+		   && std::find(this->Units.begin(), this->Units.end(), nc.Unit) != this->Units.end();
+}
+
 //
 // CNetworkSelection
 //
@@ -706,6 +761,56 @@ size_t CNetworkSelection::Size() const
 	return 2 + 2 + 2 * Units.size();
 }
 
+/**
+**  Serialize an unsigned number with 7 bits by byte, the high bit set when
+**  more bytes follow.
+*/
+static size_t serializeVarint(unsigned char *buf, uint32_t data)
+{
+	size_t size = 1;
+
+	for (; data >= 0x80; data >>= 7, ++size) {
+		if (buf) {
+			*buf++ = uint8_t(data | 0x80);
+		}
+	}
+	if (buf) {
+		*buf = uint8_t(data);
+	}
+	return size;
+}
+
+/**
+**  Deserialize a number of serializeVarint.
+**
+**  @return  Number of bytes read, 0 when the buffer ends before the number.
+*/
+static size_t deserializeVarint(const unsigned char *buf, const unsigned char *end, uint32_t *data)
+{
+	*data = 0;
+	for (size_t i = 0; buf + i != end && i != 5; ++i) {
+		*data |= uint32_t(buf[i] & 0x7F) << (7 * i);
+		if ((buf[i] & 0x80) == 0) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+/// Map a 16 bits difference to a small unsigned number for serializeVarint
+static uint32_t zigzag16(uint16_t cur, uint16_t prev)
+{
+	const int16_t delta = int16_t(cur - prev);
+	return delta < 0 ? uint32_t(-(delta + 1)) * 2 + 1 : uint32_t(delta) * 2;
+}
+
+/// Inverse of zigzag16
+static uint16_t unzigzag16(uint32_t data, uint16_t prev)
+{
+	const int delta = (data & 1) ? -int(data >> 1) - 1 : int(data >> 1);
+	return uint16_t(prev + delta);
+}
+
 //
 // CNetworkPacketHeader
 //
@@ -713,22 +818,34 @@ size_t CNetworkSelection::Size() const
 size_t CNetworkPacketHeader::Serialize(unsigned char *p) const
 {
 	if (p != NULL) {
-		for (int i = 0; i != MaxNetworkCommands; ++i) {
+		for (size_t i = 0; i != this->Type.size(); ++i) {
 			p += serialize8(p, this->Type[i]);
 		}
+		p += serialize8(p, uint8_t(MessageNone));
 		p += serialize8(p, this->Cycle);
 		p += serialize8(p, this->OrigPlayer);
 	}
-	return MaxNetworkCommands + 1 + 1;
+	return Size();
 }
 
-size_t CNetworkPacketHeader::Deserialize(const unsigned char *buf)
+/**
+**  Deserialize the header.
+**
+**  @return  Number of bytes read, 0 for a truncated header.
+*/
+size_t CNetworkPacketHeader::Deserialize(const unsigned char *buf, size_t len)
 {
 	const unsigned char *p = buf;
+	const unsigned char *end = buf + len;
 
-	for (int i = 0; i != MaxNetworkCommands; ++i) {
-		p += deserialize8(p, &this->Type[i]);
+	this->Type.clear();
+	for (; p != end && *p != MessageNone; ++p) {
+		this->Type.push_back(*p);
+	}
+	if (end - p < 3) {
+		return 0;
 	}
+	++p;
 	p += deserialize8(p, &this->Cycle);
 	p += deserialize8(p, &this->OrigPlayer);
 	return p - buf;
@@ -738,39 +855,120 @@ size_t CNetworkPacketHeader::Deserialize(const unsigned char *buf)
 // CNetworkPacket
 //
 
-size_t CNetworkPacket::Serialize(unsigned char *buf, int numcommands) const
+/**
+**  Add a command at the end of the packet.
+**
+**  @param type     Message type of the command.
+**  @param command  Serialized command, a CNetworkCommand for the unit commands.
+*/
+void CNetworkPacket::Add(uint8_t type, const std::vector<unsigned char> &command)
 {
-	unsigned char *p = buf;
-
-	p += this->Header.Serialize(p);
-	for (int i = 0; i != numcommands; ++i) {
-		p += serialize(p, this->Command[i]);
-	}
-	return p - buf;
+	this->Header.Type.push_back(type);
+	this->Command.push_back(command);
 }
 
-void CNetworkPacket::Deserialize(const unsigned char *p, unsigned int len, int *commandCount)
+/**
+**  Serialize the packet.
+**
+**  The unit commands are the differences of Unit, X and Y to the previous
+**  unit command and Dest + 1, as varints. The other commands are their size
+**  as varint and their bytes.
+**
+**  @param buf  Destination buffer, NULL to only compute the size.
+**
+**  @return     Size of the packet.
+*/
+size_t CNetworkPacket::Serialize(unsigned char *buf) const
 {
-	this->Header.Deserialize(p);
-	p += CNetworkPacketHeader::Size();
-	len -= CNetworkPacketHeader::Size();
+	unsigned char *p = buf;
+	size_t size = this->Header.Serialize(p);
+	CNetworkCommand prev;
 
-	for (*commandCount = 0; len != 0; ++*commandCount) {
-		const size_t r = deserialize(p, this->Command[*commandCount]);
-		p += r;
-		len -= r;
+	if (p) {
+		p += size;
 	}
+	for (size_t i = 0; i != this->Command.size(); ++i) {
+		const std::vector<unsigned char> &command = this->Command[i];
+		size_t n = 0;
+
+		if (IsNetworkUnitCommand(this->Header.Type[i])) {
+			CNetworkCommand nc;
+
+			Assert(command.size() == CNetworkCommand::Size());
+			nc.Deserialize(&command[0]);
+			n += serializeVarint(p ? p + n : NULL, zigzag16(nc.Unit, prev.Unit));
+			n += serializeVarint(p ? p + n : NULL, zigzag16(nc.X, prev.X));
+			n += serializeVarint(p ? p + n : NULL, zigzag16(nc.Y, prev.Y));
+			n += serializeVarint(p ? p + n : NULL, uint16_t(nc.Dest + 1));
+			prev = nc;
+		} else {
+			n += serializeVarint(p, command.size());
+			if (p && !command.empty()) {
+				memcpy(p + n, &command[0], command.size());
+			}
+			n += command.size();
+		}
+		if (p) {
+			p += n;
+		}
+		size += n;
+	}
+	return size;
 }
 
-size_t CNetworkPacket::Size(int numcommands) const
+/**
+**  Deserialize a packet.
+**
+**  @param buf  Received bytes.
+**  @param len  Number of received bytes.
+**
+**  @return     false for a malformed packet.
+*/
+bool CNetworkPacket::Deserialize(const unsigned char *buf, size_t len)
 {
-	size_t size = 0;
+	const unsigned char *end = buf + len;
+	const size_t r = this->Header.Deserialize(buf, len);
+	const unsigned char *p = buf + r;
+	CNetworkCommand prev;
 
-	size += this->Header.Serialize(NULL);
-	for (int i = 0; i != numcommands; ++i) {
-		size += serialize(NULL, this->Command[i]);
+	if (r == 0) {
+		return false;
 	}
-	return size;
+	this->Command.resize(this->Header.Type.size());
+	for (size_t i = 0; i != this->Header.Type.size(); ++i) {
+		std::vector<unsigned char> &command = this->Command[i];
+
+		if (IsNetworkUnitCommand(this->Header.Type[i])) {
+			uint32_t data[4];
+
+			for (int j = 0; j != 4; ++j) {
+				const size_t n = deserializeVarint(p, end, &data[j]);
+				if (n == 0) {
+					return false;
+				}
+				p += n;
+			}
+			CNetworkCommand nc;
+			nc.Unit = unzigzag16(data[0], prev.Unit);
+			nc.X = unzigzag16(data[1], prev.X);
+			nc.Y = unzigzag16(data[2], prev.Y);
+			nc.Dest = uint16_t(data[3] - 1);
+			command.resize(CNetworkCommand::Size());
+			nc.Serialize(&command[0]);
+			prev = nc;
+		} else {
+			uint32_t size;
+			const size_t n = deserializeVarint(p, end, &size);
+
+			if (n == 0 || size_t(end - p - n) < size) {
+				return false;
+			}
+			p += n;
+			command.assign(p, p + size);
+			p += size;
+		}
+	}
+	return true;
 }
 
 //@}
@@ -1881,9 +1881,23 @@ static int CclNoRandomPlacementMultiplayer(lua_State *l)
 	return 0;
 }
 
+/**
+**  Enable or disable the adaptive network lag, this host then requests lag
+**  changes from the delays of the packets.
+**
+**  @param l  Lua state.
+*/
+static int CclSetNetworkAdaptiveLag(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	CNetworkParameter::Instance.adaptiveLag = LuaToBoolean(l, 1);
+	return 0;
+}
+
 void NetworkCclRegister()
 {
 	lua_register(Lua, "NoRandomPlacementMultiplayer", CclNoRandomPlacementMultiplayer);
+	lua_register(Lua, "SetNetworkAdaptiveLag", CclSetNetworkAdaptiveLag);
 }
 
 
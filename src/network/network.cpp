@@ -221,6 +221,7 @@
 
 #include "stratagus.h"
 
+#include <limits.h>
 #include <stddef.h>
 #include <list>
 
@@ -282,6 +283,7 @@ CNetworkParameter::CNetworkParameter()
 	gameCyclesPerUpdate = 1;
 	NetworkLag = 10;
 	timeoutInS = 45;
+	adaptiveLag = false;
 }
 
 void CNetworkParameter::FixValues()
@@ -299,7 +301,8 @@ static unsigned long NetworkLastCycle[PlayerMax]; /// Last cycle received packet
 
 static int NetworkSyncSeeds[256];          /// Network sync seeds.
 static int NetworkSyncHashs[256];          /// Network sync hashs.
-static CNetworkCommandQueue NetworkIn[256][PlayerMax][MaxNetworkCommands]; /// Per-player network packet input queue
+/// Per-player network packet input queue, a MessageNone alone marks a cycle without command
+static std::vector<CNetworkCommandQueue> NetworkIn[256][PlayerMax];
 static std::deque<CNetworkCommandQueue> CommandsIn;    /// Network command input queue
 static std::deque<CNetworkCommandQueue> MsgCommandsIn; /// Network message input queue
 
@@ -337,6 +340,24 @@ static CNetworkStat NetworkStat;
 
 static int PlayerQuit[PlayerMax];          /// Player quit
 
+/// Updates without command between two syncs
+static const unsigned int NetworkSyncUpdates = 8;
+
+/// Max lag of the adaptive lag, the cycle of the packets is only a byte
+static const unsigned int NetworkMaxLag = 100;
+/// Game cycles between two lag requests, longer than the lag so that a request executes before the next one
+static const unsigned long NetworkLagWindow = 128;
+
+static unsigned long NetworkNextSendCycle;        /// Next cycle to send the commands for
+static unsigned int NetworkWantedLag[PlayerMax];  /// Lag wanted by each player, the biggest is used
+static unsigned long NetworkLagWindowStart;       /// Start of the measure of the delays
+static unsigned long NetworkLagSettledCycle;      /// Packets for later cycles were sent with the current lag
+static int NetworkMinDelay[PlayerMax];            /// Min delay in cycles of the packets of the window
+static int NetworkMaxDelay[PlayerMax];            /// Max delay in cycles of the packets of the window, -1 for none
+static unsigned long NetworkWindowStallFrames;    /// Frames waiting for the network in the window
+static unsigned long NetworkStallFrames;          /// Frames waiting for the network since the last lag change
+static unsigned long NetworkTotalStallFrames;     /// Frames waiting for the network in the game
+
 //----------------------------------------------------------------------------
 //  Mid-Level api functions
 //----------------------------------------------------------------------------
@@ -344,14 +365,19 @@ static int PlayerQuit[PlayerMax];          /// Player quit
 /**
 **  Send message to all clients.
 **
-**  @param packet       Packet to send.
-**  @param numcommands  Number of commands.
+**  The send buffer is kept between the calls.
+**
+**  @param packet  Packet to send.
+**  @param player  Player not to send to, the sender of a forwarded packet.
 */
-static void NetworkBroadcast(const CNetworkPacket &packet, int numcommands, int player = 255)
+static void NetworkBroadcast(const CNetworkPacket &packet, int player = 255)
 {
-	const unsigned int size = packet.Size(numcommands);
-	unsigned char *buf = new unsigned char[size];
-	packet.Serialize(buf, numcommands);
+	static std::vector<unsigned char> sendBuffer;
+	const unsigned int size = packet.Size();
+
+	sendBuffer.resize(size);
+	packet.Serialize(&sendBuffer[0]);
+	const unsigned char *buf = &sendBuffer[0];
 
 	// Send to all clients.
 	if (NetConnectType == 1) { // server
@@ -366,32 +392,38 @@ static void NetworkBroadcast(const CNetworkPacket &packet, int numcommands, int
 		const CHost host(Hosts[HostsCount - 1].Host, Hosts[HostsCount - 1].Port);
 		NetworkFildes.Send(host, buf, size);
 	}
-	delete[] buf;
 }
 
 /**
 **  Network send packet. Build it from queue and broadcast.
 **
-**  @param ncq  Outgoing network queue start.
+**  @param ncqs  Outgoing commands of a cycle.
 */
-static void NetworkSendPacket(const CNetworkCommandQueue(&ncq)[MaxNetworkCommands])
+static void NetworkSendPacket(const std::vector<CNetworkCommandQueue> &ncqs)
 {
 	CNetworkPacket packet;
 
-	// Build packet of up to MaxNetworkCommands messages.
-	int numcommands = 0;
-	packet.Header.Cycle = ncq[0].Time & 0xFF;
+	packet.Header.Cycle = ncqs[0].Time & 0xFF;
 	packet.Header.OrigPlayer = ThisPlayer->Index;
-	int i;
-	for (i = 0; i < MaxNetworkCommands && ncq[i].Type != MessageNone; ++i) {
-		packet.Header.Type[i] = ncq[i].Type;
-		packet.Command[i] = ncq[i].Data;
-		++numcommands;
+	for (size_t i = 0; i != ncqs.size(); ++i) {
+		if (ncqs[i].Type != MessageNone) {
+			packet.Add(ncqs[i].Type, ncqs[i].Data);
+		}
 	}
-	for (; i < MaxNetworkCommands; ++i) {
-		packet.Header.Type[i] = MessageNone;
+	NetworkBroadcast(packet);
+}
+
+/**
+**  Start a new measure of the delays of the packets.
+*/
+static void NetworkResetDelays()
+{
+	NetworkLagWindowStart = GameCycle;
+	NetworkWindowStallFrames = 0;
+	for (int i = 0; i != PlayerMax; ++i) {
+		NetworkMinDelay[i] = INT_MAX;
+		NetworkMaxDelay[i] = -1;
 	}
-	NetworkBroadcast(packet, numcommands);
 }
 
 //----------------------------------------------------------------------------
@@ -452,6 +484,11 @@ void ExitNetwork1()
 	NetworkFildes.clearStatistic();
 	NetworkStat.print();
 #endif
+	if (CNetworkParameter::Instance.adaptiveLag) {
+		const int framesPerSecond = FRAMES_PER_SECOND * VideoSyncSpeed / 100;
+		fprintf(stderr, "NETWORK: final lag %u cycles, %lu ms waiting for the network\n",
+				CNetworkParameter::Instance.NetworkLag, NetworkTotalStallFrames * 1000 / framesPerSecond);
+	}
 
 	NetworkFildes.Close();
 	NetExit(); // machine dependent setup
@@ -480,9 +517,7 @@ void NetworkOnStartGame()
 	// Prepare first time without syncs.
 	for (int i = 0; i != 256; ++i) {
 		for (int p = 0; p != PlayerMax; ++p) {
-			for (int j = 0; j != MaxNetworkCommands; ++j) {
-				NetworkIn[i][p][j].Clear();
-			}
+			NetworkIn[i][p].clear();
 		}
 	}
 	CNetworkCommandSync nc;
@@ -491,14 +526,13 @@ void NetworkOnStartGame()
 
 	for (unsigned int i = 0; i <= CNetworkParameter::Instance.NetworkLag; i += CNetworkParameter::Instance.gameCyclesPerUpdate) {
 		for (int n = 0; n < HostsCount; ++n) {
-			CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[i][Hosts[n].PlyNr];
+			std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[i][Hosts[n].PlyNr];
 
+			ncqs.resize(1);
 			ncqs[0].Time = i;
 			ncqs[0].Type = MessageSync;
 			ncqs[0].Data.resize(nc.Size());
 			nc.Serialize(&ncqs[0].Data[0]);
-			ncqs[1].Time = i;
-			ncqs[1].Type = MessageNone;
 		}
 	}
 	memset(NetworkSyncSeeds, 0, sizeof(NetworkSyncSeeds));
@@ -506,12 +540,92 @@ void NetworkOnStartGame()
 	memset(PlayerQuit, 0, sizeof(PlayerQuit));
 	memset(NetworkLastFrame, 0, sizeof(NetworkLastFrame));
 	memset(NetworkLastCycle, 0, sizeof(NetworkLastCycle));
+
+	memset(NetworkWantedLag, 0, sizeof(NetworkWantedLag));
+	for (int i = 0; i < HostsCount; ++i) {
+		NetworkWantedLag[Hosts[i].PlyNr] = CNetworkParameter::Instance.NetworkLag;
+	}
+	NetworkWantedLag[ThisPlayer->Index] = CNetworkParameter::Instance.NetworkLag;
+	NetworkNextSendCycle = CNetworkParameter::Instance.NetworkLag;
+	NetworkStallFrames = 0;
+	NetworkTotalStallFrames = 0;
+	NetworkLagSettledCycle = 0;
+	NetworkResetDelays();
 }
 
 //----------------------------------------------------------------------------
 //  Commands input
 //----------------------------------------------------------------------------
 
+/**
+**  Merge a unit command into the last command of the output queue, when
+**  it is the same order for another unit.
+**
+**  The order of execution is kept, the units of a group command execute
+**  their command in turn.
+**
+**  @param last  Last command of the output queue.
+**  @param type  Type of the unit command, with the flush flag.
+**  @param nc    Unit command.
+**
+**  @return      true if the command is merged.
+*/
+static bool NetworkAddToGroupCommand(CNetworkCommandQueue &last, uint8_t type, const CNetworkCommand &nc)
+{
+	CNetworkCommandGroup group;
+
+	if (last.Type == type) {
+		CNetworkCommand lastnc;
+		lastnc.Deserialize(&last.Data[0]);
+		if (lastnc.X != nc.X || lastnc.Y != nc.Y || lastnc.Dest != nc.Dest) {
+			return false;
+		}
+		group.Type = type;
+		group.X = nc.X;
+		group.Y = nc.Y;
+		group.Dest = nc.Dest;
+		group.Units.push_back(lastnc.Unit);
+	} else if (last.Type == MessageCommandGroup) {
+		group.Deserialize(&last.Data[0]);
+		if (group.Type != type || group.X != nc.X || group.Y != nc.Y || group.Dest != nc.Dest
+			|| group.Units.size() >= NetworkMaxGroupUnits) {
+			return false;
+		}
+	} else {
+		return false;
+	}
+	group.Units.push_back(nc.Unit);
+	last.Type = MessageCommandGroup;
+	last.Data.resize(group.Size());
+	group.Serialize(&last.Data[0]);
+	return true;
+}
+
+/**
+**  Check if a unit command is already in the output queue, alone or in a
+**  group command.
+**
+**  @param ncq  Unit command of the queue.
+**  @param nc   Unit command.
+*/
+static bool NetworkIsCommandQueued(const CNetworkCommandQueue &ncq, const CNetworkCommand &nc)
+{
+	for (std::deque<CNetworkCommandQueue>::const_iterator it = CommandsIn.begin(); it != CommandsIn.end(); ++it) {
+		if (*it == ncq) {
+			return true;
+		}
+		if (it->Type == MessageCommandGroup) {
+			CNetworkCommandGroup group;
+
+			group.Deserialize(&it->Data[0]);
+			if (group.Contains(ncq.Type, nc)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 /**
 **  Prepare send of command message.
 **
@@ -552,7 +666,10 @@ void NetworkSendCommand(int command, const CUnit &unit, int x, int y,
 	ncq.Data.resize(nc.Size());
 	nc.Serialize(&ncq.Data[0]);
 	// Check for duplicate command in queue
-	if (std::find(CommandsIn.begin(), CommandsIn.end(), ncq) != CommandsIn.end()) {
+	if (NetworkIsCommandQueued(ncq, nc)) {
+		return;
+	}
+	if (!CommandsIn.empty() && NetworkAddToGroupCommand(CommandsIn.back(), ncq.Type, nc)) {
 		return;
 	}
 	CommandsIn.push_back(ncq);
@@ -644,6 +761,75 @@ void NetworkSendChatMessage(const std::string &msg)
 	MsgCommandsIn.push_back(ncq);
 }
 
+/**
+**  Use the biggest lag wanted by the players.
+**
+**  Called at the same game cycle by all the hosts. The packets for the
+**  next cycles may have been sent with the former lag, their delays
+**  aren't measured until the biggest of both lags is over.
+*/
+static void NetworkUpdateLag()
+{
+	unsigned int lag = 2 * CNetworkParameter::Instance.gameCyclesPerUpdate;
+
+	for (int i = 0; i != PlayerMax; ++i) {
+		lag = std::max(lag, NetworkWantedLag[i]);
+	}
+	if (lag == CNetworkParameter::Instance.NetworkLag) {
+		return;
+	}
+	const int framesPerSecond = FRAMES_PER_SECOND * VideoSyncSpeed / 100;
+	fprintf(stderr, "NETWORK: lag %u -> %u cycles at cycle %lu, %lu ms waiting for the network since the last change\n",
+			CNetworkParameter::Instance.NetworkLag, lag, GameCycle, NetworkStallFrames * 1000 / framesPerSecond);
+	NetworkLagSettledCycle = GameCycle + std::max(lag, CNetworkParameter::Instance.NetworkLag);
+	CNetworkParameter::Instance.NetworkLag = lag;
+	NetworkStallFrames = 0;
+	NetworkResetDelays();
+}
+
+/**
+**  Request a new lag from the delays of the packets of the last window.
+**
+**  The lag covers the worst delay, its jitter and the wait of an update.
+**  The request is a command, so all hosts change the lag at the same cycle.
+**
+**  @param gameNetCycle  Current cycle.
+*/
+static void NetworkAdaptLag(unsigned long gameNetCycle)
+{
+	if (!CNetworkParameter::Instance.adaptiveLag || gameNetCycle < NetworkLagWindowStart + NetworkLagWindow) {
+		return;
+	}
+	const unsigned int updates = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	int worstDelay = -1;
+	int jitter = 0;
+
+	for (int i = 0; i < HostsCount; ++i) {
+		const int ply = Hosts[i].PlyNr;
+		if (NetworkMaxDelay[ply] >= 0) {
+			worstDelay = std::max(worstDelay, NetworkMaxDelay[ply]);
+			jitter = std::max(jitter, NetworkMaxDelay[ply] - NetworkMinDelay[ply]);
+		}
+	}
+	const bool stalled = NetworkWindowStallFrames != 0;
+	NetworkResetDelays();
+	if (worstDelay < 0) {
+		return;
+	}
+	unsigned int lag = worstDelay + jitter + 2 * updates;
+	if (stalled) {
+		lag = std::max(lag, CNetworkParameter::Instance.NetworkLag + updates);
+	}
+	// The commands are executed on update cycles only
+	lag = (lag + updates - 1) / updates * updates;
+	lag = std::max(std::min(lag, NetworkMaxLag / updates * updates), 2 * updates);
+
+	const unsigned int wanted = NetworkWantedLag[ThisPlayer->Index];
+	if (lag > wanted || lag + 2 * updates < wanted) {
+		NetworkSendExtendedCommand(ExtendedMessageNetworkLag, -1, ThisPlayer->Index, lag, 0, 0);
+	}
+}
+
 /**
 **  Remove a player from the game.
 **
@@ -660,18 +846,18 @@ static void NetworkRemovePlayer(int player)
 		}
 	}
 	for (int i = 0; i < 256; ++i) {
-		for (int c = 0; c < MaxNetworkCommands; ++c) {
-			NetworkIn[i][player][c].Time = 0;
-		}
+		NetworkIn[i][player].clear();
 	}
+	NetworkWantedLag[player] = 0;
+	NetworkUpdateLag();
 }
 
 static bool IsNetworkCommandReady(int hostIndex, unsigned long gameNetCycle)
 {
 	const int ply = Hosts[hostIndex].PlyNr;
-	const CNetworkCommandQueue &ncq = NetworkIn[gameNetCycle & 0xFF][ply][0];
+	const std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[gameNetCycle & 0xFF][ply];
 
-	if (ncq.Time != gameNetCycle) {
+	if (ncqs.empty() || ncqs[0].Time != gameNetCycle) {
 		return false;
 	}
 	return true;
@@ -699,36 +885,30 @@ static void ParseResendCommand(const CNetworkPacket &packet)
 	const unsigned long gameNetCycle = n;
 	// FIXME: not necessary to send this packet multiple times!!!!
 	// other side sends re-send until it gets an answer.
-	if (n != NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index][0].Time) {
+	const std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index];
+	if (ncqs.empty() || n != ncqs[0].Time) {
 		// Asking for a cycle we haven't gotten to yet, ignore for now
 		return;
 	}
-	NetworkSendPacket(NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index]);
+	NetworkSendPacket(ncqs);
 	// Check if a player quit this cycle
 	for (int j = 0; j < HostsCount; ++j) {
-		for (int c = 0; c < MaxNetworkCommands; ++c) {
-			const CNetworkCommandQueue *ncq;
-			ncq = &NetworkIn[gameNetCycle & 0xFF][Hosts[j].PlyNr][c];
-			if (ncq->Time && ncq->Type == MessageQuit) {
+		const std::vector<CNetworkCommandQueue> &hostNcqs = NetworkIn[gameNetCycle & 0xFF][Hosts[j].PlyNr];
+		for (size_t c = 0; c != hostNcqs.size(); ++c) {
+			const CNetworkCommandQueue &ncq = hostNcqs[c];
+			if (ncq.Time && ncq.Type == MessageQuit) {
 				CNetworkPacket np;
-				np.Header.Cycle = ncq->Time & 0xFF;
-				np.Header.Type[0] = MessageQuit;
-				np.Command[0] = ncq->Data;
-				for (int k = 1; k < MaxNetworkCommands; ++k) {
-					np.Header.Type[k] = MessageNone;
-				}
-				NetworkBroadcast(np, 1);
+				np.Header.Cycle = ncq.Time & 0xFF;
+				np.Add(MessageQuit, ncq.Data);
+				NetworkBroadcast(np);
 				break;
 			}
 		}
 	}
 }
 
-static bool IsAValidCommand_Command(const CNetworkPacket &packet, int index, const int player)
+static bool IsAValidCommand_Unit(unsigned int slot, const int player)
 {
-	CNetworkCommand nc;
-	nc.Deserialize(&packet.Command[index][0]);
-	const unsigned int slot = nc.Unit;
 	const CUnit *unit = slot < UnitManager.GetUsedSlotCount() ? &UnitManager.GetSlotUnit(slot) : NULL;
 
 	if (unit && (unit->Player->Index == player
@@ -739,17 +919,55 @@ static bool IsAValidCommand_Command(const CNetworkPacket &packet, int index, con
 	}
 }
 
-static bool IsAValidCommand_Dismiss(const CNetworkPacket &packet, int index, const int player)
+static bool IsAValidCommand_DismissUnit(unsigned int slot, const int player)
 {
-	CNetworkCommand nc;
-	nc.Deserialize(&packet.Command[index][0]);
-	const unsigned int slot = nc.Unit;
 	const CUnit *unit = slot < UnitManager.GetUsedSlotCount() ? &UnitManager.GetSlotUnit(slot) : NULL;
 
 	if (unit && unit->Type->ClicksToExplode) {
 		return true;
 	}
-	return IsAValidCommand_Command(packet, index, player);
+	return IsAValidCommand_Unit(slot, player);
+}
+
+static bool IsAValidCommand_Command(const CNetworkPacket &packet, int index, const int player)
+{
+	if (packet.Command[index].size() != CNetworkCommand::Size()) {
+		return false;
+	}
+	CNetworkCommand nc;
+	nc.Deserialize(&packet.Command[index][0]);
+	if ((packet.Header.Type[index] & 0x7F) == MessageCommandDismiss) {
+		return IsAValidCommand_DismissUnit(nc.Unit, player);
+	}
+	return IsAValidCommand_Unit(nc.Unit, player);
+}
+
+static bool IsAValidCommand_Group(const CNetworkPacket &packet, int index, const int player)
+{
+	const std::vector<unsigned char> &command = packet.Command[index];
+	CNetworkCommandGroup group;
+
+	// Check the number of units before reading them
+	if (command.size() < group.Size()) {
+		return false;
+	}
+	group.Units.resize((command.size() - group.Size()) / 2);
+	if (command.size() != group.Size()) {
+		return false;
+	}
+	group.Deserialize(&command[0]);
+	if (command.size() != group.Size() || !IsNetworkUnitCommand(group.Type)) {
+		return false;
+	}
+	for (size_t i = 0; i != group.Units.size(); ++i) {
+		const bool valid = (group.Type & 0x7F) == MessageCommandDismiss
+						   ? IsAValidCommand_DismissUnit(group.Units[i], player)
+						   : IsAValidCommand_Unit(group.Units[i], player);
+		if (!valid) {
+			return false;
+		}
+	}
+	return true;
 }
 
 static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int player)
@@ -762,7 +980,7 @@ static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int p
 		case MessageResend:    // FIXME: ensure it's from the right player
 		case MessageChat:      // FIXME: ensure it's from the right player
 			return true;
-		case MessageCommandDismiss: return IsAValidCommand_Dismiss(packet, index, player);
+		case MessageCommandGroup: return IsAValidCommand_Group(packet, index, player);
 		default: return IsAValidCommand_Command(packet, index, player);
 	}
 	// FIXME: not all values in nc have been validated
@@ -771,8 +989,7 @@ static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int p
 static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHost &host)
 {
 	CNetworkPacket packet;
-	int commands;
-	packet.Deserialize(buf, len, &commands);
+	const bool validPacket = packet.Deserialize(buf, len);
 
 	int player = packet.Header.OrigPlayer;
 	if (player == 255) {
@@ -786,20 +1003,27 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 		}
 		player = Hosts[index].PlyNr;
 	}
+	if (!validPacket) {
+		DebugPrint("Bad packet read\n");
+		return;
+	}
 	if (NetConnectType == 1) {
 		if (player != 255) {
-			NetworkBroadcast(packet, commands, player);
+			NetworkBroadcast(packet, player);
 		}
 	}
-	if (commands < 0) {
-		DebugPrint("Bad packet read\n");
-		return;
-	}
 	NetworkLastCycle[player] = packet.Header.Cycle;
+	// Destination cycle (time to execute).
+	unsigned long n = ((GameCycle + 128) & ~0xFF) | packet.Header.Cycle;
+	if (n > GameCycle + 128) {
+		n -= 0x100;
+	}
+	std::vector<CNetworkCommandQueue> ncqs;
 	// Parse the packet commands.
-	for (int i = 0; i != commands; ++i) {
+	const size_t commands = packet.Command.size();
+	for (size_t i = 0; i != commands; ++i) {
 		// Handle some messages.
-		if (packet.Header.Type[i] == MessageQuit) {
+		if (packet.Header.Type[i] == MessageQuit && packet.Command[i].size() >= CNetworkCommandQuit::Size()) {
 			CNetworkCommandQuit nc;
 			nc.Deserialize(&packet.Command[i][0]);
 			const int playerNum = nc.player;
@@ -818,23 +1042,29 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 		bool validCommand = IsAValidCommand(packet, i, player);
 		// Place in network in
 		if (validCommand) {
-			// Destination cycle (time to execute).
-			unsigned long n = ((GameCycle + 128) & ~0xFF) | packet.Header.Cycle;
-			if (n > GameCycle + 128) {
-				n -= 0x100;
-			}
-			NetworkIn[packet.Header.Cycle][player][i].Time = n;
-			NetworkIn[packet.Header.Cycle][player][i].Type = packet.Header.Type[i];
-			NetworkIn[packet.Header.Cycle][player][i].Data = packet.Command[i];
+			ncqs.push_back(CNetworkCommandQueue());
+			ncqs.back().Time = n;
+			ncqs.back().Type = packet.Header.Type[i];
+			ncqs.back().Data = packet.Command[i];
 		} else {
 			SetMessage(_("%s sent bad command"), Players[player].Name.c_str());
 			DebugPrint("%s sent bad command: 0x%x\n" _C_ Players[player].Name.c_str()
 					   _C_ packet.Header.Type[i] & 0x7F);
 		}
 	}
-	for (int i = commands; i != MaxNetworkCommands; ++i) {
-		NetworkIn[packet.Header.Cycle][player][i].Time = 0;
+	// Delay of the packet, from the cycle of the sender to ours. It is
+	// known only if the sender used our lag.
+	if (n > NetworkLagSettledCycle) {
+		const int delay = std::max(0L, long(GameCycle) - long(n - CNetworkParameter::Instance.NetworkLag));
+		NetworkMinDelay[player] = std::min(NetworkMinDelay[player], delay);
+		NetworkMaxDelay[player] = std::max(NetworkMaxDelay[player], delay);
+	}
+	// A cycle without command is ready too
+	if (ncqs.empty()) {
+		ncqs.push_back(CNetworkCommandQueue());
+		ncqs.back().Time = n;
 	}
+	NetworkIn[packet.Header.Cycle][player].swap(ncqs);
 	// Waiting for this time slot
 	if (!NetworkInSync) {
 		const int networkUpdates = CNetworkParameter::Instance.gameCyclesPerUpdate;
@@ -856,7 +1086,7 @@ void NetworkEvent()
 		return;
 	}
 	// Read the packet.
-	unsigned char buf[1024];
+	unsigned char buf[NetworkMaxPacketSize];
 	CHost host;
 	int len = NetworkFildes.Recv(&buf, sizeof(buf), &host);
 	if (len < 0) {
@@ -890,17 +1120,14 @@ void NetworkQuitGame()
 	const int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
 	const int NetworkLag = CNetworkParameter::Instance.NetworkLag;
 	const int n = (GameCycle + gameCyclesPerUpdate) / gameCyclesPerUpdate * gameCyclesPerUpdate + NetworkLag;
-	CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[n & 0xFF][ThisPlayer->Index];
+	std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[n & 0xFF][ThisPlayer->Index];
 	CNetworkCommandQuit nc;
 	nc.player = ThisPlayer->Index;
+	ncqs.resize(1);
 	ncqs[0].Type = MessageQuit;
 	ncqs[0].Time = n;
 	ncqs[0].Data.resize(nc.Size());
 	nc.Serialize(&ncqs[0].Data[0]);
-	for (int i = 1; i < MaxNetworkCommands; ++i) {
-		ncqs[i].Type = MessageNone;
-		ncqs[i].Data.clear();
-	}
 	NetworkSendPacket(ncqs);
 }
 
@@ -970,6 +1197,13 @@ static void NetworkExecCommand_ExtendedCommand(const CNetworkCommandQueue &ncq)
 	CNetworkExtendedCommand nec;
 
 	nec.Deserialize(&ncq.Data[0]);
+	if (nec.ExtendedType == ExtendedMessageNetworkLag) {
+		if (nec.Arg2 < PlayerMax) {
+			NetworkWantedLag[nec.Arg2] = nec.Arg3;
+			NetworkUpdateLag();
+		}
+		return;
+	}
 	ExecExtendedCommand(nec.ExtendedType, (ncq.Type & 0x80) >> 7,
 						nec.Arg1, nec.Arg2, nec.Arg3, nec.Arg4);
 }
@@ -982,6 +1216,22 @@ static void NetworkExecCommand_Command(const CNetworkCommandQueue &ncq)
 	ExecCommand(ncq.Type, nc.Unit, nc.X, nc.Y, nc.Dest);
 }
 
+/**
+**  Execute a group command, the command of each unit in turn.
+**
+**  @param ncq  Network command from queue
+*/
+static void NetworkExecCommand_Group(const CNetworkCommandQueue &ncq)
+{
+	Assert((ncq.Type & 0x7F) == MessageCommandGroup);
+	CNetworkCommandGroup group;
+
+	group.Deserialize(&ncq.Data[0]);
+	for (size_t i = 0; i != group.Units.size(); ++i) {
+		ExecCommand(group.Type, group.Units[i], group.X, group.Y, group.Dest);
+	}
+}
+
 /**
 **  Execute a network command.
 **
@@ -995,6 +1245,7 @@ static void NetworkExecCommand(const CNetworkCommandQueue &ncq)
 		case MessageChat: NetworkExecCommand_Chat(ncq); break;
 		case MessageQuit: NetworkExecCommand_Quit(ncq); break;
 		case MessageExtendedCommand: NetworkExecCommand_ExtendedCommand(ncq); break;
+		case MessageCommandGroup: NetworkExecCommand_Group(ncq); break;
 		case MessageNone:
 			// Nothing to Do, This Message Should Never be Executed
 			Assert(0);
@@ -1004,57 +1255,78 @@ static void NetworkExecCommand(const CNetworkCommandQueue &ncq)
 }
 
 /**
-**  Network send commands.
+**  Move the commands of a queue into the packet of a cycle, as long as the
+**  packet fits in a datagram.
+**
+**  @param queue         Network command input queue.
+**  @param gameNetCycle  Cycle of the commands.
+**  @param ncqs          Outgoing commands of the cycle.
+**  @param packet        Packet of the commands.
 */
-static void NetworkSendCommands(unsigned long gameNetCycle)
+static void NetworkMoveCommands(std::deque<CNetworkCommandQueue> &queue, unsigned long gameNetCycle,
+								std::vector<CNetworkCommandQueue> &ncqs, CNetworkPacket &packet)
 {
-	// No command available, send sync.
-	int numcommands = 0;
-	CNetworkCommandQueue(&ncq)[MaxNetworkCommands] = NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index];
-	ncq[0].Clear();
-	if (CommandsIn.empty() && MsgCommandsIn.empty()) {
-		CNetworkCommandSync nc;
-		ncq[0].Type = MessageSync;
-		nc.syncHash = SyncHash;
-		nc.syncSeed = SyncRandSeed;
-		ncq[0].Data.resize(nc.Size());
-		nc.Serialize(&ncq[0].Data[0]);
-		ncq[0].Time = gameNetCycle;
-		numcommands = 1;
-	} else {
-		while (!CommandsIn.empty() && numcommands < MaxNetworkCommands) {
-			const CNetworkCommandQueue &incommand = CommandsIn.front();
+	while (!queue.empty()) {
+		const CNetworkCommandQueue &incommand = queue.front();
+
+		packet.Add(incommand.Type, incommand.Data);
+		if (packet.Size() > NetworkMaxPacketSize && packet.Command.size() > 1) {
+			// Next update
+			packet.RemoveLast();
+			return;
+		}
 #ifdef DEBUG
-			if (incommand.Type != MessageExtendedCommand) {
-				CNetworkCommand nc;
-				nc.Deserialize(&incommand.Data[0]);
-
-				const CUnit &unit = UnitManager.GetSlotUnit(nc.Unit);
-				// FIXME: we can send destoyed units over network :(
-				if (unit.Destroyed) {
-					DebugPrint("Sending destroyed unit %d over network!!!!!!\n" _C_ nc.Unit);
-				}
+		if (IsNetworkUnitCommand(incommand.Type)) {
+			CNetworkCommand nc;
+			nc.Deserialize(&incommand.Data[0]);
+
+			const CUnit &unit = UnitManager.GetSlotUnit(nc.Unit);
+			// FIXME: we can send destoyed units over network :(
+			if (unit.Destroyed) {
+				DebugPrint("Sending destroyed unit %d over network!!!!!!\n" _C_ nc.Unit);
 			}
-#endif
-			ncq[numcommands] = incommand;
-			ncq[numcommands].Time = gameNetCycle;
-			++numcommands;
-			CommandsIn.pop_front();
-		}
-		while (!MsgCommandsIn.empty() && numcommands < MaxNetworkCommands) {
-			const CNetworkCommandQueue &incommand = MsgCommandsIn.front();
-			ncq[numcommands] = incommand;
-			ncq[numcommands].Time = gameNetCycle;
-			++numcommands;
-			MsgCommandsIn.pop_front();
 		}
+#endif
+		ncqs.push_back(incommand);
+		ncqs.back().Time = gameNetCycle;
+		queue.pop_front();
 	}
-	if (numcommands != MaxNetworkCommands) {
-		ncq[numcommands].Type = MessageNone;
+}
+
+/**
+**  Network send commands.
+**
+**  All the waiting commands which fit in a packet are sent. Without
+**  command, a sync is sent every NetworkSyncUpdates updates, and an empty
+**  packet otherwise.
+*/
+static void NetworkSendCommands(unsigned long gameNetCycle)
+{
+	std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[gameNetCycle & 0xFF][ThisPlayer->Index];
+	CNetworkPacket packet;
+
+	packet.Header.Cycle = gameNetCycle & 0xFF;
+	packet.Header.OrigPlayer = ThisPlayer->Index;
+	ncqs.clear();
+	NetworkMoveCommands(CommandsIn, gameNetCycle, ncqs, packet);
+	NetworkMoveCommands(MsgCommandsIn, gameNetCycle, ncqs, packet);
+	if (ncqs.empty()) {
+		ncqs.push_back(CNetworkCommandQueue());
+		ncqs[0].Time = gameNetCycle;
+		if ((gameNetCycle / CNetworkParameter::Instance.gameCyclesPerUpdate) % NetworkSyncUpdates == 0) {
+			// No command available, send sync.
+			CNetworkCommandSync nc;
+			nc.syncHash = SyncHash;
+			nc.syncSeed = SyncRandSeed;
+			ncqs[0].Type = MessageSync;
+			ncqs[0].Data.resize(nc.Size());
+			nc.Serialize(&ncqs[0].Data[0]);
+			packet.Add(ncqs[0].Type, ncqs[0].Data);
+		}
 	}
 	NetworkSyncSeeds[gameNetCycle & 0xFF] = SyncRandSeed;
 	NetworkSyncHashs[gameNetCycle & 0xFF] = SyncHash;
-	NetworkSendPacket(ncq);
+	NetworkBroadcast(packet);
 }
 
 /**
@@ -1064,8 +1336,8 @@ static void NetworkExecCommands(unsigned long gameNetCycle)
 {
 	// Must execute commands on all computers in the same order.
 	for (int i = 0; i < NumPlayers; ++i) {
-		const CNetworkCommandQueue *ncqs = NetworkIn[gameNetCycle & 0xFF][i];
-		for (int c = 0; c < MaxNetworkCommands; ++c) {
+		const std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[gameNetCycle & 0xFF][i];
+		for (size_t c = 0; c != ncqs.size(); ++c) {
 			const CNetworkCommandQueue &ncq = ncqs[c];
 			if (ncq.Type == MessageNone) {
 				break;
@@ -1089,9 +1361,14 @@ void NetworkCommands()
 		return;
 	}
 	const unsigned long gameNetCycle = GameCycle;
-	// Send messages to all clients (other players)
-	NetworkSendCommands(gameNetCycle + CNetworkParameter::Instance.NetworkLag);
+	// Send messages to all clients (other players), the skipped cycles
+	// too when the lag grows, nothing until the last sent cycle when it shrinks.
+	const unsigned long sendCycle = gameNetCycle + CNetworkParameter::Instance.NetworkLag;
+	for (; NetworkNextSendCycle <= sendCycle; NetworkNextSendCycle += CNetworkParameter::Instance.gameCyclesPerUpdate) {
+		NetworkSendCommands(NetworkNextSendCycle);
+	}
 	NetworkExecCommands(gameNetCycle);
+	NetworkAdaptLag(gameNetCycle);
 	NetworkInSync = IsNetworkCommandReady(gameNetCycle + CNetworkParameter::Instance.gameCyclesPerUpdate);
 }
 
@@ -1114,7 +1391,9 @@ static void CheckPlayerThatTimeOut(int hostIndex)
 		const unsigned int nextGameNetCycle = GameCycle / CNetworkParameter::Instance.gameCyclesPerUpdate + 1;
 		CNetworkCommandQuit nc;
 		nc.player = playerIndex;
-		CNetworkCommandQueue *ncq = &NetworkIn[nextGameNetCycle & 0xFF][playerIndex][0];
+		std::vector<CNetworkCommandQueue> &ncqs = NetworkIn[nextGameNetCycle & 0xFF][playerIndex];
+		ncqs.resize(1);
+		CNetworkCommandQueue *ncq = &ncqs[0];
 		ncq->Time = nextGameNetCycle * CNetworkParameter::Instance.gameCyclesPerUpdate;
 		ncq->Type = MessageQuit;
 		ncq->Data.resize(nc.Size());
@@ -1124,10 +1403,9 @@ static void CheckPlayerThatTimeOut(int hostIndex)
 
 		CNetworkPacket np;
 		np.Header.Cycle = ncq->Time & 0xFF;
-		np.Header.Type[0] = ncq->Type;
-		np.Header.Type[1] = MessageNone;
+		np.Add(ncq->Type, ncq->Data);
 
-		NetworkBroadcast(np, 1);
+		NetworkBroadcast(np);
 	}
 }
 
@@ -1148,11 +1426,10 @@ static void NetworkResendCommands()
 	const int nextGameCycle = ((GameCycle / networkUpdates) + 1) * networkUpdates;
 	// Build packet
 	CNetworkPacket packet;
-	packet.Header.Type[0] = MessageResend;
-	packet.Header.Type[1] = MessageNone;
+	packet.Add(MessageResend, std::vector<unsigned char>());
 	packet.Header.Cycle = uint8_t(nextGameCycle & 0xFF);
 
-	NetworkBroadcast(packet, 1);
+	NetworkBroadcast(packet);
 }
 
 /**
@@ -1164,6 +1441,9 @@ void NetworkRecover()
 		NetworkInSync = true;
 		return;
 	}
+	++NetworkWindowStallFrames;
+	++NetworkStallFrames;
+	++NetworkTotalStallFrames;
 	if (FrameCounter % CNetworkParameter::Instance.gameCyclesPerUpdate != 0) {
 		return;
 	}
@@ -44,12 +44,20 @@
 
 #include "pathfinder.h"
 
+#include "astar_openset.h"
+
 #include <stdio.h>
 
+#include "SDL.h"
+
 /*----------------------------------------------------------------------------
 --  Declarations
 ----------------------------------------------------------------------------*/
 
+/// in reachability.cpp
+extern bool ReachabilityMayReach(const CUnit &unit, const Vec2i &startPos, const Vec2i &goalPos,
+								 int gw, int gh, int tilesizex, int tilesizey, int maxrange);
+
 struct Node {
 	int CostFromStart;  /// Real costs to reach this point
 	short int CostToGoal;     /// Estimated cost to goal
@@ -57,10 +65,67 @@ struct Node {
 	char Direction;     /// Direction for trace back
 };
 
-struct Open {
-	Vec2i pos;
-	short int Costs; /// complete costs to goal
-	unsigned short int O;     /// Offset into matrix
+/**
+**  Scratch state of one path search.
+**
+**  Every thread searching paths owns its context, several searches can
+**  then run at the same time as long as nobody modifies the map.
+*/
+class AStarContext
+{
+public:
+	AStarContext() : Matrix(NULL), MatrixSize(0), CloseSet(NULL), CloseSetSize(0),
+		Threshold(0), CostMoveToCache(NULL), GoalX(0), GoalY(0) {}
+	~AStarContext() { Free(); }
+
+	void Init(int mapWidth, int mapHeight);
+	void Free();
+
+private:
+	AStarContext(const AStarContext &); // not implemented
+	AStarContext &operator=(const AStarContext &); // not implemented
+
+public:
+	Node *Matrix;         /// cost matrix
+	int MatrixSize;       /// size of the cost matrix in bytes
+	int *CloseSet;        /// a list of close nodes, helps to speed up the matrix cleaning
+	int CloseSetSize;     /// number of nodes in the close set
+	int Threshold;        /// max size of the close set
+	AStarOpenSet OpenSet; /// The set of Open nodes
+	int *CostMoveToCache; /// cost of each tile for the searching unit
+	int GoalX;            /// goal of the current search
+	int GoalY;            /// goal of the current search
+};
+
+/**
+**  A path request of the batch solved at the start of the cycle.
+*/
+struct AStarRequest {
+	const CUnit *Unit;  /// Unit searching the path
+	Vec2i StartPos;     /// Start of the path
+	Vec2i GoalPos;      /// Top left tile of the goal
+	int GoalWidth;      /// Width of the goal
+	int GoalHeight;     /// Height of the goal
+	int TileSizeX;      /// Width of the unit
+	int TileSizeY;      /// Height of the unit
+	int MinRange;       /// Min range to the goal
+	int MaxRange;       /// Max range to the goal
+	bool MayReach;      /// Reachability index didn't reject the goal
+	bool Used;          /// Result was already handed out
+	int Result;         /// Result of the search
+	char Path[PathFinderOutput::MAX_PATH_LENGTH]; /// Found path
+};
+
+/**
+**  A thread solving its share of the batched path requests.
+*/
+struct AStarWorker {
+	AStarWorker() : Thread(NULL), Start(NULL), Index(0) {}
+
+	SDL_Thread *Thread;   /// The thread
+	SDL_sem *Start;       /// Posted when a batch is ready
+	int Index;            /// First request solved by the thread
+	AStarContext Context; /// Scratch state of the thread
 };
 
 //for 32 bit signed int
@@ -84,42 +149,37 @@ const int Heading2Y[9] = { -1, -1, 0, +1, +1, +1, 0, -1, 0 };
 int Heading2O[9];//heading to offset
 const int XY2Heading[3][3] = { {7, 6, 5}, {0, 0, 4}, {1, 2, 3}};
 
-/// cost matrix
-static Node *AStarMatrix;
-
-/// a list of close nodes, helps to speed up the matrix cleaning
-static int *CloseSet;
-static int CloseSetSize;
-static int Threshold;
-static int OpenSetMaxSize;
-static int AStarMatrixSize;
 #define MAX_CLOSE_SET_RATIO 4
-#define MAX_OPEN_SET_RATIO 8 // 10,16 to small
 
 /// see pathfinder.h
 int AStarFixedUnitCrossingCost;// = MaxMapWidth * MaxMapHeight;
 int AStarMovingUnitCrossingCost = 5;
 bool AStarKnowUnseenTerrain = false;
 int AStarUnknownTerrainCost = 2;
+bool AStarBatchSearch = false;
+int AStarBatchThreads = 0;
 
 static int AStarMapWidth;
 static int AStarMapHeight;
 
-static int AStarGoalX;
-static int AStarGoalY;
+/// Context of the searches done by the main thread
+static AStarContext MainContext;
 
-/**
-**  The Open set is handled by a stored array
-**  the end of the array holds the item with the smallest cost.
-*/
+static const int CacheNotSet = -5;
 
-/// The set of Open nodes
-static Open *OpenSet;
-/// The size of the open node set
-static int OpenSetSize;
+/// Path requests of the current batch
+static std::vector<AStarRequest> AStarRequests;
+/// Index in AStarRequests of the request of each unit slot, -1 if none
+static std::vector<int> AStarRequestOfSlot;
+/// Game cycle of the current batch
+static unsigned long AStarRequestsCycle;
 
-static int *CostMoveToCache;
-static const int CacheNotSet = -5;
+/// Threads helping the main thread to solve the batch
+static std::vector<AStarWorker *> AStarWorkers;
+/// Posted by the helper threads when their share is solved
+static SDL_sem *AStarWorkDone;
+/// Tell the helper threads to exit
+static bool AStarWorkersQuit;
 
 /*----------------------------------------------------------------------------
 --  Profile
@@ -245,28 +305,57 @@ inline void ProfilePrint()
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Allocate the scratch state of a search.
+*/
+void AStarContext::Init(int mapWidth, int mapHeight)
+{
+	Free();
+
+	MatrixSize = sizeof(Node) * mapWidth * mapHeight;
+	Matrix = new Node[mapWidth * mapHeight];
+	memset(Matrix, 0, MatrixSize);
+
+	Threshold = mapWidth * mapHeight / MAX_CLOSE_SET_RATIO;
+	CloseSet = new int[Threshold];
+	CloseSetSize = 0;
+
+	OpenSet.Init(mapWidth * mapHeight);
+
+	CostMoveToCache = new int[mapWidth * mapHeight];
+}
+
+/**
+**  Free the scratch state of a search.
+*/
+void AStarContext::Free()
+{
+	delete[] Matrix;
+	Matrix = NULL;
+	MatrixSize = 0;
+	delete[] CloseSet;
+	CloseSet = NULL;
+	CloseSetSize = 0;
+	Threshold = 0;
+	OpenSet.Init(0);
+	delete[] CostMoveToCache;
+	CostMoveToCache = NULL;
+}
+
+static void AStarStopWorkers();
+
 /**
 **  Init A* data structures
 */
 void InitAStar(int mapWidth, int mapHeight)
 {
 	// Should only be called once
-	Assert(!AStarMatrix);
+	Assert(!MainContext.Matrix);
 
 	AStarMapWidth = mapWidth;
 	AStarMapHeight = mapHeight;
 
-	AStarMatrixSize = sizeof(Node) * AStarMapWidth * AStarMapHeight;
-	AStarMatrix = new Node[AStarMapWidth * AStarMapHeight];
-	memset(AStarMatrix, 0, AStarMatrixSize);
-
-	Threshold = AStarMapWidth * AStarMapHeight / MAX_CLOSE_SET_RATIO;
-	CloseSet = new int[Threshold];
-
-	OpenSetMaxSize = AStarMapWidth * AStarMapHeight / MAX_OPEN_SET_RATIO;
-	OpenSet = new Open[OpenSetMaxSize];
-
-	CostMoveToCache = new int[AStarMapWidth * AStarMapHeight];
+	MainContext.Init(AStarMapWidth, AStarMapHeight);
 
 	for (int i = 0; i < 9; ++i) {
 		Heading2O[i] = Heading2Y[i] * AStarMapWidth;
@@ -280,16 +369,10 @@ void InitAStar(int mapWidth, int mapHeight)
 */
 void FreeAStar()
 {
-	delete[] AStarMatrix;
-	AStarMatrix = NULL;
-	delete[] CloseSet;
-	CloseSet = NULL;
-	CloseSetSize = 0;
-	delete[] OpenSet;
-	OpenSet = NULL;
-	OpenSetSize = 0;
-	delete[] CostMoveToCache;
-	CostMoveToCache = NULL;
+	AStarStopWorkers();
+	MainContext.Free();
+	AStarRequests.clear();
+	AStarRequestOfSlot.clear();
 
 	ProfilePrint();
 }
@@ -297,35 +380,35 @@ void FreeAStar()
 /**
 **  Prepare pathfinder.
 */
-static void AStarPrepare()
+static void AStarPrepare(AStarContext &ctx)
 {
-	memset(AStarMatrix, 0, AStarMatrixSize);
+	memset(ctx.Matrix, 0, ctx.MatrixSize);
 }
 
 /**
 **  Clean up A*
 */
-static void AStarCleanUp()
+static void AStarCleanUp(AStarContext &ctx)
 {
 	ProfileBegin("AStarCleanUp");
 
-	if (CloseSetSize >= Threshold) {
-		AStarPrepare();
+	if (ctx.CloseSetSize >= ctx.Threshold) {
+		AStarPrepare(ctx);
 	} else {
-		for (int i = 0; i < CloseSetSize; ++i) {
-			AStarMatrix[CloseSet[i]].CostFromStart = 0;
-			AStarMatrix[CloseSet[i]].InGoal = 0;
+		for (int i = 0; i < ctx.CloseSetSize; ++i) {
+			ctx.Matrix[ctx.CloseSet[i]].CostFromStart = 0;
+			ctx.Matrix[ctx.CloseSet[i]].InGoal = 0;
 		}
 	}
 	ProfileEnd("AStarCleanUp");
 }
 
-static void CostMoveToCacheCleanUp()
+static void CostMoveToCacheCleanUp(AStarContext &ctx)
 {
 	ProfileBegin("CostMoveToCacheCleanUp");
 	int AStarMapMax =  AStarMapWidth * AStarMapHeight;
 #if 1
-	int *ptr = CostMoveToCache;
+	int *ptr = ctx.CostMoveToCache;
 #ifdef __x86_64__
 	union {
 		intptr_t d;
@@ -358,146 +441,47 @@ static void CostMoveToCacheCleanUp()
 	}
 #else
 	for (int i = 0; i < AStarMapMax; ++i) {
-		CostMoveToCache[i] = CacheNotSet;
+		ctx.CostMoveToCache[i] = CacheNotSet;
 	}
 #endif
 	ProfileEnd("CostMoveToCacheCleanUp");
 }
 
-/**
-**  Find the best node in the current open node set
-**  Returns the position of this node in the open node set
-*/
-#define AStarFindMinimum() (OpenSetSize - 1)
-
-
-/**
-**  Remove the minimum from the open node set
-*/
-static void AStarRemoveMinimum(int pos)
-{
-	Assert(pos == OpenSetSize - 1);
-
-	OpenSetSize--;
-}
-
 /**
 **  Add a new node to the open set (and update the heap structure)
-**
-**  @return  0 or PF_FAILED
 */
-static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
+static inline void AStarAddNode(AStarContext &ctx, const Vec2i &pos, int o, int costs)
 {
 	ProfileBegin("AStarAddNode");
 
-	int bigi = 0, smalli = OpenSetSize;
-	int midcost;
-	int midi;
-	int midCostToGoal;
-	int midDist;
-	const Open *open;
-
-	if (OpenSetSize + 1 >= OpenSetMaxSize) {
-		fprintf(stderr, "A* internal error: raise Open Set Max Size "
-				"(current value %d)\n", OpenSetMaxSize);
-		ProfileEnd("AStarAddNode");
-		return PF_FAILED;
-	}
+	const int costToGoal = ctx.Matrix[o].CostToGoal;
+	const int dist = MyAbs(pos.x - ctx.GoalX) + MyAbs(pos.y - ctx.GoalY);
 
-	const int costToGoal = AStarMatrix[o].CostToGoal;
-	const int dist = MyAbs(pos.x - AStarGoalX) + MyAbs(pos.y - AStarGoalY);
-
-	// find where we should insert this node.
-	// binary search where to insert the new node
-	while (bigi < smalli) {
-		midi = (smalli + bigi) >> 1;
-		open = &OpenSet[midi];
-		midcost = open->Costs;
-		midCostToGoal = AStarMatrix[open->O].CostToGoal;
-		midDist = MyAbs(open->pos.x - AStarGoalX) + MyAbs(open->pos.y - AStarGoalY);
-		if (costs > midcost || (costs == midcost
-								&& (costToGoal > midCostToGoal || (costToGoal == midCostToGoal
-																   && dist > midDist)))) {
-			smalli = midi;
-		} else if (costs < midcost || (costs == midcost
-									   && (costToGoal < midCostToGoal || (costToGoal == midCostToGoal
-											   && dist < midDist)))) {
-			if (bigi == midi) {
-				bigi++;
-			} else {
-				bigi = midi;
-			}
-		} else {
-			bigi = midi;
-			smalli = midi;
-		}
-	}
-
-	if (OpenSetSize > bigi) {
-		// free a the slot for our node
-		memmove(&OpenSet[bigi + 1], &OpenSet[bigi], (OpenSetSize - bigi) * sizeof(Open));
-	}
-
-	// fill our new node
-	OpenSet[bigi].pos = pos;
-	OpenSet[bigi].O = o;
-	OpenSet[bigi].Costs = costs;
-	++OpenSetSize;
+	ctx.OpenSet.Push(pos, o, costs, costToGoal, dist);
 
 	ProfileEnd("AStarAddNode");
-
-	return 0;
 }
 
 /**
 **  Change the cost associated to an open node.
-**  Can be further optimised knowing that the new cost MUST BE LOWER
-**  than the old one.
+**  The new cost MUST BE LOWER than the old one.
 */
-static void AStarReplaceNode(int pos)
+static void AStarReplaceNode(AStarContext &ctx, int pos, int costs)
 {
 	ProfileBegin("AStarReplaceNode");
 
-	Open node;
+	ctx.OpenSet.Decrease(pos, costs, ctx.Matrix[ctx.OpenSet[pos].O].CostToGoal);
 
-	// Remove the outdated node
-	node = OpenSet[pos];
-	OpenSetSize--;
-	//memmove(&OpenSet[pos], &OpenSet[pos+1], sizeof(Open) * (OpenSetSize-pos));
-	memcpy(&OpenSet[pos], &OpenSet[pos + 1], sizeof(Open) * (OpenSetSize - pos));
-
-	// Re-add the node with the new cost
-	AStarAddNode(node.pos, node.O, node.Costs);
 	ProfileEnd("AStarReplaceNode");
 }
 
-
-/**
-**  Check if a node is already in the open set.
-**
-**  @return  -1 if not found and the position of the node in the table if found.
-*/
-static int AStarFindNode(int eo)
-{
-	ProfileBegin("AStarFindNode");
-
-	for (int i = 0; i < OpenSetSize; ++i) {
-		if (OpenSet[i].O == eo) {
-			ProfileEnd("AStarFindNode");
-			return i;
-		}
-	}
-	ProfileEnd("AStarFindNode");
-	return -1;
-}
-
 /**
 **  Add a node to the closed set
 */
-static void AStarAddToClose(int node)
+static void AStarAddToClose(AStarContext &ctx, int node)
 {
-	if (CloseSetSize < Threshold) {
-		CloseSet[CloseSetSize++] = node;
+	if (ctx.CloseSetSize < ctx.Threshold) {
+		ctx.CloseSet[ctx.CloseSetSize++] = node;
 	}
 }
 
@@ -580,9 +564,9 @@ static int CostMoveToCallBack_Default(unsigned int index, const CUnit &unit)
 **                0 -> no induced cost, except move
 **               >0 -> costly tile
 */
-static inline int CostMoveTo(unsigned int index, const CUnit &unit)
+static inline int CostMoveTo(AStarContext &ctx, unsigned int index, const CUnit &unit)
 {
-	int *c = &CostMoveToCache[index];
+	int *c = &ctx.CostMoveToCache[index];
 	if (*c != CacheNotSet) {
 		return *c;
 	}
@@ -593,19 +577,20 @@ static inline int CostMoveTo(unsigned int index, const CUnit &unit)
 class AStarGoalMarker
 {
 public:
-	AStarGoalMarker(const CUnit &unit, bool *goal_reachable) :
-		unit(unit), goal_reachable(goal_reachable)
+	AStarGoalMarker(AStarContext &ctx, const CUnit &unit, bool *goal_reachable) :
+		ctx(ctx), unit(unit), goal_reachable(goal_reachable)
 	{}
 
 	void operator()(int offset) const
 	{
-		if (CostMoveTo(offset, unit) >= 0) {
-			AStarMatrix[offset].InGoal = 1;
+		if (CostMoveTo(ctx, offset, unit) >= 0) {
+			ctx.Matrix[offset].InGoal = 1;
 			*goal_reachable = true;
 		}
-		AStarAddToClose(offset);
+		AStarAddToClose(ctx, offset);
 	}
 private:
+	AStarContext &ctx;
 	const CUnit &unit;
 	bool *goal_reachable;
 };
@@ -770,7 +755,7 @@ private:
 /**
 **  MarkAStarGoal
 */
-static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
+static int AStarMarkGoal(AStarContext &ctx, const Vec2i &goal, int gw, int gh,
 						 int tilesizex, int tilesizey, int minrange, int maxrange, const CUnit &unit)
 {
 	ProfileBegin("AStarMarkGoal");
@@ -781,8 +766,8 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 			return 0;
 		}
 		unsigned int offset = GetIndex(goal.x, goal.y);
-		if (CostMoveTo(offset, unit) >= 0) {
-			AStarMatrix[offset].InGoal = 1;
+		if (CostMoveTo(ctx, offset, unit) >= 0) {
+			ctx.Matrix[offset].InGoal = 1;
 			ProfileEnd("AStarMarkGoal");
 			return 1;
 		} else {
@@ -796,7 +781,7 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 	gw = std::max(gw, 1);
 	gh = std::max(gh, 1);
 
-	AStarGoalMarker aStarGoalMarker(unit, &goal_reachable);
+	AStarGoalMarker aStarGoalMarker(ctx, unit, &goal_reachable);
 	MinMaxRangeVisitor<AStarGoalMarker> visitor(aStarGoalMarker);
 
 	const Vec2i goalBottomRigth(goal.x + gw - 1, goal.y + gh - 1);
@@ -818,7 +803,7 @@ static int AStarMarkGoal(const Vec2i &goal, int gw, int gh,
 **
 **  @return  The length of the path
 */
-static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen)
+static int AStarSavePath(const AStarContext &ctx, const Vec2i &startPos, const Vec2i &endPos, char *path, int pathLen)
 {
 	ProfileBegin("AStarSavePath");
 
@@ -831,7 +816,7 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 	Vec2i curr = endPos;
 	int currO = curr.y * AStarMapWidth;
 	while (curr != startPos) {
-		direction = AStarMatrix[currO + curr.x].Direction;
+		direction = ctx.Matrix[currO + curr.x].Direction;
 		curr.x -= Heading2X[direction];
 		curr.y -= Heading2Y[direction];
 		currO -= Heading2O[direction];
@@ -845,7 +830,7 @@ static int AStarSavePath(const Vec2i &startPos, const Vec2i &endPos, char *path,
 		curr = endPos;
 		currO = curr.y * AStarMapWidth;
 		while (curr != startPos) {
-			direction = AStarMatrix[currO + curr.x].Direction;
+			direction = ctx.Matrix[currO + curr.x].Direction;
 			curr.x -= Heading2X[direction];
 			curr.y -= Heading2Y[direction];
 			currO -= Heading2O[direction];
@@ -892,7 +877,8 @@ static int AStarFindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw,
 
 	if (MyAbs(diff.x) <= 1 && MyAbs(diff.y) <= 1) {
 		// Move to adjacent cell
-		if (CostMoveTo(GetIndex(goal.x, goal.y), unit) == -1) {
+		// Don't use the cache here, it still holds the costs of the previous search
+		if (CostMoveToCallBack_Default(GetIndex(goal.x, goal.y), unit) == -1) {
 			ProfileEnd("AStarFindSimplePath");
 			return PF_UNREACHABLE;
 		}
@@ -909,60 +895,50 @@ static int AStarFindSimplePath(const Vec2i &startPos, const Vec2i &goal, int gw,
 }
 
 /**
-**  Find path.
+**  Search a path with the full A* algorithm.
+**
+**  Only reads the map and the units, so several searches with different
+**  contexts can run at the same time.
 */
-int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
-				  int tilesizex, int tilesizey, int minrange, int maxrange,
-				  char *path, int pathlen, const CUnit &unit)
+static int AStarSearch(AStarContext &ctx, const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					   int tilesizex, int tilesizey, int minrange, int maxrange,
+					   char *path, int pathlen, const CUnit &unit)
 {
-	Assert(Map.Info.IsPointOnMap(startPos));
-
-	ProfileBegin("AStarFindPath");
+	ProfileBegin("AStarSearch");
 
-	AStarGoalX = goalPos.x;
-	AStarGoalY = goalPos.y;
-
-	//  Check for simple cases first
-	int ret = AStarFindSimplePath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
-								  minrange, maxrange, path, unit);
-	if (ret != PF_FAILED) {
-		ProfileEnd("AStarFindPath");
-		return ret;
-	}
+	ctx.GoalX = goalPos.x;
+	ctx.GoalY = goalPos.y;
 
 	//  Initialize
-	AStarCleanUp();
-	CostMoveToCacheCleanUp();
+	AStarCleanUp(ctx);
+	CostMoveToCacheCleanUp(ctx);
 
-	OpenSetSize = 0;
-	CloseSetSize = 0;
+	ctx.OpenSet.Clear();
+	ctx.CloseSetSize = 0;
 
-	if (!AStarMarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
+	int ret;
+	if (!AStarMarkGoal(ctx, goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
 		// goal is not reachable
 		ret = PF_UNREACHABLE;
-		ProfileEnd("AStarFindPath");
+		ProfileEnd("AStarSearch");
 		return ret;
 	}
 
 	int eo = startPos.y * AStarMapWidth + startPos.x;
 	// it is quite important to start from 1 rather than 0, because we use
 	// 0 as a way to represent nodes that we have not visited yet.
-	AStarMatrix[eo].CostFromStart = 1;
+	ctx.Matrix[eo].CostFromStart = 1;
 	// 8 to say we are came from nowhere.
-	AStarMatrix[eo].Direction = 8;
+	ctx.Matrix[eo].Direction = 8;
 
-	// place start point in open, it that failed, try another pathfinder
+	// place start point in open
 	int costToGoal = AStarCosts(startPos, goalPos);
-	AStarMatrix[eo].CostToGoal = costToGoal;
-	if (AStarAddNode(startPos, eo, 1 + costToGoal) == PF_FAILED) {
-		ret = PF_FAILED;
-		ProfileEnd("AStarFindPath");
-		return ret;
-	}
-	AStarAddToClose(OpenSet[0].O);
-	if (AStarMatrix[eo].InGoal) {
+	ctx.Matrix[eo].CostToGoal = costToGoal;
+	AStarAddNode(ctx, startPos, eo, 1 + costToGoal);
+	AStarAddToClose(ctx, eo);
+	if (ctx.Matrix[eo].InGoal) {
 		ret = PF_REACHED;
-		ProfileEnd("AStarFindPath");
+		ProfileEnd("AStarSearch");
 		return ret;
 	}
 	Vec2i endPos;
@@ -970,15 +946,14 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 	//  Begin search
 	while (1) {
 		// Find the best node of from the open set
-		const int shortest = AStarFindMinimum();
-		const int x = OpenSet[shortest].pos.x;
-		const int y = OpenSet[shortest].pos.y;
-		const int o = OpenSet[shortest].O;
+		const int x = ctx.OpenSet.Top().pos.x;
+		const int y = ctx.OpenSet.Top().pos.y;
+		const int o = ctx.OpenSet.Top().O;
 
-		AStarRemoveMinimum(shortest);
+		ctx.OpenSet.Pop();
 
 		// If we have reached the goal, then exit.
-		if (AStarMatrix[o].InGoal == 1) {
+		if (ctx.Matrix[o].InGoal == 1) {
 			endPos.x = x;
 			endPos.y = y;
 			break;
@@ -991,7 +966,7 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 			// Nearest point to goal.
 			AstarDebugPrint("way too long\n");
 			ret = PF_FAILED;
-			ProfileEnd("AStarFindPath");
+			ProfileEnd("AStarSearch");
 			return ret;
 		}
 #endif
@@ -999,8 +974,8 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 		// Generate successors of this node.
 
 		// Node that this node was generated from.
-		const int px = x - Heading2X[(int)AStarMatrix[o].Direction];
-		const int py = y - Heading2Y[(int)AStarMatrix[o].Direction];
+		const int px = x - Heading2X[(int)ctx.Matrix[o].Direction];
+		const int py = y - Heading2Y[(int)ctx.Matrix[o].Direction];
 
 		for (int i = 0; i < 8; ++i) {
 			endPos.x = x + Heading2X[i];
@@ -1025,7 +1000,7 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 			// if the point is "move to"-able and
 			// if we have not reached this point before,
 			// or if we have a better path to it, we add it to open set
-			int new_cost = CostMoveTo(eo, unit);
+			int new_cost = CostMoveTo(ctx, eo, unit);
 			if (new_cost == -1) {
 				// uncrossable tile
 				continue;
@@ -1033,54 +1008,306 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 
 			// Add a cost for walking to make paths more realistic for the user.
 			new_cost++;
-			new_cost += AStarMatrix[o].CostFromStart;
-			if (AStarMatrix[eo].CostFromStart == 0) {
+			new_cost += ctx.Matrix[o].CostFromStart;
+			if (ctx.Matrix[eo].CostFromStart == 0) {
 				// we are sure the current node has not been already visited
-				AStarMatrix[eo].CostFromStart = new_cost;
-				AStarMatrix[eo].Direction = i;
+				ctx.Matrix[eo].CostFromStart = new_cost;
+				ctx.Matrix[eo].Direction = i;
 				costToGoal = AStarCosts(endPos, goalPos);
-				AStarMatrix[eo].CostToGoal = costToGoal;
-				if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
-					ret = PF_FAILED;
-					ProfileEnd("AStarFindPath");
-					return ret;
-				}
+				ctx.Matrix[eo].CostToGoal = costToGoal;
+				AStarAddNode(ctx, endPos, eo, ctx.Matrix[eo].CostFromStart + costToGoal);
 				// we add the point to the close set
-				AStarAddToClose(eo);
-			} else if (new_cost < AStarMatrix[eo].CostFromStart) {
+				AStarAddToClose(ctx, eo);
+			} else if (new_cost < ctx.Matrix[eo].CostFromStart) {
 				// Already visited node, but we have here a better path
 				// I know, it's redundant (but simpler like this)
-				AStarMatrix[eo].CostFromStart = new_cost;
-				AStarMatrix[eo].Direction = i;
+				ctx.Matrix[eo].CostFromStart = new_cost;
+				ctx.Matrix[eo].Direction = i;
 				// this point might be already in the OpenSet
-				const int j = AStarFindNode(eo);
+				const int j = ctx.OpenSet.Find(eo);
+				costToGoal = AStarCosts(endPos, goalPos);
+				ctx.Matrix[eo].CostToGoal = costToGoal;
 				if (j == -1) {
-					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
-						ret = PF_FAILED;
-						ProfileEnd("AStarFindPath");
-						return ret;
-					}
+					AStarAddNode(ctx, endPos, eo, ctx.Matrix[eo].CostFromStart + costToGoal);
 				} else {
-					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					AStarReplaceNode(j);
+					AStarReplaceNode(ctx, j, ctx.Matrix[eo].CostFromStart + costToGoal);
 				}
 				// we don't have to add this point to the close set
 			}
 		}
-		if (OpenSetSize <= 0) { // no new nodes generated
+		if (ctx.OpenSet.Empty()) { // no new nodes generated
 			ret = PF_UNREACHABLE;
-			ProfileEnd("AStarFindPath");
+			ProfileEnd("AStarSearch");
 			return ret;
 		}
 	}
 
-	const int path_length = AStarSavePath(startPos, endPos, path, pathlen);
+	const int path_length = AStarSavePath(ctx, startPos, endPos, path, pathlen);
 
 	ret = path_length;
 
+	ProfileEnd("AStarSearch");
+	return ret;
+}
+
+/*----------------------------------------------------------------------------
+--  Batched searches
+----------------------------------------------------------------------------*/
+
+/// Distance between two requests solved by the same thread
+static size_t AStarWorkStep = 1;
+
+/**
+**  Solve a share of the batched path requests.
+**
+**  @param ctx    Scratch state of the calling thread.
+**  @param first  Index of the first request to solve.
+*/
+static void AStarSolveRequests(AStarContext &ctx, size_t first)
+{
+	for (size_t i = first; i < AStarRequests.size(); i += AStarWorkStep) {
+		AStarRequest &request = AStarRequests[i];
+
+		int ret = AStarFindSimplePath(request.StartPos, request.GoalPos,
+									  request.GoalWidth, request.GoalHeight,
+									  request.TileSizeX, request.TileSizeY,
+									  request.MinRange, request.MaxRange,
+									  request.Path, *request.Unit);
+		if (ret == PF_FAILED) {
+			if (request.MayReach) {
+				ret = AStarSearch(ctx, request.StartPos, request.GoalPos,
+								  request.GoalWidth, request.GoalHeight,
+								  request.TileSizeX, request.TileSizeY,
+								  request.MinRange, request.MaxRange,
+								  request.Path, PathFinderOutput::MAX_PATH_LENGTH, *request.Unit);
+			} else {
+				ret = PF_UNREACHABLE;
+			}
+		}
+		request.Result = ret;
+	}
+}
+
+/**
+**  Main loop of the threads helping to solve the batch.
+*/
+static int AStarWorkerLoop(void *data)
+{
+	AStarWorker &worker = *static_cast<AStarWorker *>(data);
+
+	while (1) {
+		SDL_SemWait(worker.Start);
+		if (AStarWorkersQuit) {
+			break;
+		}
+		AStarSolveRequests(worker.Context, worker.Index);
+		SDL_SemPost(AStarWorkDone);
+	}
+	return 0;
+}
+
+/**
+**  Stop the threads helping to solve the batch.
+*/
+static void AStarStopWorkers()
+{
+	AStarWorkersQuit = true;
+	for (size_t i = 0; i != AStarWorkers.size(); ++i) {
+		AStarWorker *worker = AStarWorkers[i];
+
+		if (worker->Thread) {
+			SDL_SemPost(worker->Start);
+			SDL_WaitThread(worker->Thread, NULL);
+		}
+		SDL_DestroySemaphore(worker->Start);
+		delete worker;
+	}
+	AStarWorkers.clear();
+	if (AStarWorkDone) {
+		SDL_DestroySemaphore(AStarWorkDone);
+		AStarWorkDone = NULL;
+	}
+}
+
+/**
+**  Start the threads helping to solve the batch.
+**
+**  @param count  Number of threads.
+*/
+static void AStarStartWorkers(int count)
+{
+	AStarWorkersQuit = false;
+	AStarWorkDone = SDL_CreateSemaphore(0);
+	for (int i = 0; i < count; ++i) {
+		AStarWorker *worker = new AStarWorker;
+
+		worker->Index = i + 1;
+		worker->Start = SDL_CreateSemaphore(0);
+		worker->Context.Init(AStarMapWidth, AStarMapHeight);
+		AStarWorkers.push_back(worker);
+	}
+	for (int i = 0; i < count; ++i) {
+		AStarWorkers[i]->Thread = SDL_CreateThread(AStarWorkerLoop, AStarWorkers[i]);
+		if (!AStarWorkers[i]->Thread) {
+			fprintf(stderr, "Can't create path finder thread, solving path requests in the main thread\n");
+			AStarStopWorkers();
+			return;
+		}
+	}
+}
+
+/**
+**  Start a new batch of path requests.
+*/
+void AStarBatchBegin()
+{
+	for (size_t i = 0; i != AStarRequests.size(); ++i) {
+		AStarRequestOfSlot[UnitNumber(*AStarRequests[i].Unit)] = -1;
+	}
+	AStarRequests.clear();
+	AStarRequestsCycle = GameCycle;
+}
+
+/**
+**  Add a path request to the batch.
+**
+**  Same parameters as AStarFindPath, the path is always searched with
+**  the max length of PathFinderOutput.
+*/
+void AStarBatchAdd(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				   int tilesizex, int tilesizey, int minrange, int maxrange,
+				   const CUnit &unit)
+{
+	Assert(Map.Info.IsPointOnMap(startPos));
+
+	const size_t slot = UnitNumber(unit);
+	if (slot >= AStarRequestOfSlot.size()) {
+		AStarRequestOfSlot.resize(slot + 1, -1);
+	}
+	if (AStarRequestOfSlot[slot] != -1) {
+		return;
+	}
+	AStarRequest request;
+
+	request.Unit = &unit;
+	request.StartPos = startPos;
+	request.GoalPos = goalPos;
+	request.GoalWidth = gw;
+	request.GoalHeight = gh;
+	request.TileSizeX = tilesizex;
+	request.TileSizeY = tilesizey;
+	request.MinRange = minrange;
+	request.MaxRange = maxrange;
+	// The reachability index updates itself, ask it before going parallel
+	request.MayReach = ReachabilityMayReach(unit, startPos, goalPos, gw, gh, tilesizex, tilesizey, maxrange);
+	request.Used = false;
+	request.Result = PF_FAILED;
+	AStarRequestOfSlot[slot] = AStarRequests.size();
+	AStarRequests.push_back(request);
+}
+
+/**
+**  Solve all the path requests of the batch.
+**
+**  The requests are shared between the main thread and AStarBatchThreads
+**  helper threads.  The searches only read the map as it is at the start
+**  of the cycle, so the results don't depend on the number of threads.
+*/
+void AStarBatchSolve()
+{
+	if ((int)AStarWorkers.size() != AStarBatchThreads) {
+		AStarStopWorkers();
+		if (AStarBatchThreads > 0) {
+			AStarStartWorkers(AStarBatchThreads);
+		}
+	}
+	size_t active = std::min(AStarWorkers.size(), AStarRequests.size() / 2);
+#ifdef ASTAR_PROFILE
+	// The profiler isn't thread safe
+	active = 0;
+#endif
+
+	AStarWorkStep = active + 1;
+	for (size_t i = 0; i != active; ++i) {
+		SDL_SemPost(AStarWorkers[i]->Start);
+	}
+	AStarSolveRequests(MainContext, 0);
+	for (size_t i = 0; i != active; ++i) {
+		SDL_SemWait(AStarWorkDone);
+	}
+}
+
+/**
+**  Get the result of the batch for a path request.
+**
+**  A result is handed out only once and only in the cycle of the batch.
+**
+**  @return  true if the batch has the result, false to search the path.
+*/
+static bool AStarBatchResult(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+							 int tilesizex, int tilesizey, int minrange, int maxrange,
+							 char *path, const CUnit &unit, int *result)
+{
+	if (AStarRequests.empty() || AStarRequestsCycle != GameCycle) {
+		return false;
+	}
+	const size_t slot = UnitNumber(unit);
+	if (slot >= AStarRequestOfSlot.size() || AStarRequestOfSlot[slot] == -1) {
+		return false;
+	}
+	AStarRequest &request = AStarRequests[AStarRequestOfSlot[slot]];
+	if (request.Used || request.Unit != &unit
+		|| request.StartPos != startPos || request.GoalPos != goalPos
+		|| request.GoalWidth != gw || request.GoalHeight != gh
+		|| request.TileSizeX != tilesizex || request.TileSizeY != tilesizey
+		|| request.MinRange != minrange || request.MaxRange != maxrange) {
+		return false;
+	}
+	request.Used = true;
+	if (request.Result > 0) {
+		memcpy(path, request.Path, std::min<int>(request.Result, PathFinderOutput::MAX_PATH_LENGTH));
+	}
+	*result = request.Result;
+	return true;
+}
+
+/**
+**  Find path.
+*/
+int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+				  int tilesizex, int tilesizey, int minrange, int maxrange,
+				  char *path, int pathlen, const CUnit &unit)
+{
+	Assert(Map.Info.IsPointOnMap(startPos));
+
+	ProfileBegin("AStarFindPath");
+
+	// Already solved by the batch of this cycle
+	int ret;
+	if (path != NULL && pathlen == PathFinderOutput::MAX_PATH_LENGTH
+		&& AStarBatchResult(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							minrange, maxrange, path, unit, &ret)) {
+		ProfileEnd("AStarFindPath");
+		return ret;
+	}
+
+	//  Check for simple cases first
+	ret = AStarFindSimplePath(startPos, goalPos, gw, gh, tilesizex, tilesizey,
+							  minrange, maxrange, path, unit);
+	if (ret != PF_FAILED) {
+		ProfileEnd("AStarFindPath");
+		return ret;
+	}
+
+	// Goal in another connected component, don't search
+	if (!ReachabilityMayReach(unit, startPos, goalPos, gw, gh, tilesizex, tilesizey, maxrange)) {
+		ProfileEnd("AStarFindPath");
+		return PF_UNREACHABLE;
+	}
+
+	ret = AStarSearch(MainContext, startPos, goalPos, gw, gh, tilesizex, tilesizey,
+					  minrange, maxrange, path, pathlen, unit);
+
 	ProfileEnd("AStarFindPath");
 	return ret;
 }
@@ -1099,7 +1326,7 @@ StatsNode *AStarGetStats()
 {
 	StatsNode *stats = new StatsNode[AStarMapWidth * AStarMapHeight];
 	StatsNode *s = stats;
-	Node *m = AStarMatrix;
+	Node *m = MainContext.Matrix;
 
 	for (int j = 0; j < AStarMapHeight; ++j) {
 		for (int i = 0; i < AStarMapWidth; ++i) {
@@ -1112,8 +1339,9 @@ StatsNode *AStarGetStats()
 		}
 	}
 
-	for (int i = 0; i < OpenSetSize; ++i) {
-		stats[OpenSet[i].O].Costs = OpenSet[i].Costs;
+	const AStarOpenSet &openSet = MainContext.OpenSet;
+	for (size_t i = 0; i < openSet.Size(); ++i) {
+		stats[openSet[i].O].Costs = openSet[i].Costs;
 	}
 	return stats;
 }
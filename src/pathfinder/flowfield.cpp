@@ -0,0 +1,332 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name flowfield.cpp - The shared flow field path finder for group moves. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "map.h"
+#include "player.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unittype.h"
+
+#include "pathfinder.h"
+
+#include <map>
+#include <queue>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Flow field toward one goal tile for one movement mask.
+**
+**  The integration field holds the cost to reach the goal from every tile,
+**  the direction field the heading to follow from every tile.
+**  Only the static flags (terrain, walls, buildings) are considered.
+**
+**  Without AStarKnowUnseenTerrain, the field is built for the view of one
+**  player: like in the a*, unexplored tiles are passable with an extra
+**  cost.
+*/
+class FlowField
+{
+public:
+	FlowField() : LastUsedCycle(0), BuiltCycle(0), Dirty(false) {}
+
+	void Build(int mask, int player, const Vec2i &goalPos);
+
+	std::vector<int> Costs;         /// Integration field, -1 unreachable
+	std::vector<char> Directions;   /// Direction field, 8 for none
+	unsigned long LastUsedCycle;    /// Last cycle a unit used this field
+	unsigned long BuiltCycle;       /// Cycle the field was computed
+	bool Dirty;                     /// Terrain changed since the build
+};
+
+/**
+**  Units which asked for a goal without flow field yet.
+*/
+struct FlowFieldRequest {
+	FlowFieldRequest() : LastUsedCycle(0) {}
+
+	std::vector<int> Requesters;    /// Units which asked for this goal
+	unsigned long LastUsedCycle;    /// Last cycle a unit asked for this goal
+};
+
+/// Goal offset, then movement mask and player (-1 if the terrain is known)
+typedef std::pair<unsigned int, std::pair<int, int> > FlowFieldKey;
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// see pathfinder.h
+bool FlowFieldPathfinder = false;
+int FlowFieldMinUnits = 4;
+
+/// Distance to goal below which the a* is used for the final approach
+static const int FlowFieldMinDistance = 8;
+/// Cycles after which an unused field is dropped
+static const unsigned long FlowFieldExpireCycles = 10 * CYCLES_PER_SECOND;
+/// Minimum cycles between two rebuilds of a field after terrain changes
+static const unsigned long FlowFieldRefreshCycles = CYCLES_PER_SECOND;
+/// Cycles between two rebuilds of a player view, for newly explored tiles
+static const unsigned long FlowFieldExploreCycles = 2 * CYCLES_PER_SECOND;
+/// Maximum number of fields kept
+static const size_t FlowFieldMaxCount = 8;
+/// Maximum number of goals waiting for enough units
+static const size_t FlowFieldMaxRequests = 64;
+
+/// Built fields, at most FlowFieldMaxCount
+static std::map<FlowFieldKey, FlowField> FlowFields;
+/// Goals not requested by enough units yet, they don't count in the fields
+static std::map<FlowFieldKey, FlowFieldRequest> FlowFieldRequests;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Compute the integration and direction fields toward goalPos.
+*/
+void FlowField::Build(int mask, int player, const Vec2i &goalPos)
+{
+	const int width = Map.Info.MapWidth;
+	const int height = Map.Info.MapHeight;
+	const int staticMask = mask & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit);
+	typedef std::pair<int, unsigned int> CostOffset;
+	std::priority_queue<CostOffset, std::vector<CostOffset>, std::greater<CostOffset> > open;
+
+	Costs.assign(width * height, -1);
+	Directions.assign(width * height, 8);
+
+	// Dijkstra sweep from the goal, the goal itself may be blocked.
+	const unsigned int goalOffset = Map.getIndex(goalPos);
+	Costs[goalOffset] = 0;
+	open.push(CostOffset(0, goalOffset));
+	while (!open.empty()) {
+		const CostOffset current = open.top();
+		open.pop();
+		if (current.first != Costs[current.second]) {
+			continue;
+		}
+		const int x = current.second % width;
+		const int y = current.second / width;
+		// Cost of entering the current tile from a neighbour.
+		const CMapField &mf = *Map.Field(current.second);
+		int step = 1 + mf.getCost();
+		if (player != -1 && !mf.playerInfo.IsExplored(Players[player])) {
+			step += AStarUnknownTerrainCost;
+		}
+		for (int i = 0; i < 8; ++i) {
+			const int nx = x + Heading2X[i];
+			const int ny = y + Heading2Y[i];
+			if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+				continue;
+			}
+			const unsigned int o = nx + ny * width;
+			const CMapField &neighbour = *Map.Field(o);
+			if ((neighbour.Flags & staticMask)
+				&& (player == -1 || neighbour.playerInfo.IsExplored(Players[player]))) {
+				continue;
+			}
+			const int cost = current.first + step;
+			if (Costs[o] == -1 || cost < Costs[o]) {
+				Costs[o] = cost;
+				// Heading from the neighbour back to the current tile.
+				Directions[o] = (i + 4) % 8;
+				open.push(CostOffset(cost, o));
+			}
+		}
+	}
+	BuiltCycle = GameCycle;
+	Dirty = false;
+}
+
+/**
+**  Drop the entries unused for a while, then the least recently used ones
+**  until at most maxCount are left.
+*/
+template <typename T>
+static void FlowFieldExpire(std::map<FlowFieldKey, T> &entries, size_t maxCount)
+{
+	typedef typename std::map<FlowFieldKey, T>::iterator Iterator;
+
+	for (Iterator it = entries.begin(); it != entries.end();) {
+		if (it->second.LastUsedCycle + FlowFieldExpireCycles < GameCycle) {
+			entries.erase(it++);
+		} else {
+			++it;
+		}
+	}
+	while (entries.size() > maxCount) {
+		Iterator oldest = entries.begin();
+		for (Iterator it = entries.begin(); it != entries.end(); ++it) {
+			if (it->second.LastUsedCycle < oldest->second.LastUsedCycle) {
+				oldest = it;
+			}
+		}
+		entries.erase(oldest);
+	}
+}
+
+/**
+**  Free the flow fields.
+*/
+void FreeFlowFields()
+{
+	FlowFields.clear();
+	FlowFieldRequests.clear();
+}
+
+/**
+**  Mark the flow fields as outdated after a terrain change.
+*/
+void FlowFieldTerrainChanged()
+{
+	for (std::map<FlowFieldKey, FlowField>::iterator it = FlowFields.begin(); it != FlowFields.end(); ++it) {
+		it->second.Dirty = true;
+	}
+}
+
+/**
+**  Find a path following the flow field shared by all units moving to
+**  the same goal.
+**
+/**
+**  Check if pos is within maxrange of goalPos, with the distance of the a*.
+*/
+static bool FlowFieldInRange(const Vec2i &pos, const Vec2i &goalPos, int maxrange)
+{
+	return square(pos.x - goalPos.x) + square(pos.y - goalPos.y) < square(maxrange + 1);
+}
+
+/**
+**  Find a path following the flow field shared by all units moving to
+**  the same goal.
+**
+**  The field is built once FlowFieldMinUnits different units asked for
+**  the same goal tile, so a group move costs a single Dijkstra sweep.
+**  The path stops at the first tile within maxrange of the goal.
+**  The final approach, bigger units, and goals with size or minimum range
+**  are left to the a*.
+**
+**  @return  PF_FAILED if the a* must be used, else the stored path length.
+*/
+int FlowFieldFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+					  int tilesizex, int tilesizey, int minrange, int maxrange,
+					  char *path, int pathlen, const CUnit &unit)
+{
+	if (tilesizex != 1 || tilesizey != 1 || gw != 0 || gh != 0 || minrange != 0
+		|| path == NULL || unit.Type->MovementMask == 0 || !Map.Info.IsPointOnMap(goalPos)
+		|| std::max(abs(startPos.x - goalPos.x), abs(startPos.y - goalPos.y)) <= FlowFieldMinDistance
+		|| FlowFieldInRange(startPos, goalPos, maxrange)) {
+		return PF_FAILED;
+	}
+	const int player = AStarKnowUnseenTerrain ? -1 : unit.Player->Index;
+	const FlowFieldKey key(Map.getIndex(goalPos), std::make_pair(unit.Type->MovementMask, player));
+	std::map<FlowFieldKey, FlowField>::iterator it = FlowFields.find(key);
+
+	if (it == FlowFields.end()) {
+		FlowFieldRequest &request = FlowFieldRequests[key];
+		const int id = UnitNumber(unit);
+
+		request.LastUsedCycle = GameCycle;
+		if (std::find(request.Requesters.begin(), request.Requesters.end(), id) == request.Requesters.end()) {
+			request.Requesters.push_back(id);
+		}
+		if ((int)request.Requesters.size() < FlowFieldMinUnits) {
+			FlowFieldExpire(FlowFieldRequests, FlowFieldMaxRequests);
+			return PF_FAILED;
+		}
+		FlowFieldRequests.erase(key);
+		// Make room before the insertion, so the new field is never the one dropped.
+		FlowFieldExpire(FlowFields, FlowFieldMaxCount - 1);
+		it = FlowFields.insert(std::make_pair(key, FlowField())).first;
+		it->second.Build(unit.Type->MovementMask, player, goalPos);
+	} else if ((it->second.Dirty && it->second.BuiltCycle + FlowFieldRefreshCycles <= GameCycle)
+			   || (player != -1 && it->second.BuiltCycle + FlowFieldExploreCycles <= GameCycle)) {
+		it->second.Build(unit.Type->MovementMask, player, goalPos);
+	}
+	FlowField &field = it->second;
+	field.LastUsedCycle = GameCycle;
+
+	unsigned int offset = Map.getIndex(startPos);
+	if (field.Costs[offset] <= 0) {
+		return PF_FAILED;
+	}
+
+	// First step: follow the field, or the best free neighbour if a unit is in the way.
+	int direction = field.Directions[offset];
+	if (direction == 8 || !UnitCanBeAt(unit, startPos + Vec2i(Heading2X[direction], Heading2Y[direction]))) {
+		int bestCost = field.Costs[offset];
+		direction = 8;
+		for (int i = 0; i < 8; ++i) {
+			const Vec2i pos(startPos.x + Heading2X[i], startPos.y + Heading2Y[i]);
+			if (!Map.Info.IsPointOnMap(pos)) {
+				continue;
+			}
+			const int cost = field.Costs[Map.getIndex(pos)];
+			if (cost != -1 && cost < bestCost && UnitCanBeAt(unit, pos)) {
+				bestCost = cost;
+				direction = i;
+			}
+		}
+		if (direction == 8) {
+			return PF_FAILED;
+		}
+	}
+
+	// Follow the direction field, the first step is stored at the end.
+	std::vector<char> steps;
+	Vec2i pos = startPos;
+	while ((int)steps.size() < pathlen && direction != 8) {
+		steps.push_back(direction);
+		pos.x += Heading2X[direction];
+		pos.y += Heading2Y[direction];
+		if (FlowFieldInRange(pos, goalPos, maxrange)) {
+			break;
+		}
+		offset = Map.getIndex(pos);
+		direction = field.Directions[offset];
+	}
+	const int length = steps.size();
+	for (int i = 0; i < length; ++i) {
+		path[length - 1 - i] = steps[i];
+	}
+	return length;
+}
+
+//@}
@@ -0,0 +1,588 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name hpastar.cpp - The hierarchical a* path finder routines. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "map.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unittype.h"
+
+#include "pathfinder.h"
+
+#include <map>
+#include <queue>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/// in astar.cpp
+extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, int minrange,
+						 int maxrange, char *path, int pathlen, const CUnit &unit);
+
+/**
+**  Abstract graph of the map for one movement mask.
+**
+**  The map is split in square clusters. Along the border of two clusters,
+**  each run of tiles passable on both sides gives one transition (two at
+**  the ends of long runs). The tiles of these transitions are the nodes
+**  of the abstract graph: inside a cluster they are linked by their
+**  precomputed distances, across a border by a single step.
+**
+**  Only the static flags (terrain, walls, buildings) are considered,
+**  units are left to the low level a*.
+*/
+class HierarchicalLayer
+{
+public:
+	HierarchicalLayer(int mask, int clusterSize);
+
+	void MarkDirty(const Vec2i &pos);
+	int FindPath(const Vec2i &startPos, const Vec2i &goalPos, Vec2i *waypoint);
+
+	int GetClusterSize() const { return clusterSize; }
+
+private:
+	struct Cluster {
+		Cluster() : Dirty(true) {}
+
+		std::vector<int> Nodes;              /// Offsets of the transition tiles
+		std::vector<int> Dist;               /// Nodes x Nodes distances, -1 unreachable
+		std::vector<std::vector<int> > Links;/// Offsets of the nodes across the borders
+		std::vector<std::pair<int, int> > East;  /// Transitions with the east cluster
+		std::vector<std::pair<int, int> > South; /// Transitions with the south cluster
+		bool Dirty;                          /// Cluster must be rebuilt
+	};
+
+	bool IsPassable(int offset) const
+	{
+		return (Map.Field(offset)->Flags & mask & StaticFlagsMask) == 0;
+	}
+	int StepCost(int offset) const { return 1 + Map.Field(offset)->getCost(); }
+
+	int ClusterIndex(const Vec2i &pos) const
+	{
+		return pos.x / clusterSize + (pos.y / clusterSize) * clustersWidth;
+	}
+	int ClusterIndex(int offset) const
+	{
+		return ClusterIndex(Vec2i(offset % Map.Info.MapWidth, offset / Map.Info.MapWidth));
+	}
+	void GetClusterBounds(int index, Vec2i *minPos, Vec2i *maxPos) const;
+
+	typedef std::pair<int, int> CostNode;
+	typedef std::priority_queue<CostNode, std::vector<CostNode>, std::greater<CostNode> > OpenQueue;
+
+	void Update();
+	void Relax(OpenQueue &open, int node, int cost, int parent, const Vec2i &goalPos);
+	void BuildBorder(int index, bool east);
+	void BuildNodes(int index);
+	void LocalDistances(int index, int from, std::vector<int> &dist) const;
+
+private:
+	static const int StaticFlagsMask = ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit);
+
+	int mask;
+	int clusterSize;
+	int clustersWidth;
+	int clustersHeight;
+	bool dirty;
+	std::vector<Cluster> clusters;
+	std::vector<short> localIndex;  /// offset -> index in its Cluster::Nodes, or -1
+
+	// Abstract search scratch buffers, reset by generation.
+	std::vector<int> costs;
+	std::vector<int> parents;
+	std::vector<unsigned int> generations;
+	unsigned int generation;
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// see pathfinder.h
+bool HierarchicalPathfinder = false;
+int HierarchicalClusterSize = 16;
+
+/// Abstract graphs by movement mask, built on first use
+static std::map<int, HierarchicalLayer *> HierarchicalLayers;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+HierarchicalLayer::HierarchicalLayer(int mask, int clusterSize) :
+	mask(mask), clusterSize(clusterSize), dirty(true), generation(0)
+{
+	const unsigned int mapSize = Map.Info.MapWidth * Map.Info.MapHeight;
+
+	clustersWidth = (Map.Info.MapWidth + clusterSize - 1) / clusterSize;
+	clustersHeight = (Map.Info.MapHeight + clusterSize - 1) / clusterSize;
+	clusters.resize(clustersWidth * clustersHeight);
+	localIndex.assign(mapSize, -1);
+	// One extra slot for the virtual goal node.
+	costs.resize(mapSize + 1);
+	parents.resize(mapSize + 1);
+	generations.assign(mapSize + 1, 0);
+}
+
+void HierarchicalLayer::GetClusterBounds(int index, Vec2i *minPos, Vec2i *maxPos) const
+{
+	minPos->x = (index % clustersWidth) * clusterSize;
+	minPos->y = (index / clustersWidth) * clusterSize;
+	maxPos->x = std::min<int>(minPos->x + clusterSize, Map.Info.MapWidth) - 1;
+	maxPos->y = std::min<int>(minPos->y + clusterSize, Map.Info.MapHeight) - 1;
+}
+
+/**
+**  Mark the cluster of pos to be rebuilt on next search.
+*/
+void HierarchicalLayer::MarkDirty(const Vec2i &pos)
+{
+	clusters[ClusterIndex(pos)].Dirty = true;
+	dirty = true;
+}
+
+/**
+**  Find the transitions between a cluster and its east or south neighbour.
+*/
+void HierarchicalLayer::BuildBorder(int index, bool east)
+{
+	std::vector<std::pair<int, int> > &border = east ? clusters[index].East : clusters[index].South;
+	Vec2i minPos;
+	Vec2i maxPos;
+
+	border.clear();
+	GetClusterBounds(index, &minPos, &maxPos);
+	if ((east && maxPos.x + 1 >= Map.Info.MapWidth) || (!east && maxPos.y + 1 >= Map.Info.MapHeight)) {
+		return;
+	}
+	const int length = east ? maxPos.y - minPos.y + 1 : maxPos.x - minPos.x + 1;
+	const int first = east ? Map.getIndex(maxPos.x, minPos.y) : Map.getIndex(minPos.x, maxPos.y);
+	const int step = east ? Map.Info.MapWidth : 1;
+	const int across = east ? 1 : Map.Info.MapWidth;
+
+	for (int i = 0; i < length;) {
+		if (!IsPassable(first + i * step) || !IsPassable(first + i * step + across)) {
+			++i;
+			continue;
+		}
+		const int start = i;
+		while (i < length && IsPassable(first + i * step) && IsPassable(first + i * step + across)) {
+			++i;
+		}
+		const int end = i - 1;
+		if (end - start + 1 < 6) {
+			const int o = first + ((start + end) / 2) * step;
+			border.push_back(std::make_pair(o, o + across));
+		} else {
+			border.push_back(std::make_pair(first + start * step, first + start * step + across));
+			border.push_back(std::make_pair(first + end * step, first + end * step + across));
+		}
+	}
+}
+
+/**
+**  Compute the costs from tile 'from' to every tile of a cluster.
+**
+**  @param index  Cluster index.
+**  @param from   Map offset of the first tile, may be unpassable.
+**  @param dist   Filled with the costs by cluster local index, -1 unreachable.
+*/
+void HierarchicalLayer::LocalDistances(int index, int from, std::vector<int> &dist) const
+{
+	Vec2i minPos;
+	Vec2i maxPos;
+	GetClusterBounds(index, &minPos, &maxPos);
+	const int width = maxPos.x - minPos.x + 1;
+	const int height = maxPos.y - minPos.y + 1;
+	typedef std::pair<int, int> CostPos;
+	std::priority_queue<CostPos, std::vector<CostPos>, std::greater<CostPos> > open;
+
+	dist.assign(width * height, -1);
+	const Vec2i fromPos(from % Map.Info.MapWidth, from / Map.Info.MapWidth);
+	const int fromLocal = (fromPos.x - minPos.x) + (fromPos.y - minPos.y) * width;
+	dist[fromLocal] = 0;
+	open.push(CostPos(0, fromLocal));
+	while (!open.empty()) {
+		const CostPos current = open.top();
+		open.pop();
+		if (current.first != dist[current.second]) {
+			continue;
+		}
+		const int x = current.second % width;
+		const int y = current.second / width;
+		for (int i = 0; i < 8; ++i) {
+			const int nx = x + Heading2X[i];
+			const int ny = y + Heading2Y[i];
+			if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+				continue;
+			}
+			const int o = Map.getIndex(minPos.x + nx, minPos.y + ny);
+			if (!IsPassable(o)) {
+				continue;
+			}
+			const int cost = current.first + StepCost(o);
+			int &d = dist[nx + ny * width];
+			if (d == -1 || cost < d) {
+				d = cost;
+				open.push(CostPos(cost, nx + ny * width));
+			}
+		}
+	}
+}
+
+/**
+**  Collect the nodes of a cluster from its four borders and link them.
+*/
+void HierarchicalLayer::BuildNodes(int index)
+{
+	Cluster &cluster = clusters[index];
+	const int cx = index % clustersWidth;
+	const int cy = index / clustersWidth;
+	std::vector<std::pair<int, int> > links;
+
+	for (size_t i = 0; i != cluster.East.size(); ++i) {
+		links.push_back(cluster.East[i]);
+	}
+	for (size_t i = 0; i != cluster.South.size(); ++i) {
+		links.push_back(cluster.South[i]);
+	}
+	if (cx > 0) {
+		const std::vector<std::pair<int, int> > &west = clusters[index - 1].East;
+		for (size_t i = 0; i != west.size(); ++i) {
+			links.push_back(std::make_pair(west[i].second, west[i].first));
+		}
+	}
+	if (cy > 0) {
+		const std::vector<std::pair<int, int> > &north = clusters[index - clustersWidth].South;
+		for (size_t i = 0; i != north.size(); ++i) {
+			links.push_back(std::make_pair(north[i].second, north[i].first));
+		}
+	}
+	std::sort(links.begin(), links.end());
+
+	for (size_t i = 0; i != cluster.Nodes.size(); ++i) {
+		localIndex[cluster.Nodes[i]] = -1;
+	}
+	cluster.Nodes.clear();
+	cluster.Links.clear();
+	for (size_t i = 0; i != links.size(); ++i) {
+		if (cluster.Nodes.empty() || cluster.Nodes.back() != links[i].first) {
+			localIndex[links[i].first] = cluster.Nodes.size();
+			cluster.Nodes.push_back(links[i].first);
+			cluster.Links.push_back(std::vector<int>());
+		}
+		cluster.Links.back().push_back(links[i].second);
+	}
+
+	Vec2i minPos;
+	Vec2i maxPos;
+	GetClusterBounds(index, &minPos, &maxPos);
+	const int width = maxPos.x - minPos.x + 1;
+	const size_t count = cluster.Nodes.size();
+	std::vector<int> dist;
+
+	cluster.Dist.assign(count * count, -1);
+	for (size_t i = 0; i != count; ++i) {
+		LocalDistances(index, cluster.Nodes[i], dist);
+		for (size_t j = 0; j != count; ++j) {
+			const int o = cluster.Nodes[j];
+			const int local = (o % Map.Info.MapWidth - minPos.x) + (o / Map.Info.MapWidth - minPos.y) * width;
+			cluster.Dist[i * count + j] = dist[local];
+		}
+	}
+}
+
+/**
+**  Rebuild the dirty clusters.
+**
+**  A dirty cluster changes its own borders and the borders of its west
+**  and north neighbours, so the nodes of all four neighbours are rebuilt.
+*/
+void HierarchicalLayer::Update()
+{
+	if (!dirty) {
+		return;
+	}
+	const int count = clusters.size();
+	std::vector<char> rebuild(count, 0);
+
+	for (int i = 0; i != count; ++i) {
+		if (!clusters[i].Dirty) {
+			continue;
+		}
+		const int cx = i % clustersWidth;
+		const int cy = i / clustersWidth;
+
+		BuildBorder(i, true);
+		BuildBorder(i, false);
+		rebuild[i] = 1;
+		if (cx > 0) {
+			BuildBorder(i - 1, true);
+			rebuild[i - 1] = 1;
+		}
+		if (cy > 0) {
+			BuildBorder(i - clustersWidth, false);
+			rebuild[i - clustersWidth] = 1;
+		}
+		if (cx + 1 < clustersWidth) {
+			rebuild[i + 1] = 1;
+		}
+		if (cy + 1 < clustersHeight) {
+			rebuild[i + clustersWidth] = 1;
+		}
+	}
+	for (int i = 0; i != count; ++i) {
+		if (rebuild[i]) {
+			BuildNodes(i);
+			clusters[i].Dirty = false;
+		}
+	}
+	dirty = false;
+}
+
+/**
+**  Update the cost of an abstract node if the new cost is better.
+*/
+void HierarchicalLayer::Relax(OpenQueue &open, int node, int cost, int parent, const Vec2i &goalPos)
+{
+	if (generations[node] == generation && costs[node] <= cost) {
+		return;
+	}
+	costs[node] = cost;
+	parents[node] = parent;
+	generations[node] = generation;
+	const Vec2i pos(node % Map.Info.MapWidth, node / Map.Info.MapWidth);
+	open.push(CostNode(cost + std::max(abs(pos.x - goalPos.x), abs(pos.y - goalPos.y)), node));
+}
+
+/**
+**  Search the abstract graph from startPos to goalPos.
+**
+**  @param waypoint  Filled with the first node of the abstract path
+**                   which is outside of the start cluster.
+**
+**  @return          PF_MOVE if found, PF_FAILED otherwise.
+*/
+int HierarchicalLayer::FindPath(const Vec2i &startPos, const Vec2i &goalPos, Vec2i *waypoint)
+{
+	Update();
+
+	const int mapSize = Map.Info.MapWidth * Map.Info.MapHeight;
+	const int goalNode = mapSize;
+	const int startCluster = ClusterIndex(startPos);
+	const int goalCluster = ClusterIndex(goalPos);
+	const Cluster &start = clusters[startCluster];
+	std::vector<int> startDist;
+	std::vector<int> goalDist;
+	Vec2i minPos;
+	Vec2i maxPos;
+	OpenQueue open;
+
+	if (++generation == 0) {
+		generations.assign(generations.size(), 0);
+		generation = 1;
+	}
+	LocalDistances(startCluster, Map.getIndex(startPos), startDist);
+	LocalDistances(goalCluster, Map.getIndex(goalPos), goalDist);
+
+	// Seed the search with the nodes reachable from the start.
+	GetClusterBounds(startCluster, &minPos, &maxPos);
+	int width = maxPos.x - minPos.x + 1;
+	for (size_t i = 0; i != start.Nodes.size(); ++i) {
+		const int o = start.Nodes[i];
+		const int d = startDist[(o % Map.Info.MapWidth - minPos.x) + (o / Map.Info.MapWidth - minPos.y) * width];
+		if (d != -1) {
+			Relax(open, o, d, -1, goalPos);
+		}
+	}
+
+	GetClusterBounds(goalCluster, &minPos, &maxPos);
+	width = maxPos.x - minPos.x + 1;
+	while (!open.empty()) {
+		const CostNode current = open.top();
+		open.pop();
+		const int o = current.second;
+
+		if (o == goalNode) {
+			break;
+		}
+		const Vec2i pos(o % Map.Info.MapWidth, o / Map.Info.MapWidth);
+		const int g = costs[o];
+		if (current.first != g + std::max(abs(pos.x - goalPos.x), abs(pos.y - goalPos.y))) {
+			continue; // outdated entry
+		}
+		const int clusterIndex = ClusterIndex(pos);
+		const Cluster &cluster = clusters[clusterIndex];
+		const int i = localIndex[o];
+		Assert(i != -1);
+
+		if (clusterIndex == goalCluster) {
+			const int d = goalDist[(pos.x - minPos.x) + (pos.y - minPos.y) * width];
+			if (d != -1 && (generations[goalNode] != generation || g + d < costs[goalNode])) {
+				costs[goalNode] = g + d;
+				parents[goalNode] = o;
+				generations[goalNode] = generation;
+				open.push(CostNode(g + d, goalNode));
+			}
+		}
+		const size_t count = cluster.Nodes.size();
+		for (size_t j = 0; j != count; ++j) {
+			const int d = cluster.Dist[i * count + j];
+			if (d > 0) {
+				Relax(open, cluster.Nodes[j], g + d, o, goalPos);
+			}
+		}
+		for (size_t j = 0; j != cluster.Links[i].size(); ++j) {
+			const int next = cluster.Links[i][j];
+			Relax(open, next, g + StepCost(next), o, goalPos);
+		}
+	}
+	if (generations[goalNode] != generation) {
+		return PF_FAILED;
+	}
+
+	// Walk back to the first node leaving the start cluster.
+	int first = -1;
+	for (int o = parents[goalNode]; o != -1; o = parents[o]) {
+		if (ClusterIndex(o) != startCluster) {
+			first = o;
+		}
+	}
+	if (first == -1) {
+		return PF_FAILED;
+	}
+	waypoint->x = first % Map.Info.MapWidth;
+	waypoint->y = first / Map.Info.MapWidth;
+	return PF_MOVE;
+}
+
+/**
+**  Free the hierarchical path finder.
+*/
+void FreeHierarchicalPathfinder()
+{
+	for (std::map<int, HierarchicalLayer *>::iterator it = HierarchicalLayers.begin();
+		 it != HierarchicalLayers.end(); ++it) {
+		delete it->second;
+	}
+	HierarchicalLayers.clear();
+}
+
+/**
+**  Init the hierarchical path finder.
+*/
+void InitHierarchicalPathfinder()
+{
+	FreeHierarchicalPathfinder();
+}
+
+/**
+**  Mark the clusters touching the area as dirty.
+**
+**  @param pos  Top left tile of the changed area.
+**  @param w    Width of the area.
+**  @param h    Height of the area.
+*/
+void HierarchicalTerrainChanged(const Vec2i &pos, int w, int h)
+{
+	for (std::map<int, HierarchicalLayer *>::iterator it = HierarchicalLayers.begin();
+		 it != HierarchicalLayers.end(); ++it) {
+		HierarchicalLayer &layer = *it->second;
+		const int step = layer.GetClusterSize();
+		Vec2i it_pos;
+
+		// Visit one tile per cluster, plus the last row/column.
+		for (int y = 0; y < h + step - 1; y += step) {
+			it_pos.y = pos.y + std::min(y, h - 1);
+			for (int x = 0; x < w + step - 1; x += step) {
+				it_pos.x = pos.x + std::min(x, w - 1);
+				if (Map.Info.IsPointOnMap(it_pos)) {
+					layer.MarkDirty(it_pos);
+				}
+			}
+		}
+	}
+}
+
+/**
+**  Find a path using the abstract graph, refining only the first segment.
+**
+**  Only used for 1x1 units whose goal is outside of the neighbour
+**  clusters: shorter searches are cheap enough for the flat a*.
+**
+**  @return  PF_FAILED if the flat a* must be used,
+**           else the result of the a* toward the first waypoint.
+*/
+int HierarchicalFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, char *path, int pathlen, const CUnit &unit)
+{
+	if (tilesizex != 1 || tilesizey != 1 || unit.Type->MovementMask == 0) {
+		return PF_FAILED;
+	}
+	const int clusterSize = std::max(HierarchicalClusterSize, 4);
+	const Vec2i goalCenter(goalPos.x + (std::max(gw, 1) - 1) / 2, goalPos.y + (std::max(gh, 1) - 1) / 2);
+
+	if (!Map.Info.IsPointOnMap(goalCenter)
+		|| (abs(startPos.x / clusterSize - goalCenter.x / clusterSize) <= 1
+			&& abs(startPos.y / clusterSize - goalCenter.y / clusterSize) <= 1)) {
+		return PF_FAILED;
+	}
+
+	HierarchicalLayer *&layer = HierarchicalLayers[unit.Type->MovementMask];
+	if (layer != NULL && layer->GetClusterSize() != clusterSize) {
+		delete layer;
+		layer = NULL;
+	}
+	if (layer == NULL) {
+		layer = new HierarchicalLayer(unit.Type->MovementMask, clusterSize);
+	}
+
+	Vec2i waypoint;
+	if (layer->FindPath(startPos, goalCenter, &waypoint) != PF_MOVE) {
+		return PF_FAILED;
+	}
+	const int ret = AStarFindPath(startPos, waypoint, 0, 0, 1, 1, 0, 0, path, pathlen, unit);
+	if (ret <= 0) {
+		return PF_FAILED;
+	}
+	return ret;
+}
+
+//@}
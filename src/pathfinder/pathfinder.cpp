@@ -41,6 +41,8 @@
 
 #include "actions.h"
 #include "map.h"
+#include "network.h"
+#include "replay.h"
 #include "unittype.h"
 #include "unit.h"
 
@@ -57,36 +59,147 @@ extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, in
 						 int tilesizex, int tilesizey, int minrange,
 						 int maxrange, char *path, int pathlen, const CUnit &unit);
 
+/// Start a new batch of path requests
+extern void AStarBatchBegin();
+
+/// Add a path request to the batch
+extern void AStarBatchAdd(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						  int tilesizex, int tilesizey, int minrange, int maxrange,
+						  const CUnit &unit);
+
+/// Solve all the path requests of the batch
+extern void AStarBatchSolve();
+
+//hpastar.cpp
+
+/// Init the hierarchical path finder
+extern void InitHierarchicalPathfinder();
+
+/// Free the hierarchical path finder
+extern void FreeHierarchicalPathfinder();
+
+/// Mark the abstract graph as dirty around a changed area
+extern void HierarchicalTerrainChanged(const Vec2i &pos, int w, int h);
+
+/// Find a path using the abstract graph, refining the first segment
+extern int HierarchicalFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+								int tilesizex, int tilesizey, char *path, int pathlen,
+								const CUnit &unit);
+
+//reachability.cpp
+
+/// Free the reachability indexes
+extern void FreeReachability();
+
+/// Update the reachability indexes for a changed area
+extern void ReachabilityTerrainChanged(const Vec2i &pos, int w, int h);
+
+//flowfield.cpp
+
+/// Free the flow fields
+extern void FreeFlowFields();
+
+/// Mark the flow fields as outdated
+extern void FlowFieldTerrainChanged();
+
+/// Find a path following the flow field shared with other units
+extern int FlowFieldFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+							 int tilesizex, int tilesizey, int minrange, int maxrange,
+							 char *path, int pathlen, const CUnit &unit);
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
 
+/// see pathfinder.h
+bool PathRepair = false;
+int PathRepairRange = 3;
+int PathRepairsDone;
+int PathRepairsFailed;
+
+/// Max value of PathRepairRange
+static const int PathRepairMaxRange = 8;
+
+/// Value of the border fields, whatever the generation
+static const unsigned int TerrainTraversalBorder = 0xFFFFFFFF;
+/// Last generation before the fields are cleared, the border uses the next one
+static const unsigned int TerrainTraversalMaxGeneration = 0xFFFE;
+
+std::vector<TerrainTraversal::Storage *> TerrainTraversal::Pool;
+
+TerrainTraversal::TerrainTraversal() : m_generation(0), m_queueHead(0)
+{
+	if (Pool.empty()) {
+		m_storage = new Storage;
+	} else {
+		m_storage = Pool.back();
+		Pool.pop_back();
+	}
+}
+
+TerrainTraversal::~TerrainTraversal()
+{
+	Pool.push_back(m_storage);
+}
+
+/**
+**  Free the storages of the pool, all the traversals are done.
+*/
+void TerrainTraversal::FreeStorages()
+{
+	for (size_t i = 0; i != Pool.size(); ++i) {
+		delete Pool[i];
+	}
+	Pool.clear();
+}
+
+/**
+**  Set the size of the map, the fields are only cleared when it changes.
+*/
 void TerrainTraversal::SetSize(unsigned int width, unsigned int height)
 {
-	m_values.resize((width + 2) * (height + 2));
-	m_extented_width = width + 2;
-	m_height = height;
+	Storage &storage = *m_storage;
+
+	if (storage.extendedWidth == width + 2 && storage.height == height) {
+		return;
+	}
+	storage.values.resize((width + 2) * (height + 2));
+	storage.extendedWidth = width + 2;
+	storage.height = height;
+	storage.generation = TerrainTraversalMaxGeneration;
 }
 
+/**
+**  Start a new traversal, only the generation changes unless it wraps.
+*/
 void TerrainTraversal::Init()
 {
-	const unsigned int height = m_height;
-	const unsigned int width = m_extented_width - 2;
-	const unsigned int width_ext = m_extented_width;
-
-	memset(&m_values[0], '\xFF', width_ext * sizeof(dataType));
-	for (unsigned i = 1; i < 1 + height; ++i) {
-		m_values[i * width_ext] = -1;
-		memset(&m_values[i * width_ext + 1], '\0', width * sizeof(dataType));
-		m_values[i * width_ext + width + 1] = -1;
+	Storage &storage = *m_storage;
+
+	if (storage.generation == TerrainTraversalMaxGeneration) {
+		const unsigned int height = storage.height;
+		const unsigned int width_ext = storage.extendedWidth;
+		std::vector<unsigned int> &values = storage.values;
+
+		std::fill(values.begin(), values.end(), 0);
+		std::fill(values.begin(), values.begin() + width_ext, TerrainTraversalBorder);
+		for (unsigned i = 1; i < 1 + height; ++i) {
+			values[i * width_ext] = TerrainTraversalBorder;
+			values[i * width_ext + width_ext - 1] = TerrainTraversalBorder;
+		}
+		std::fill(values.end() - width_ext, values.end(), TerrainTraversalBorder);
+		storage.generation = 0;
 	}
-	memset(&m_values[(height + 1) * width_ext], '\xFF', width_ext * sizeof(dataType));
+	++storage.generation;
+	m_generation = storage.generation << 16;
+	storage.queue.clear();
+	m_queueHead = 0;
 }
 
 void TerrainTraversal::PushPos(const Vec2i &pos)
 {
 	if (IsVisited(pos) == false) {
-		m_queue.push(PosNode(pos, pos));
+		m_storage->queue.push_back(PosNode(pos, pos));
 		Set(pos, 1);
 	}
 }
@@ -97,12 +210,14 @@ void TerrainTraversal::PushNeighboor(const Vec2i &pos)
 							 Vec2i(-1, -1), Vec2i(1, -1), Vec2i(-1, 1), Vec2i(1, 1)
 							};
 
+	const dataType distance = Get(pos) + 1;
+
 	for (int i = 0; i != 8; ++i) {
 		const Vec2i newPos = pos + offsets[i];
 
 		if (IsVisited(newPos) == false) {
-			m_queue.push(PosNode(newPos, pos));
-			Set(newPos, Get(pos) + 1);
+			m_storage->queue.push_back(PosNode(newPos, pos));
+			Set(newPos, distance);
 		}
 	}
 }
@@ -139,12 +254,21 @@ bool TerrainTraversal::IsInvalid(const Vec2i &pos) const
 
 TerrainTraversal::dataType TerrainTraversal::Get(const Vec2i &pos) const
 {
-	return m_values[m_extented_width + 1 + pos.y * m_extented_width + pos.x];
+	const unsigned int width_ext = m_storage->extendedWidth;
+	const unsigned int value = m_storage->values[width_ext + 1 + pos.y * width_ext + pos.x];
+
+	// A field of an older traversal is not visited
+	if ((value & 0xFFFF0000) == m_generation || value == TerrainTraversalBorder) {
+		return dataType(value & 0xFFFF);
+	}
+	return 0;
 }
 
 void TerrainTraversal::Set(const Vec2i &pos, TerrainTraversal::dataType value)
 {
-	m_values[m_extented_width + 1 + pos.y * m_extented_width + pos.x] = value;
+	const unsigned int width_ext = m_storage->extendedWidth;
+
+	m_storage->values[width_ext + 1 + pos.y * width_ext + pos.x] = m_generation | (unsigned short)value;
 }
 
 /*----------------------------------------------------------------------------
@@ -157,6 +281,9 @@ void TerrainTraversal::Set(const Vec2i &pos, TerrainTraversal::dataType value)
 void InitPathfinder()
 {
 	InitAStar(Map.Info.MapWidth, Map.Info.MapHeight);
+	InitHierarchicalPathfinder();
+	FreeFlowFields();
+	FreeReachability();
 }
 
 /**
@@ -165,6 +292,27 @@ void InitPathfinder()
 void FreePathfinder()
 {
 	FreeAStar();
+	TerrainTraversal::FreeStorages();
+	FreeHierarchicalPathfinder();
+	FreeFlowFields();
+	FreeReachability();
+}
+
+/**
+**  Notify the pathfinder that the passability of an area changed.
+**
+**  Called when forest, rocks or walls are removed or placed and when
+**  buildings are placed or destroyed.
+**
+**  @param pos  Top left tile of the area.
+**  @param w    Width of the area.
+**  @param h    Height of the area.
+*/
+void PathfinderTerrainChanged(const Vec2i &pos, int w, int h)
+{
+	HierarchicalTerrainChanged(pos, w, h);
+	FlowFieldTerrainChanged();
+	ReachabilityTerrainChanged(pos, w, h);
 }
 
 /*----------------------------------------------------------------------------
@@ -238,6 +386,87 @@ int UnitReachable(const CUnit &src, const CUnit &dst, int range)
 --  REAL PATH-FINDER
 ----------------------------------------------------------------------------*/
 
+/**
+**  Check if the current order of the unit may move it this cycle.
+*/
+static bool MayMoveThisCycle(const CUnit &unit)
+{
+	if (unit.Destroyed || unit.Removed || unit.Moving || unit.Wait
+		|| unit.Orders.empty() || !unit.CanMove()) {
+		return false;
+	}
+	switch (unit.CurrentAction()) {
+		case UnitActionFollow:
+		case UnitActionDefend:
+		case UnitActionMove:
+		case UnitActionAttack:
+		case UnitActionAttackGround:
+		case UnitActionSpellCast:
+		case UnitActionBoard:
+		case UnitActionUnload:
+		case UnitActionPatrol:
+		case UnitActionBuild:
+		case UnitActionRepair:
+		case UnitActionResource:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+**  Search at once the paths the units will need this cycle.
+**
+**  Called before the units act.  The searches are solved in parallel
+**  against the map as it is at the start of the cycle, each unit takes
+**  its result during its own action if its request didn't change, in the
+**  usual order of the units.
+**
+**  This changes the paths: a unit doesn't see where the units acting
+**  before it in the cycle moved, and its path data is updated before its
+**  action instead of during it.  So the game differs from a game without
+**  batches.  Network games never batch, the handshake doesn't carry the
+**  setting; replays batch as the logged game did (see IsReplayBatchSearch).
+**
+**  The path data of each unit is updated from its current order first,
+**  as NextPathElement does, so new orders and moved goals are batched
+**  with the request the unit will make.
+**
+**  @param units  Units acting this cycle.
+*/
+void PathfinderBatchRequests(const std::vector<CUnit *> &units)
+{
+	if (IsReplayGame() ? !IsReplayBatchSearch() : !AStarBatchSearch || IsNetworkGame()) {
+		return;
+	}
+	AStarBatchBegin();
+	for (size_t i = 0; i != units.size(); ++i) {
+		CUnit &unit = *units[i];
+
+		if (!MayMoveThisCycle(unit)) {
+			continue;
+		}
+		PathFinderInput &input = unit.pathFinderData->input;
+		const PathFinderOutput &output = unit.pathFinderData->output;
+
+		if (input.GetUnit() != &unit) {
+			continue;
+		}
+		unit.CurrentOrder()->UpdatePathFinderData(input);
+		if (input.GetGoalPos().x == -1) {
+			continue;
+		}
+		if (output.Length > 0 && !input.IsRecalculateNeeded()) {
+			continue;
+		}
+		AStarBatchAdd(input.GetUnitPos(), input.GetGoalPos(),
+					  input.GetGoalSize().x, input.GetGoalSize().y,
+					  input.GetUnitSize().x, input.GetUnitSize().y,
+					  input.GetMinRange(), input.GetMaxRange(), unit);
+	}
+	AStarBatchSolve();
+}
+
 PathFinderInput::PathFinderInput() : unit(NULL), minRange(0), maxRange(0),
 	isRecalculatePathNeeded(true)
 {
@@ -327,13 +556,33 @@ PathFinderOutput::PathFinderOutput()
 static int NewPath(PathFinderInput &input, PathFinderOutput &output)
 {
 	char *path = output.Path;
-	int i = AStarFindPath(input.GetUnitPos(),
+	int i = PF_FAILED;
+	if (FlowFieldPathfinder) {
+		i = FlowFieldFindPath(input.GetUnitPos(),
+							  input.GetGoalPos(),
+							  input.GetGoalSize().x, input.GetGoalSize().y,
+							  input.GetUnitSize().x, input.GetUnitSize().y,
+							  input.GetMinRange(), input.GetMaxRange(),
+							  path, PathFinderOutput::MAX_PATH_LENGTH,
+							  *input.GetUnit());
+	}
+	if (i == PF_FAILED && HierarchicalPathfinder) {
+		i = HierarchicalFindPath(input.GetUnitPos(),
+								 input.GetGoalPos(),
+								 input.GetGoalSize().x, input.GetGoalSize().y,
+								 input.GetUnitSize().x, input.GetUnitSize().y,
+								 path, PathFinderOutput::MAX_PATH_LENGTH,
+								 *input.GetUnit());
+	}
+	if (i == PF_FAILED) {
+		i = AStarFindPath(input.GetUnitPos(),
 						  input.GetGoalPos(),
 						  input.GetGoalSize().x, input.GetGoalSize().y,
 						  input.GetUnitSize().x, input.GetUnitSize().y,
 						  input.GetMinRange(), input.GetMaxRange(),
 						  path, PathFinderOutput::MAX_PATH_LENGTH,
 						  *input.GetUnit());
+	}
 	input.PathRacalculated();
 	if (i == PF_FAILED) {
 		i = PF_UNREACHABLE;
@@ -350,6 +599,150 @@ static int NewPath(PathFinderInput &input, PathFinderOutput &output)
 	return i;
 }
 
+/**
+**  Check if a detour of the path repair can cross a position.
+**
+**  Without AStarKnowUnseenTerrain, the unexplored fields are passable, as
+**  for the a*, so that the detours don't reveal what is on them.
+**
+**  @param unit  Unit whose path is repaired.
+**  @param pos   Map tile position of the unit.
+**
+**  @return      true if the detour can cross pos.
+*/
+static bool PathRepairCanBeAt(const CUnit &unit, const Vec2i &pos)
+{
+	if (AStarKnowUnseenTerrain || unit.Type->BoolFlag[NONSOLID_INDEX].value) {
+		return UnitCanBeAt(unit, pos);
+	}
+	const int mask = unit.Type->MovementMask;
+
+	for (int addy = 0; addy < unit.Type->TileHeight; ++addy) {
+		for (int addx = 0; addx < unit.Type->TileWidth; ++addx) {
+			if (!Map.Info.IsPointOnMap(pos.x + addx, pos.y + addy)) {
+				return false;
+			}
+			const CMapField &mf = *Map.Field(pos.x + addx, pos.y + addy);
+
+			if (mf.playerInfo.IsExplored(*unit.Player) && mf.CheckMask(mask)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+**  Try to go around the obstacle blocking the next step of the path.
+**
+**  Search the shortest detour inside a small square around the unit
+**  which joins the cached path after the blocked step, and splice it in
+**  place of the steps before.  This is much cheaper than a new search of
+**  the whole path when units are jammed in a choke point.
+**
+**  @param unit    Unit whose next step is blocked.
+**  @param output  Cached path of the unit, the next step not yet taken.
+**
+**  @return        true if the path was repaired.
+*/
+static bool RepairPath(const CUnit &unit, PathFinderOutput &output)
+{
+	const int range = std::min(PathRepairRange, PathRepairMaxRange);
+	const int size = 2 * range + 1;
+	const Vec2i topLeft(unit.tilePos.x - range, unit.tilePos.y - range);
+	const int length = output.Length;
+
+	if (length < 2 || range < 1) {
+		return false;
+	}
+
+	// Tiles of the cached path, pathPos[i] is reached after i steps
+	Vec2i pathPos[PathFinderOutput::MAX_PATH_LENGTH + 1];
+	pathPos[0] = unit.tilePos;
+	for (int i = 1; i <= length; ++i) {
+		const int dir = output.Path[length - i];
+		pathPos[i].x = pathPos[i - 1].x + Heading2X[dir];
+		pathPos[i].y = pathPos[i - 1].y + Heading2Y[dir];
+	}
+
+	// Breadth first search of the square around the unit
+	const int maxSize = 2 * PathRepairMaxRange + 1;
+	char direction[maxSize * maxSize];
+	unsigned char distance[maxSize * maxSize];
+	Vec2i queue[maxSize * maxSize];
+	int queueBegin = 0;
+	int queueEnd = 0;
+
+	memset(direction, -1, sizeof(direction));
+	direction[range * size + range] = 8;
+	distance[range * size + range] = 0;
+	queue[queueEnd++] = unit.tilePos;
+	while (queueBegin != queueEnd) {
+		const Vec2i pos = queue[queueBegin++];
+		const int index = (pos.y - topLeft.y) * size + pos.x - topLeft.x;
+
+		for (int i = 0; i < 8; ++i) {
+			const Vec2i next(pos.x + Heading2X[i], pos.y + Heading2Y[i]);
+
+			if (next.x < topLeft.x || next.x >= topLeft.x + size
+				|| next.y < topLeft.y || next.y >= topLeft.y + size) {
+				continue;
+			}
+			const int nextIndex = (next.y - topLeft.y) * size + next.x - topLeft.x;
+			if (direction[nextIndex] != -1 || !PathRepairCanBeAt(unit, next)) {
+				continue;
+			}
+			direction[nextIndex] = i;
+			distance[nextIndex] = distance[index] + 1;
+			queue[queueEnd++] = next;
+		}
+	}
+
+	// Join the path where the remaining length is the shortest
+	int best = -1;
+	int bestLength = 0;
+	for (int i = 2; i <= length; ++i) {
+		const Vec2i &pos = pathPos[i];
+
+		if (pos.x < topLeft.x || pos.x >= topLeft.x + size
+			|| pos.y < topLeft.y || pos.y >= topLeft.y + size) {
+			continue;
+		}
+		const int index = (pos.y - topLeft.y) * size + pos.x - topLeft.x;
+		if (direction[index] == -1 || direction[index] == 8) {
+			continue;
+		}
+		const int newLength = distance[index] + length - i;
+		if (best == -1 || newLength <= bestLength) {
+			best = i;
+			bestLength = newLength;
+		}
+	}
+	if (best == -1) {
+		return false;
+	}
+
+	// The steps after the joined tile stay at the start of the array,
+	// the detour is stored after them, its last step first.
+	char path[PathFinderOutput::MAX_PATH_LENGTH + maxSize * maxSize];
+	const int tailLength = length - best;
+	memcpy(path, output.Path, tailLength);
+	int newLength = tailLength;
+	Vec2i pos = pathPos[best];
+	while (pos != unit.tilePos) {
+		const int dir = direction[(pos.y - topLeft.y) * size + pos.x - topLeft.x];
+
+		path[newLength++] = dir;
+		pos.x -= Heading2X[dir];
+		pos.y -= Heading2Y[dir];
+	}
+	// Keep the beginning of the path if it got too long
+	const int excess = std::max(0, newLength - PathFinderOutput::MAX_PATH_LENGTH);
+	memcpy(output.Path, path + excess, newLength - excess);
+	output.Length = newLength - excess;
+	return true;
+}
+
 /**
 **  Returns the next element of a path.
 **
@@ -390,6 +783,25 @@ int NextPathElement(CUnit &unit, short int *pxd, short int *pyd)
 	int result = output.Length;
 	output.Length--;
 	if (!UnitCanBeAt(unit, unit.tilePos + dir)) {
+		if (PathRepair) {
+			// Keep the blocked step, the cached path must start at the unit
+			output.Length++;
+			// Go around the obstacle instead of waiting for a new path
+			if (RepairPath(unit, output)) {
+				++PathRepairsDone;
+				*pxd = Heading2X[(int)output.Path[(int)output.Length - 1]];
+				*pyd = Heading2Y[(int)output.Path[(int)output.Length - 1]];
+				output.Fast = 0;
+				result = output.Length;
+				output.Length--;
+				return result;
+			}
+			++PathRepairsFailed;
+			if (output.Fast == 1) {
+				// Last wait, search a new path next time
+				output.Length = 0;
+			}
+		}
 		// If obstructing unit is moving, wait for a bit.
 		if (output.Fast) {
 			output.Fast--;
@@ -0,0 +1,299 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name reachability.cpp - The connected component reachability index. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "map.h"
+#include "player.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unittype.h"
+
+#include "pathfinder.h"
+
+#include <map>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  Connected components of the map for one movement mask.
+**
+**  Tiles are labeled with a component, joined with a union-find when a
+**  tile becomes passable (forest cut, rocks cleared, building destroyed).
+**  When a tile becomes blocked a component may split: the labeling is
+**  only marked dirty and rebuilt on next use. An outdated labeling only
+**  overestimates connectivity, so it never reports a reachable goal as
+**  unreachable.
+**
+**  Without AStarKnowUnseenTerrain the a* crosses unexplored tiles, so each
+**  player gets its own labeling where unexplored tiles are passable. It is
+**  rebuilt periodically to take new explored tiles into account.
+*/
+class ReachabilityIndex
+{
+public:
+	ReachabilityIndex(int mask, int player);
+
+	void Update();
+	void TerrainChanged(unsigned int offset);
+	int GetComponent(unsigned int offset);
+
+private:
+	bool IsPassable(unsigned int offset) const
+	{
+		const CMapField &mf = *Map.Field(offset);
+		return (mf.Flags & mask) == 0
+			   || (player != -1 && !mf.playerInfo.IsExplored(Players[player]));
+	}
+	int Find(int component);
+	void Relabel();
+
+private:
+	int mask;                    /// static flags of the movement mask
+	int player;                  /// player owning the labeling, -1 for all
+	bool dirty;                  /// a tile was blocked since last labeling
+	unsigned long builtCycle;    /// cycle of the last labeling
+	std::vector<int> labels;     /// component by tile, -1 for blocked
+	std::vector<int> parents;    /// union-find of the components
+};
+
+/// Movement mask and player
+typedef std::pair<int, int> ReachabilityKey;
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// Cycles between two labelings of a player view, for newly explored tiles
+static const unsigned long ReachabilityRefreshCycles = 2 * CYCLES_PER_SECOND;
+
+static std::map<ReachabilityKey, ReachabilityIndex *> ReachabilityIndexes;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+ReachabilityIndex::ReachabilityIndex(int mask, int player) :
+	mask(mask & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit)),
+	player(player), dirty(true), builtCycle(0)
+{
+}
+
+int ReachabilityIndex::Find(int component)
+{
+	while (parents[component] != component) {
+		parents[component] = parents[parents[component]];
+		component = parents[component];
+	}
+	return component;
+}
+
+/**
+**  Flood fill all the components of the map.
+*/
+void ReachabilityIndex::Relabel()
+{
+	const int width = Map.Info.MapWidth;
+	const int height = Map.Info.MapHeight;
+	std::vector<unsigned int> stack;
+
+	labels.assign(width * height, -1);
+	parents.clear();
+	for (int start = 0; start != width * height; ++start) {
+		if (labels[start] != -1 || !IsPassable(start)) {
+			continue;
+		}
+		const int component = parents.size();
+		parents.push_back(component);
+		labels[start] = component;
+		stack.push_back(start);
+		while (!stack.empty()) {
+			const unsigned int offset = stack.back();
+			stack.pop_back();
+			const int x = offset % width;
+			const int y = offset / width;
+			for (int i = 0; i < 8; ++i) {
+				const int nx = x + Heading2X[i];
+				const int ny = y + Heading2Y[i];
+				if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+					continue;
+				}
+				const unsigned int o = nx + ny * width;
+				if (labels[o] == -1 && IsPassable(o)) {
+					labels[o] = component;
+					stack.push_back(o);
+				}
+			}
+		}
+	}
+	dirty = false;
+	builtCycle = GameCycle;
+}
+
+/**
+**  Relabel the map if a component may have been split.
+*/
+void ReachabilityIndex::Update()
+{
+	if (dirty || labels.empty()
+		|| (player != -1 && builtCycle + ReachabilityRefreshCycles <= GameCycle)) {
+		Relabel();
+	}
+}
+
+/**
+**  Take a change of the tile at offset into account.
+*/
+void ReachabilityIndex::TerrainChanged(unsigned int offset)
+{
+	if (labels.empty() || dirty) {
+		return;
+	}
+	const bool passable = IsPassable(offset);
+
+	if (!passable && labels[offset] != -1) {
+		dirty = true;
+		return;
+	}
+	if (!passable || labels[offset] != -1) {
+		return;
+	}
+	// Tile opened: join the components around.
+	const int width = Map.Info.MapWidth;
+	const int x = offset % width;
+	const int y = offset / width;
+	int component = parents.size();
+
+	parents.push_back(component);
+	labels[offset] = component;
+	for (int i = 0; i < 8; ++i) {
+		const int nx = x + Heading2X[i];
+		const int ny = y + Heading2Y[i];
+		if (nx < 0 || nx >= width || ny < 0 || ny >= Map.Info.MapHeight) {
+			continue;
+		}
+		const int label = labels[nx + ny * width];
+		if (label != -1) {
+			parents[Find(label)] = component;
+		}
+	}
+}
+
+/**
+**  Get the component of a tile.
+**
+**  @return  component number, -1 if the tile is blocked.
+*/
+int ReachabilityIndex::GetComponent(unsigned int offset)
+{
+	const int label = labels[offset];
+	return label == -1 ? -1 : Find(label);
+}
+
+/**
+**  Free the reachability indexes.
+*/
+void FreeReachability()
+{
+	for (std::map<ReachabilityKey, ReachabilityIndex *>::iterator it = ReachabilityIndexes.begin();
+		 it != ReachabilityIndexes.end(); ++it) {
+		delete it->second;
+	}
+	ReachabilityIndexes.clear();
+}
+
+/**
+**  Update the reachability indexes for a changed area.
+*/
+void ReachabilityTerrainChanged(const Vec2i &pos, int w, int h)
+{
+	for (std::map<ReachabilityKey, ReachabilityIndex *>::iterator it = ReachabilityIndexes.begin();
+		 it != ReachabilityIndexes.end(); ++it) {
+		Vec2i it_pos;
+		for (it_pos.y = pos.y; it_pos.y < pos.y + h; ++it_pos.y) {
+			for (it_pos.x = pos.x; it_pos.x < pos.x + w; ++it_pos.x) {
+				if (Map.Info.IsPointOnMap(it_pos)) {
+					it->second->TerrainChanged(Map.getIndex(it_pos));
+				}
+			}
+		}
+	}
+}
+
+/**
+**  Check if the goal area may be reachable from startPos.
+**
+**  Cheap test done before the a* search: a point goal costs O(1), a goal
+**  with size or range costs the area of the goal.
+**
+**  @return  false only if no tile of the goal area is connected to startPos.
+*/
+bool ReachabilityMayReach(const CUnit &unit, const Vec2i &startPos, const Vec2i &goalPos,
+						  int gw, int gh, int tilesizex, int tilesizey, int maxrange)
+{
+	const int mask = unit.Type->MovementMask;
+	if (mask == 0) {
+		return true;
+	}
+	const int player = AStarKnowUnseenTerrain ? -1 : unit.Player->Index;
+	ReachabilityIndex *&index = ReachabilityIndexes[ReachabilityKey(mask, player)];
+
+	if (index == NULL) {
+		index = new ReachabilityIndex(mask, player);
+	}
+	index->Update();
+
+	const int startComponent = index->GetComponent(Map.getIndex(startPos));
+	if (startComponent == -1) {
+		return true;
+	}
+	// Unit top left positions from which the unit may touch the goal area.
+	Vec2i minPos(goalPos.x - maxrange - (tilesizex - 1), goalPos.y - maxrange - (tilesizey - 1));
+	Vec2i maxPos(goalPos.x + std::max(gw, 1) - 1 + maxrange, goalPos.y + std::max(gh, 1) - 1 + maxrange);
+	Map.FixSelectionArea(minPos, maxPos);
+
+	for (Vec2i it = minPos; it.y <= maxPos.y; ++it.y) {
+		for (it.x = minPos.x; it.x <= maxPos.x; ++it.x) {
+			if (index->GetComponent(Map.getIndex(it)) == startComponent) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//@}
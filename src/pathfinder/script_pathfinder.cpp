@@ -93,6 +93,58 @@ static int CclAStar(lua_State *l)
 			} else {
 				AStarUnknownTerrainCost = i;
 			}
+		} else if (!strcmp(value, "use-flow-field")) {
+			FlowFieldPathfinder = true;
+		} else if (!strcmp(value, "dont-use-flow-field")) {
+			FlowFieldPathfinder = false;
+		} else if (!strcmp(value, "flow-field-min-units")) {
+			++j;
+			i = LuaToNumber(l, j + 1);
+			if (i < 1) {
+				PrintFunction();
+				fprintf(stdout, "Flow field min units must be strictly > 0\n");
+			} else {
+				FlowFieldMinUnits = i;
+			}
+		} else if (!strcmp(value, "use-hierarchical")) {
+			HierarchicalPathfinder = true;
+		} else if (!strcmp(value, "dont-use-hierarchical")) {
+			HierarchicalPathfinder = false;
+		} else if (!strcmp(value, "hierarchical-cluster-size")) {
+			++j;
+			i = LuaToNumber(l, j + 1);
+			if (i < 4) {
+				PrintFunction();
+				fprintf(stdout, "Hierarchical cluster size must be >= 4\n");
+			} else {
+				HierarchicalClusterSize = i;
+			}
+		} else if (!strcmp(value, "use-path-repair")) {
+			PathRepair = true;
+		} else if (!strcmp(value, "dont-use-path-repair")) {
+			PathRepair = false;
+		} else if (!strcmp(value, "path-repair-range")) {
+			++j;
+			i = LuaToNumber(l, j + 1);
+			if (i < 1 || i > 8) {
+				PrintFunction();
+				fprintf(stdout, "Path repair range must be between 1 and 8\n");
+			} else {
+				PathRepairRange = i;
+			}
+		} else if (!strcmp(value, "use-batch-search")) {
+			AStarBatchSearch = true;
+		} else if (!strcmp(value, "dont-use-batch-search")) {
+			AStarBatchSearch = false;
+		} else if (!strcmp(value, "batch-threads")) {
+			++j;
+			i = LuaToNumber(l, j + 1);
+			if (i < 0) {
+				PrintFunction();
+				fprintf(stdout, "Batch threads must be non-negative\n");
+			} else {
+				AStarBatchThreads = i;
+			}
 		} else {
 			LuaError(l, "Unsupported tag: %s" _C_ value);
 		}
@@ -62,6 +62,7 @@ public:
 	~PImpl();
 
 	int open(const char *name, long flags);
+	int openBuffer(std::string &buffer);
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
@@ -76,6 +77,7 @@ private:
 private:
 	int   cl_type;   /// type of CFile
 	FILE *cl_plain;  /// standard file pointer
+	std::string *cl_buffer;  /// memory output
 #ifdef USE_ZLIB
 	gzFile cl_gz;    /// gzip file pointer
 #endif // !USE_ZLIB
@@ -107,6 +109,18 @@ int CFile::open(const char *name, long flags)
 	return pimpl->open(name, flags);
 }
 
+/**
+**  Open a memory buffer for writing, the data is appended to it.
+**
+**  @param buffer  Buffer to write to, it must outlive the file.
+**
+**  @return 0 for success
+*/
+int CFile::openBuffer(std::string &buffer)
+{
+	return pimpl->openBuffer(buffer);
+}
+
 /**
 **  CLclose Library file close
 */
@@ -191,6 +205,17 @@ int CFile::printf(const char *format, ...)
 	return ret;
 }
 
+/**
+**  CLwrite Library file write
+**
+**  @param buf  Pointer to the data to write.
+**  @param len  number of bytes to write.
+*/
+int CFile::write(const void *buf, size_t len)
+{
+	return pimpl->write(buf, len);
+}
+
 //
 //  Implementation.
 //
@@ -347,6 +372,16 @@ int CFile::PImpl::open(const char *name, long openflags)
 	return 0;
 }
 
+int CFile::PImpl::openBuffer(std::string &buffer)
+{
+	if (cl_type != CLF_TYPE_INVALID) {
+		close();
+	}
+	cl_buffer = &buffer;
+	cl_type = CLF_TYPE_BUFFER;
+	return 0;
+}
+
 int CFile::PImpl::close()
 {
 	int ret = EOF;
@@ -356,6 +391,9 @@ int CFile::PImpl::close()
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = fclose(cl_plain);
 		}
+		if (tp == CLF_TYPE_BUFFER) {
+			ret = 0;
+		}
 #ifdef USE_ZLIB
 		if (tp == CLF_TYPE_GZIP) {
 			ret = gzclose(cl_gz);
@@ -428,6 +466,10 @@ int CFile::PImpl::write(const void *buf, size_t size)
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = fwrite(buf, size, 1, cl_plain);
 		}
+		if (tp == CLF_TYPE_BUFFER) {
+			cl_buffer->append(static_cast<const char *>(buf), size);
+			ret = size;
+		}
 #ifdef USE_ZLIB
 		if (tp == CLF_TYPE_GZIP) {
 			ret = gzwrite(cl_gz, buf, size);
@@ -479,6 +521,9 @@ long CFile::PImpl::tell()
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = ftell(cl_plain);
 		}
+		if (tp == CLF_TYPE_BUFFER) {
+			ret = cl_buffer->size();
+		}
 #ifdef USE_ZLIB
 		if (tp == CLF_TYPE_GZIP) {
 			ret = gztell(cl_gz);
@@ -42,6 +42,7 @@
 #include "missile.h"
 #include "network.h"
 #include "particle.h"
+#include "profiler.h"
 #include "replay.h"
 #include "results.h"
 #include "sound.h"
@@ -200,6 +201,7 @@ void UpdateDisplay()
 		}
 
 		DrawTimer();
+		DrawProfiler();
 	}
 
 	DrawPieMenu(); // draw pie menu only if needed
@@ -238,14 +240,30 @@ static void GameLogicLoop()
 	// Game logic part
 	//
 	if (!GamePaused && NetworkInSync && !SkipGameCycle) {
+		ReplayKeyframesEachCycle();
 		SinglePlayerReplayEachCycle();
 		++GameCycle;
 		MultiPlayerReplayEachCycle();
-		NetworkCommands(); // Get network commands
-		TriggersEachCycle();// handle triggers
-		UnitActions();      // handle units
-		MissileActions();   // handle missiles
-		PlayersEachCycle(); // handle players
+		{
+			ProfileScope profile(ProfileStageNetwork);
+			NetworkCommands(); // Get network commands
+		}
+		{
+			ProfileScope profile(ProfileStageTriggers);
+			TriggersEachCycle();// handle triggers
+		}
+		{
+			ProfileScope profile(ProfileStageUnits);
+			UnitActions();      // handle units
+		}
+		{
+			ProfileScope profile(ProfileStageMissiles);
+			MissileActions();   // handle missiles
+		}
+		{
+			ProfileScope profile(ProfileStagePlayers);
+			PlayersEachCycle(); // handle players
+		}
 		UpdateTimer();      // update game timer
 
 
@@ -262,6 +280,7 @@ static void GameLogicLoop()
 		switch (GameCycle % CYCLES_PER_SECOND) {
 			case 0: // At cycle 0, start all ai players...
 				if (GameCycle == 0) {
+					ProfileScope profile(ProfileStageAi);
 					for (int player = 0; player < NumPlayers; ++player) {
 						PlayersEachSecond(player);
 					}
@@ -287,6 +306,7 @@ static void GameLogicLoop()
 				int player = (GameCycle % CYCLES_PER_SECOND) - 7;
 				Assert(player >= 0);
 				if (player < NumPlayers) {
+					ProfileScope profile(ProfileStageAi);
 					PlayersEachSecond(player);
 				}
 			}
@@ -294,10 +314,18 @@ static void GameLogicLoop()
 	}
 
 	UpdateMessages();     // update messages
+	CheckAsyncSaveGame(); // finish background save games
 	ParticleManager.update(); // handle particles
 	CheckMusicFinished(); // Check for next song
 
-	if (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f)) {
+	if (HeadlessMode) {
+		if (HeadlessCycleCallback) {
+			HeadlessCycleCallback();
+		}
+		if (HeadlessCycles && GameCycle >= HeadlessCycles) {
+			StopGame(GameNoResult);
+		}
+	} else if (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f)) {
 		WaitEventsOneFrame();
 	}
 
@@ -357,7 +385,10 @@ static void DisplayLoop()
 		//FIXME: this might be better placed somewhere at front of the
 		// program, as we now still have a game on the background and
 		// need to go through the game-menu or supply a map file
-		UpdateDisplay();
+		{
+			ProfileScope profile(ProfileStageDisplay);
+			UpdateDisplay();
+		}
 
 		//
 		// If double-buffered mode, we will display the contains of
@@ -378,9 +409,30 @@ static void SingleGameLoop()
 	while (GameRunning) {
 		DisplayLoop();
 		GameLogicLoop();
+		ProfileEndFrame();
 	}
 }
 
+/**
+**  Game loop of the headless mode: no display and no input, the game
+**  runs as fast as possible.
+*/
+static void HeadlessGameLoop()
+{
+	const unsigned long ticks = GetTicks();
+	const unsigned long startCycle = GameCycle;
+
+	while (GameRunning) {
+		GameLogicLoop();
+		ProfileEndFrame();
+	}
+
+	const unsigned long cycles = GameCycle - startCycle;
+	const unsigned long ms = GetTicks() - ticks;
+	fprintf(stdout, "Headless: %lu cycles in %lu ms, %.0f cycles/s, SyncHash %u\n",
+			cycles, ms, ms ? cycles * 1000. / ms : 0., SyncHash);
+}
+
 /**
 **  Game main loop.
 **
@@ -414,7 +466,13 @@ void GameMainLoop()
 
 	MultiPlayerReplayEachCycle();
 
-	SingleGameLoop();
+	if (HeadlessMode) {
+		HeadlessGameLoop();
+	} else {
+		SingleGameLoop();
+	}
+
+	CheckAsyncSaveGame(true);
 
 	//
 	// Game over
@@ -1223,6 +1223,7 @@ void SetPlayersPalette()
 	for (int i = 0; i < PlayerMax; ++i) {
 		Players[i].UnitColors.Colors = PlayerColorsRGB[i];
 	}
+	FreeAllPlayerColorSurfaces();
 }
 
 /**
@@ -0,0 +1,347 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name profiler.cpp - The frame profiler. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "profiler.h"
+
+#include "font.h"
+#include "game.h"
+#include "iolib.h"
+#include "parameters.h"
+#include "script.h"
+#include "ui.h"
+#include "video.h"
+
+#include <vector>
+
+#ifdef USE_WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  A stage timed by the profiler.
+*/
+struct ProfileEvent {
+	Uint64 Start;         /// Start of the stage in microseconds
+	Uint32 Duration;      /// Duration of the stage in microseconds
+	unsigned long Cycle;  /// Game cycle of the stage
+	ProfileStage Stage;   /// Timed stage
+};
+
+/// Number of stages kept for the export
+static const unsigned int ProfileEventMax = 1 << 16;
+/// Number of frames of the graph
+static const int ProfileFrameMax = 256;
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+bool ProfilerEnabled;  /// Record the time of the stages
+bool ProfilerOverlay;  /// Draw the frame time graph
+
+/// Names of the stages
+static const char *const ProfileStageNames[ProfileStageMax] = {
+	"NetworkCommands",
+	"TriggersEachCycle",
+	"UnitActions",
+	"MissileActions",
+	"PlayersEachCycle",
+	"Ai",
+	"UpdateDisplay"
+};
+
+/// Ring buffer of the last recorded stages
+static std::vector<ProfileEvent> ProfileEvents;
+/// Number of stages recorded since the start, the ring buffer keeps the last ones
+static unsigned long ProfileEventCount;
+
+/// Ring buffer of the time of the stages of the last frames, in microseconds
+static Uint32 ProfileFrames[ProfileFrameMax][ProfileStageMax];
+/// Current frame of the graph
+static int ProfileFrameIndex;
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Get the current time in microseconds.
+*/
+Uint64 ProfileTime()
+{
+#ifdef USE_WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return counter.QuadPart * 1000000 / frequency.QuadPart;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (Uint64)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/**
+**  Record the time of a stage, in the export buffer and in the graph.
+**
+**  Only the game thread records stages.
+**
+**  @param stage  Timed stage.
+**  @param start  Start of the stage in microseconds.
+**  @param end    End of the stage in microseconds.
+*/
+void ProfileRecord(ProfileStage stage, Uint64 start, Uint64 end)
+{
+	if (ProfileEvents.empty()) {
+		ProfileEvents.resize(ProfileEventMax);
+	}
+	ProfileEvent &event = ProfileEvents[ProfileEventCount % ProfileEventMax];
+	event.Start = start;
+	event.Duration = (Uint32)(end - start);
+	event.Cycle = GameCycle;
+	event.Stage = stage;
+	++ProfileEventCount;
+
+	ProfileFrames[ProfileFrameIndex][stage] += event.Duration;
+}
+
+/**
+**  End the current frame of the graph and start the next one.
+*/
+void ProfileEndFrame()
+{
+	if (!ProfilerEnabled) {
+		return;
+	}
+	ProfileFrameIndex = (ProfileFrameIndex + 1) % ProfileFrameMax;
+	memset(ProfileFrames[ProfileFrameIndex], 0, sizeof(ProfileFrames[ProfileFrameIndex]));
+}
+
+/**
+**  Draw the frame time graph over the map.
+**
+**  Each column is a frame with the time of its stages stacked, the white
+**  line is the time of a frame at the normal speed.
+*/
+void DrawProfiler()
+{
+	if (!ProfilerOverlay) {
+		return;
+	}
+	const Uint32 colors[ProfileStageMax] = {
+		ColorLightBlue, ColorOrange, ColorGreen, ColorYellow, ColorBlue, ColorRed, ColorLightGray
+	};
+	const int budget = 1000000 / FRAMES_PER_SECOND;
+	const int height = 64;
+	const int x = UI.MapArea.X + 2;
+	const int y = UI.MapArea.Y + 2;
+
+	Video.FillTransRectangleClip(ColorBlack, x, y, ProfileFrameMax, height, 128);
+	Uint64 total[ProfileStageMax] = {0};
+	for (int i = 0; i < ProfileFrameMax; ++i) {
+		// The oldest frame first, the current one is not complete
+		const Uint32 *frame = ProfileFrames[(ProfileFrameIndex + 1 + i) % ProfileFrameMax];
+		int top = y + height;
+
+		for (int stage = 0; stage < ProfileStageMax; ++stage) {
+			if (i != ProfileFrameMax - 1) {
+				total[stage] += frame[stage];
+			}
+			const int h = std::min<int>(frame[stage] * (height / 2) / budget, top - y);
+			if (h > 0) {
+				top -= h;
+				Video.FillRectangleClip(colors[stage], x + i, top, 1, h);
+			}
+		}
+	}
+	Video.FillRectangleClip(ColorWhite, x, y + height / 2, ProfileFrameMax, 1);
+
+	CLabel label(GetSmallFont());
+	const int lineHeight = GetSmallFont().Height() + 1;
+	for (int stage = 0; stage < ProfileStageMax; ++stage) {
+		char buf[64];
+		const int lineY = y + stage * lineHeight;
+
+		snprintf(buf, sizeof(buf), "%s %.2f ms", ProfileStageNames[stage],
+				 total[stage] / 1000. / (ProfileFrameMax - 1));
+		Video.FillRectangleClip(colors[stage], x + ProfileFrameMax + 4, lineY + 1, lineHeight - 2, lineHeight - 2);
+		label.DrawClip(x + ProfileFrameMax + 4 + lineHeight, lineY, buf);
+	}
+}
+
+/**
+**  Open an export file of the profiler in the logs directory.
+*/
+static bool OpenProfileFile(const std::string &filename, CFile &file)
+{
+	if (filename.find_first_of("\\/") != std::string::npos) {
+		fprintf(stderr, "\\ or / not allowed in the profile filename\n");
+		return false;
+	}
+	const std::string destination = Parameters::Instance.GetUserDirectory() + "/" + GameName + "/logs/" + filename;
+	if (file.open(destination.c_str(), CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to `%s'\n", destination.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+**  Save the recorded stages as CSV, the oldest first.
+**
+**  @param filename  File name, in the logs directory.
+**
+**  @return          0 for success, -1 for failure.
+*/
+int SaveProfileCsv(const std::string &filename)
+{
+	CFile file;
+
+	if (!OpenProfileFile(filename, file)) {
+		return -1;
+	}
+	file.printf("cycle,stage,start_us,duration_us\n");
+	const unsigned long count = std::min<unsigned long>(ProfileEventCount, ProfileEventMax);
+	for (unsigned long i = ProfileEventCount - count; i != ProfileEventCount; ++i) {
+		const ProfileEvent &event = ProfileEvents[i % ProfileEventMax];
+
+		file.printf("%lu,%s,%lu,%u\n", event.Cycle, ProfileStageNames[event.Stage],
+					(unsigned long)(event.Start - ProfileEvents[(ProfileEventCount - count) % ProfileEventMax].Start),
+					event.Duration);
+	}
+	file.close();
+	return 0;
+}
+
+/**
+**  Save the recorded stages as Chrome trace, for chrome://tracing.
+**
+**  @param filename  File name, in the logs directory.
+**
+**  @return          0 for success, -1 for failure.
+*/
+int SaveProfileTrace(const std::string &filename)
+{
+	CFile file;
+
+	if (!OpenProfileFile(filename, file)) {
+		return -1;
+	}
+	file.printf("{\"traceEvents\":[\n");
+	const unsigned long count = std::min<unsigned long>(ProfileEventCount, ProfileEventMax);
+	for (unsigned long i = ProfileEventCount - count; i != ProfileEventCount; ++i) {
+		const ProfileEvent &event = ProfileEvents[i % ProfileEventMax];
+
+		file.printf("%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%u,\"args\":{\"cycle\":%lu}}\n",
+					i != ProfileEventCount - count ? "," : "", ProfileStageNames[event.Stage],
+					(unsigned long)(event.Start - ProfileEvents[(ProfileEventCount - count) % ProfileEventMax].Start),
+					event.Duration, event.Cycle);
+	}
+	file.printf("]}\n");
+	file.close();
+	return 0;
+}
+
+/**
+**  Enable or disable the recording of the stages.
+**
+**  @param l  Lua state.
+*/
+static int CclEnableProfiler(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	ProfilerEnabled = LuaToBoolean(l, 1);
+	return 0;
+}
+
+/**
+**  Show or hide the frame time graph, showing it enables the profiler.
+**
+**  @param l  Lua state.
+*/
+static int CclShowProfiler(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	ProfilerOverlay = LuaToBoolean(l, 1);
+	if (ProfilerOverlay) {
+		ProfilerEnabled = true;
+	}
+	return 0;
+}
+
+/**
+**  Save the recorded stages, as Chrome trace for a .json file and as CSV
+**  otherwise.
+**
+**  @param l  Lua state.
+*/
+static int CclSaveProfile(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	const std::string filename = LuaToString(l, 1);
+	const size_t dot = filename.rfind('.');
+	int ret;
+
+	if (dot != std::string::npos && filename.compare(dot, std::string::npos, ".json") == 0) {
+		ret = SaveProfileTrace(filename);
+	} else {
+		ret = SaveProfileCsv(filename);
+	}
+	lua_pushboolean(l, ret == 0);
+	return 1;
+}
+
+/**
+**  Register Ccl functions with lua
+*/
+void ProfilerCclRegister()
+{
+	lua_register(Lua, "EnableProfiler", CclEnableProfiler);
+	lua_register(Lua, "ShowProfiler", CclShowProfiler);
+	lua_register(Lua, "SaveProfile", CclSaveProfile);
+}
+
+//@}
@@ -172,7 +172,7 @@ int LuaCall(int narg, int clear, bool exitOnError)
 /**
 **  Get the (uncompressed) content of the file into a string
 */
-static bool GetFileContent(const std::string &file, std::string &content)
+bool GetFileContent(const std::string &file, std::string &content)
 {
 	CFile fp;
 
@@ -216,7 +216,21 @@ int LuaLoadFile(const std::string &file)
 	if (GetFileContent(file, content) == false) {
 		return -1;
 	}
-	const int status = luaL_loadbuffer(Lua, content.c_str(), content.size(), file.c_str());
+	return LuaLoadBuffer(content.c_str(), content.size(), file);
+}
+
+/**
+**  Execute a script held in memory
+**
+**  @param buffer  Script source.
+**  @param size    Size of the script.
+**  @param name    Name of the script, for the error messages.
+**
+**  @return      0 for success, else exit.
+*/
+int LuaLoadBuffer(const char *buffer, size_t size, const std::string &name)
+{
+	const int status = luaL_loadbuffer(Lua, buffer, size, name.c_str());
 
 	if (!status) {
 		LuaCall(0, 1);
@@ -231,6 +231,9 @@ extern void beos_init(int argc, char **argv);
 #include "SetupConsole_win32.h"
 #endif
 
+extern void StartMap(const std::string &filename, bool clean);
+extern void StartReplay(const std::string &filename, bool reveal);
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
@@ -246,6 +249,10 @@ std::string MenuRace;
 bool EnableDebugPrint;           /// if enabled, print the debug messages
 bool EnableAssert;               /// if enabled, halt on assertion failures
 bool EnableUnitDebug;            /// if enabled, a unit info dump will be created
+bool HeadlessMode;               /// if enabled, run a game without display, sound and input
+unsigned long HeadlessCycles;    /// Cycles to run in headless mode, 0 until the game ends
+void (*HeadlessCycleCallback)(); /// Called in headless mode where the input is handled, or NULL
+static std::string HeadlessReplay; /// Replay to run in headless mode
 
 /*============================================================================
 ==  MAIN
@@ -439,6 +446,8 @@ void Exit(int err)
 */
 void ExitFatal(int err)
 {
+	// Keep the commands of the crashed game
+	FlushReplayLog();
 #ifdef USE_STACKTRACE
 	throw stacktrace::stack_runtime_error((const char*)err);
 #endif
@@ -461,6 +470,8 @@ static void Usage()
 		"\t-E file.lua\tEditor configuration start file (default editor.lua)\n"
 		"\t-F\t\tFull screen video mode\n"
 		"\t-h\t\tHelp shows this page\n"
+		"\t-H cycles\tRun the map or the replay headless, as fast as possible,\n"
+		"\t\t\tfor cycles (0 = until the end) and print the speed and SyncHash\n"
 		"\t-i\t\tEnables unit info dumping into log (for debugging)\n"
 		"\t-I addr\t\tNetwork address to use\n"
 		"\t-l\t\tDisable command log\n"
@@ -471,6 +482,7 @@ static void Usage()
 #endif
 		"\t-p\t\tEnables debug messages printing in console\n"
 		"\t-P port\t\tNetwork port to use\n"
+		"\t-R replay\tReplay to run with -H\n"
 		"\t-s sleep\tNumber of frames for the AI to sleep before it starts\n"
 		"\t-S speed\tSync speed (100 = 30 frames/s)\n"
 		"\t-u userpath\tPath where stratagus saves preferences, log and savegame\n"
@@ -529,7 +541,7 @@ static void RedirectOutput()
 void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 {
 	for (;;) {
-		switch (getopt(argc, argv, "ac:d:D:eE:FhiI:lN:oOP:ps:S:u:v:WZ?")) {
+		switch (getopt(argc, argv, "ac:d:D:eE:FhH:iI:lN:oOP:pR:s:S:u:v:WZ?")) {
 			case 'a':
 				EnableAssert = true;
 				continue;
@@ -557,6 +569,10 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 				VideoForceFullScreen = 1;
 				Video.FullScreen = 1;
 				continue;
+			case 'H':
+				HeadlessMode = true;
+				HeadlessCycles = strtoul(optarg, NULL, 10);
+				continue;
 			case 'i':
 				EnableUnitDebug = true;
 				continue;
@@ -590,6 +606,9 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			case 'p':
 				EnableDebugPrint = true;
 				continue;
+			case 'R':
+				HeadlessReplay = optarg;
+				continue;
 			case 's':
 				AiSleepCycles = atoi(optarg);
 				continue;
@@ -663,6 +682,34 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			CliMapName[index] = '/';
 		}
 	}
+
+	if (HeadlessMode) {
+		if (CliMapName.empty() && HeadlessReplay.empty()) {
+			fprintf(stderr, "-H needs a map or a replay\n");
+			Usage();
+			ExitFatal(-1);
+		}
+#if defined(USE_OPENGL) || defined(USE_GLES)
+		ForceUseOpenGL = 1;
+		UseOpenGL = 0;
+#endif
+	}
+}
+
+/**
+**  Run the game of the command line without the menus, in headless mode.
+*/
+static void HeadlessLoop()
+{
+	initGuichan();
+	InterfaceState = IfaceStateMenu;
+	GameCursor = UI.Point.Cursor;
+
+	if (!HeadlessReplay.empty()) {
+		StartReplay(HeadlessReplay, true);
+	} else {
+		StartMap(CliMapName, true);
+	}
 }
 
 #ifdef USE_WIN32
@@ -753,7 +800,7 @@ int stratagusMain(int argc, char **argv)
 	InitVideo();
 
 	// Setup sound card
-	if (!InitSound()) {
+	if (!HeadlessMode && !InitSound()) {
 		InitMusic();
 	}
 
@@ -766,7 +813,9 @@ int stratagusMain(int argc, char **argv)
 	LoadFonts();
 	SetClipping(0, 0, Video.Width - 1, Video.Height - 1);
 	Video.ClearScreen();
-	ShowTitleScreens();
+	if (!HeadlessMode) {
+		ShowTitleScreens();
+	}
 
 	// Init player data
 	ThisPlayer = NULL;
@@ -777,7 +826,11 @@ int stratagusMain(int argc, char **argv)
 	UnitManager.Init(); // Units memory management
 	PreMenuSetup();     // Load everything needed for menus
 
-	MenuLoop();
+	if (HeadlessMode) {
+		HeadlessLoop();
+	} else {
+		MenuLoop();
+	}
 
 	Exit(0);
 #ifdef USE_STACKTRACE
@@ -50,6 +50,7 @@
 #include "ui.h"
 #include "unit.h"
 #include "unitsound.h"
+#include "unit_find.h"
 #include "unit_manager.h"
 #include "video.h"
 
@@ -1120,6 +1121,7 @@ static int CclDefineUnitType(lua_State *l)
 		LuaError(l, "Unit-type `%s': right-attack is set, but can-attack is not\n" _C_ type->Name.c_str());
 	}
 	UpdateDefaultBoolFlags(*type);
+	CleanAiPriorityTargetCosts();
 	if (!CclInConfigFile) {
 		UpdateUnitStats(*type, 1);
 	}
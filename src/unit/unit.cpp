@@ -57,6 +57,7 @@
 #include "sound.h"
 #include "sound_server.h"
 #include "spells.h"
+#include "tileset.h"
 #include "translate.h"
 #include "ui.h"
 #include "unit_find.h"
@@ -978,6 +979,23 @@ void UnmarkUnitFieldFlags(const CUnit &unit)
 	} while (--h);
 }
 
+/**
+**  Notify the path finder that a unit blocking like a building appeared
+**  or disappeared.
+**
+**  Not done by MarkUnitFieldFlags and UnmarkUnitFieldFlags, which are
+**  also used to hide a unit for a moment, e.g. during a path search.
+**
+**  @param unit  unit placed or removed.
+*/
+static void UnitFieldFlagsChanged(const CUnit &unit)
+{
+	if (!unit.Type->Vanishes
+		&& (unit.Type->FieldFlags & ~(MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit))) {
+		PathfinderTerrainChanged(unit.tilePos, unit.Type->TileWidth, unit.Type->TileHeight);
+	}
+}
+
 /**
 **  Add unit to a container. It only updates linked list stuff.
 **
@@ -1024,6 +1042,70 @@ static void RemoveUnitFromContainer(CUnit &unit)
 }
 
 
+/**
+**  (Un)mark on vision table the fields in sight of the unit at pos and
+**  not in sight at otherPos (and units inside for transporter (recursively))
+**
+**  @param unit      Unit to (un)mark.
+**  @param pos       coord of first container of unit.
+**  @param otherPos  other coord of the first container during the move.
+**  @param width     Width of the first container of unit.
+**  @param height    Height of the first container of unit.
+**  @param f         Function to (un)mark for normal vision.
+**  @param f2        Function to (un)mark for cloaking vision.
+*/
+static void MapMarkUnitSightDeltaRec(const CUnit &unit, const Vec2i &pos, const Vec2i &otherPos,
+									 int width, int height, MapMarkerFunc *f, MapMarkerFunc *f2)
+{
+	const int range = unit.Container ? unit.Container->CurrentSightRange : unit.CurrentSightRange;
+
+	MapSightDelta(*unit.Player, pos, otherPos, width, height, range, f);
+	if (unit.Type && unit.Type->DetectCloak && f2) {
+		MapSightDelta(*unit.Player, pos, otherPos, width, height, range, f2);
+	}
+
+	CUnit *unit_inside = unit.UnitInside;
+	for (int i = unit.InsideCount; i--; unit_inside = unit_inside->NextContained) {
+		MapMarkUnitSightDeltaRec(*unit_inside, pos, otherPos, width, height, f, f2);
+	}
+}
+
+/**
+**  (Un)mark on vision table the sight changes of a moving unit
+**  (and units inside for transporter)
+**
+**  Unmark before the move with the new position as otherPos,
+**  and mark after it with the old position as otherPos.
+**
+**  @param unit      unit which moves.
+**  @param otherPos  other position of the first container during the move.
+**  @param mark      true to mark, false to unmark.
+*/
+static void MapMarkUnitSightDelta(CUnit &unit, const Vec2i &otherPos, bool mark)
+{
+	CUnit *container = GetFirstContainer(unit);
+	Assert(container->Type);
+
+	MapMarkUnitSightDeltaRec(unit, container->tilePos, otherPos,
+							 container->Type->TileWidth, container->Type->TileHeight,
+							 mark ? MapMarkTileSight : MapUnmarkTileSight,
+							 mark ? MapMarkTileDetectCloak : MapUnmarkTileDetectCloak);
+
+	// Never mark radar, except if the top unit, and unit is usable
+	if (&unit == container && !unit.IsUnusable()) {
+		if (unit.Stats->Variables[RADAR_INDEX].Value) {
+			MapSightDelta(*unit.Player, unit.tilePos, otherPos, unit.Type->TileWidth,
+						  unit.Type->TileHeight, unit.Stats->Variables[RADAR_INDEX].Value,
+						  mark ? MapMarkTileRadar : MapUnmarkTileRadar);
+		}
+		if (unit.Stats->Variables[RADARJAMMER_INDEX].Value) {
+			MapSightDelta(*unit.Player, unit.tilePos, otherPos, unit.Type->TileWidth,
+						  unit.Type->TileHeight, unit.Stats->Variables[RADARJAMMER_INDEX].Value,
+						  mark ? MapMarkTileRadarJammer : MapUnmarkTileRadarJammer);
+		}
+	}
+}
+
 /**
 **  Affect Tile coord of a unit (with units inside) to tile (x, y).
 **
@@ -1055,9 +1137,15 @@ static void UnitInXY(CUnit &unit, const Vec2i &pos)
 */
 void CUnit::MoveToXY(const Vec2i &pos)
 {
-	MapUnmarkUnitSight(*this);
+	// Only the fields entering or leaving the sight change. A unit inside
+	// a container keeps the sight of the container.
+	const Vec2i oldSightPos = GetFirstContainer(*this)->tilePos;
+	const Vec2i newSightPos = Container ? oldSightPos : pos;
+
+	MapMarkUnitSightDelta(*this, newSightPos, false);
 	Map.Remove(*this);
 	UnmarkUnitFieldFlags(*this);
+	UnitFieldFlagsChanged(*this);
 
 	Assert(UnitCanBeAt(*this, pos));
 	// Move the unit.
@@ -1065,9 +1153,10 @@ void CUnit::MoveToXY(const Vec2i &pos)
 
 	Map.Insert(*this);
 	MarkUnitFieldFlags(*this);
+	UnitFieldFlagsChanged(*this);
 	//  Recalculate the seen count.
 	UnitCountSeen(*this);
-	MapMarkUnitSight(*this);
+	MapMarkUnitSightDelta(*this, oldSightPos, true);
 }
 
 /**
@@ -1090,6 +1179,7 @@ void CUnit::Place(const Vec2i &pos)
 	UnitInXY(*this, pos);
 	// Pathfinding info.
 	MarkUnitFieldFlags(*this);
+	UnitFieldFlagsChanged(*this);
 	// Tha cache list.
 	Map.Insert(*this);
 	//  Calculate the seen count.
@@ -1203,6 +1293,7 @@ void CUnit::Remove(CUnit *host)
 	Map.Remove(*this);
 	MapUnmarkUnitSight(*this);
 	UnmarkUnitFieldFlags(*this);
+	UnitFieldFlagsChanged(*this);
 	if (host) {
 		AddInContainer(*host);
 		UpdateUnitSightRange(*this);
@@ -1581,7 +1672,7 @@ void UnitCountSeen(CUnit &unit)
 				int x = width;
 				do {
 					if (unit.Type->PermanentCloak && unit.Player != &Players[p]) {
-						if (mf->playerInfo.VisCloak[p]) {
+						if (mf->playerInfo.VisCloak(p)) {
 							newv++;
 						}
 					} else {
@@ -1754,6 +1845,12 @@ void CUnit::ChangeOwner(CPlayer &newplayer)
 	}
 
 	MapUnmarkUnitSight(*this);
+	if (!Removed) {
+		const Vec2i size(std::min<int>(Type->TileWidth, Map.Info.MapWidth - tilePos.x),
+						 std::min<int>(Type->TileHeight, Map.Info.MapHeight - tilePos.y));
+		Map.UnitBuckets.Remove(tilePos, size, oldplayer->Index);
+		Map.UnitBuckets.Insert(tilePos, size, newplayer.Index);
+	}
 	newplayer.AddUnit(*this);
 	Stats = &Type->Stats[newplayer.Index];
 	UpdateUnitSightRange(*this);
@@ -2451,16 +2548,7 @@ int ThreatCalculate(const CUnit &unit, const CUnit &dest)
 		cost += d * DISTANCE_FACTOR;
 	}
 
-	for (unsigned int i = 0; i < UnitTypeVar.GetNumberBoolFlag(); i++) {
-		if (type.BoolFlag[i].AiPriorityTarget != CONDITION_TRUE) {
-			if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_ONLY) & (dtype.BoolFlag[i].value)) {
-				cost -= AIPRIORITY_BONUS;
-			}
-			if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_FALSE) & (dtype.BoolFlag[i].value)) {
-				cost += AIPRIORITY_BONUS;
-			}
-		}
-	}
+	cost += AiPriorityTargetCost(type, dtype);
 
 	// Unit can attack back.
 	if (CanTarget(dtype, type)) {
@@ -3140,6 +3228,7 @@ void CleanUnits()
 	}
 
 	UnitManager.Init();
+	CleanAiPriorityTargetCosts();
 
 	FancyBuildings = false;
 	HelpMeLastCycle = 0;
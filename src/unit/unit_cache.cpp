@@ -57,6 +57,10 @@ void CMap::Insert(CUnit &unit)
 	const int h = unit.Type->TileHeight;
 	int j, i = h;
 
+	const Vec2i size(std::min<int>(w, Info.MapWidth - unit.tilePos.x),
+					 std::min<int>(h, Info.MapHeight - unit.tilePos.y));
+	UnitBuckets.Insert(unit.tilePos, size, unit.Player->Index);
+
 	do {
 		CMapField *mf = Field(index);
 		j = w;
@@ -81,6 +85,10 @@ void CMap::Remove(CUnit &unit)
 	const int h = unit.Type->TileHeight;
 	int j, i = h;
 
+	const Vec2i size(std::min<int>(w, Info.MapWidth - unit.tilePos.x),
+					 std::min<int>(h, Info.MapHeight - unit.tilePos.y));
+	UnitBuckets.Remove(unit.tilePos, size, unit.Player->Index);
+
 	do {
 		CMapField *mf = Field(index);
 		j = w;
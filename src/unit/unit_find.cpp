@@ -671,6 +671,65 @@ CUnit *ResourceDepositOnMap(const Vec2i &pos, int resource)
 --  Finding units for attack
 ----------------------------------------------------------------------------*/
 
+/*
+**  Cost of the AiPriorityTarget flags of the attacker type against each
+**  target type. The cost only depends on the two types, so it is cached
+**  until the unit types are cleaned or redefined.
+*/
+static std::vector<int> PriorityTargetCosts;
+static std::vector<char> PriorityTargetKnown;
+
+/**
+**  Cost bonus given by the AiPriorityTarget flags of an attacker type
+**  against a target type.
+**
+**  Computed once per type pair instead of once per attacker and candidate.
+**
+**  @param type   Type of the attacker.
+**  @param dtype  Type of the target.
+**
+**  @return       Cost to add to the target cost.
+*/
+int AiPriorityTargetCost(const CUnitType &type, const CUnitType &dtype)
+{
+	const size_t count = UnitTypes.size();
+
+	if (PriorityTargetCosts.size() != count * count) {
+		PriorityTargetCosts.assign(count * count, 0);
+		PriorityTargetKnown.assign(count * count, 0);
+	}
+	const size_t index = type.Slot * count + dtype.Slot;
+
+	if (PriorityTargetKnown[index]) {
+		return PriorityTargetCosts[index];
+	}
+	int cost = 0;
+	for (unsigned int i = 0; i < UnitTypeVar.GetNumberBoolFlag(); i++) {
+		if (type.BoolFlag[i].AiPriorityTarget != CONDITION_TRUE) {
+			if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_ONLY) &
+				(dtype.BoolFlag[i].value)) {
+				cost -= AIPRIORITY_BONUS;
+			}
+			if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_FALSE) &
+				(dtype.BoolFlag[i].value)) {
+				cost += AIPRIORITY_BONUS;
+			}
+		}
+	}
+	PriorityTargetCosts[index] = cost;
+	PriorityTargetKnown[index] = 1;
+	return cost;
+}
+
+/**
+**  Forget the cached target costs, the unit types may change.
+*/
+void CleanAiPriorityTargetCosts()
+{
+	PriorityTargetCosts.clear();
+	PriorityTargetKnown.clear();
+}
+
 class BestTargetFinder
 {
 public:
@@ -754,18 +813,7 @@ private:
 			cost += d * DISTANCE_FACTOR;
 		}
 
-		for (unsigned int i = 0; i < UnitTypeVar.GetNumberBoolFlag(); i++) {
-			if (type.BoolFlag[i].AiPriorityTarget != CONDITION_TRUE) {
-				if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_ONLY) &
-					(dtype.BoolFlag[i].value)) {
-					cost -= AIPRIORITY_BONUS;
-				}
-				if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_FALSE) &
-					(dtype.BoolFlag[i].value)) {
-					cost += AIPRIORITY_BONUS;
-				}
-			}
-		}
+		cost += AiPriorityTargetCost(type, dtype);
 
 		// Unit can attack back.
 		if (CanTarget(dtype, type)) {
@@ -879,17 +927,7 @@ public:
 				//  Priority 0-255
 				cost += dtype.DefaultStat.Variables[PRIORITY_INDEX].Value * PRIORITY_FACTOR;
 
-				for (unsigned int i = 0; i < UnitTypeVar.GetNumberBoolFlag(); i++) {
-					if (type.BoolFlag[i].AiPriorityTarget != CONDITION_TRUE) {
-						if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_ONLY) &
-							(dtype.BoolFlag[i].value)) {
-							cost -= AIPRIORITY_BONUS;
-						} else if ((type.BoolFlag[i].AiPriorityTarget == CONDITION_FALSE) &
-								   (dtype.BoolFlag[i].value)) {
-							cost += AIPRIORITY_BONUS;
-						}
-					}
-				}
+				cost += AiPriorityTargetCost(type, dtype);
 
 				//  Remaining HP (Health) 0-65535
 				// Give a boost to unit we can kill in one shoot only
@@ -1109,6 +1147,21 @@ bool CheckObstaclesBetweenTiles(const Vec2i &unitPos, const Vec2i &goalPos, unsi
 	return true;
 }
 
+/**
+**  Bitmask of the enemy players of a player.
+*/
+static unsigned int EnemyMask(const CPlayer &player)
+{
+	unsigned int mask = 0;
+
+	for (int i = 0; i < PlayerMax; ++i) {
+		if (player.IsEnemy(i)) {
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+}
+
 /**
 **  Attack units in distance.
 **
@@ -1147,9 +1200,12 @@ CUnit *AttackUnitsInDistance(const CUnit &unit, int range, CUnitFilter pred)
 		// If unit is removed, use containers x and y
 		const CUnit *firstContainer = unit.Container ? unit.Container : &unit;
 		std::vector<CUnit *> table;
+		// Only enemies can be chosen, skip the areas without any. But far
+		// searches are sorted depending on the number of units found.
+		const unsigned int enemyMask = range > 25 ? ~0u : EnemyMask(*unit.Player);
 
 		SelectAroundUnit(*firstContainer, range, table,
-			MakeAndPredicate(HasNotSamePlayerAs(Players[PlayerNumNeutral]), pred));
+			MakeAndPredicate(HasNotSamePlayerAs(Players[PlayerNumNeutral]), pred), enemyMask);
 
 		const int n = static_cast<int>(table.size());
 		if (range > 25 && table.size() > 9) {
@@ -0,0 +1,272 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name blend.cpp - The alpha blending kernels. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "blend.h"
+
+/**
+**  The vector kernels need the target attribute and __builtin_cpu_supports,
+**  the other compilers and CPUs only get the portable kernels.
+*/
+#if (defined(__i386__) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define BLEND_X86
+#include <immintrin.h>
+#endif
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+static void BlendSpan16Scalar(Uint16 *pixels, int width, Uint32 color, unsigned char alpha);
+static void BlendSpan32Scalar(Uint32 *pixels, int width, Uint32 color, unsigned char alpha);
+
+BlendSpan16Func *BlendSpan16 = BlendSpan16Scalar;  /// Fastest 16-bit kernel of the CPU
+BlendSpan32Func *BlendSpan32 = BlendSpan32Scalar;  /// Fastest 32-bit kernel of the CPU
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Blend a span of 16-bit pixels one pixel at a time.
+*/
+static void BlendSpan16Scalar(Uint16 *pixels, int width, Uint32 color, unsigned char alpha)
+{
+	for (int i = 0; i < width; ++i) {
+		BlendPixel16(pixels + i, color, alpha);
+	}
+}
+
+/**
+**  Blend a span of 32-bit pixels one pixel at a time.
+*/
+static void BlendSpan32Scalar(Uint32 *pixels, int width, Uint32 color, unsigned char alpha)
+{
+	for (int i = 0; i < width; ++i) {
+		BlendPixel32(pixels + i, color, alpha);
+	}
+}
+
+#ifdef BLEND_X86
+
+/*
+**  The vector kernels compute the formulas of BlendPixel16 and BlendPixel32
+**  in 32-bit lanes. The masks only keep the bits below 32 of the products,
+**  so the results are the same to the bit, borrows between the channels
+**  included.
+*/
+
+/**
+**  Multiply 32-bit lanes by a 16-bit factor, SSE2 has no mullo_epi32.
+**
+**  @param x  Lanes to multiply.
+**  @param a  Factor in each 16-bit lane.
+*/
+__attribute__((target("sse2")))
+static inline __m128i MulLo32SSE2(__m128i x, __m128i a)
+{
+	const __m128i lo = _mm_mullo_epi16(x, a);
+	const __m128i hi = _mm_mulhi_epu16(x, a);
+	return _mm_add_epi32(lo, _mm_slli_epi32(hi, 16));
+}
+
+/**
+**  Blend 4 16-bit pixels, each in the 2 halves of a 32-bit lane.
+*/
+__attribute__((target("sse2")))
+static inline __m128i Blend16SSE2(__m128i d, __m128i color, __m128i alpha, __m128i mask)
+{
+	d = _mm_and_si128(d, mask);
+	d = _mm_add_epi32(_mm_srli_epi32(MulLo32SSE2(_mm_sub_epi32(d, color), alpha), 5), color);
+	d = _mm_and_si128(d, mask);
+	d = _mm_or_si128(d, _mm_srli_epi32(d, 16));
+	// Sign extend the low half for the saturated pack
+	return _mm_srai_epi32(_mm_slli_epi32(d, 16), 16);
+}
+
+/**
+**  Blend a span of 16-bit pixels, 8 pixels at a time.
+*/
+__attribute__((target("sse2")))
+static void BlendSpan16SSE2(Uint16 *pixels, int width, Uint32 color, unsigned char alpha)
+{
+	const __m128i mask = _mm_set1_epi32(0x07E0F81F);
+	const __m128i c = _mm_set1_epi32(((color << 16) | color) & 0x07E0F81F);
+	const __m128i a = _mm_set1_epi16((255 - alpha) >> 3);
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8) {
+		__m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+		const __m128i d = _mm_loadu_si128(p);
+		const __m128i lo = Blend16SSE2(_mm_unpacklo_epi16(d, d), c, a, mask);
+		const __m128i hi = Blend16SSE2(_mm_unpackhi_epi16(d, d), c, a, mask);
+		_mm_storeu_si128(p, _mm_packs_epi32(lo, hi));
+	}
+	BlendSpan16Scalar(pixels + i, width - i, color, alpha);
+}
+
+/**
+**  Blend a span of 32-bit pixels, 4 pixels at a time.
+*/
+__attribute__((target("sse2")))
+static void BlendSpan32SSE2(Uint32 *pixels, int width, Uint32 color, unsigned char alpha)
+{
+	const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+	const __m128i c1 = _mm_set1_epi32(color & 0x00FF00FF);
+	const __m128i c2 = _mm_set1_epi32((color & 0xFF00FF00) >> 8);
+	const __m128i a = _mm_set1_epi16(255 - alpha);
+	int i = 0;
+
+	for (; i + 4 <= width; i += 4) {
+		__m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+		const __m128i d = _mm_loadu_si128(p);
+		__m128i d1 = _mm_and_si128(d, mask);
+		__m128i d2 = _mm_and_si128(_mm_srli_epi32(d, 8), mask);
+
+		d1 = _mm_add_epi32(_mm_srli_epi32(MulLo32SSE2(_mm_sub_epi32(d1, c1), a), 8), c1);
+		d2 = _mm_add_epi32(_mm_srli_epi32(MulLo32SSE2(_mm_sub_epi32(d2, c2), a), 8), c2);
+		d1 = _mm_and_si128(d1, mask);
+		d2 = _mm_and_si128(d2, mask);
+		_mm_storeu_si128(p, _mm_or_si128(d1, _mm_slli_epi32(d2, 8)));
+	}
+	BlendSpan32Scalar(pixels + i, width - i, color, alpha);
+}
+
+/**
+**  Blend 8 16-bit pixels, each in the 2 halves of a 32-bit lane.
+*/
+__attribute__((target("avx2")))
+static inline __m256i Blend16AVX2(__m256i d, __m256i color, __m256i alpha, __m256i mask)
+{
+	d = _mm256_and_si256(d, mask);
+	d = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(d, color), alpha), 5), color);
+	d = _mm256_and_si256(d, mask);
+	d = _mm256_or_si256(d, _mm256_srli_epi32(d, 16));
+	// Sign extend the low half for the saturated pack
+	return _mm256_srai_epi32(_mm256_slli_epi32(d, 16), 16);
+}
+
+/**
+**  Blend a span of 16-bit pixels, 16 pixels at a time.
+**
+**  The unpack and the pack both work in the 128-bit halves, so the pixels
+**  stay in order.
+*/
+__attribute__((target("avx2")))
+static void BlendSpan16AVX2(Uint16 *pixels, int width, Uint32 color, unsigned char alpha)
+{
+	const __m256i mask = _mm256_set1_epi32(0x07E0F81F);
+	const __m256i c = _mm256_set1_epi32(((color << 16) | color) & 0x07E0F81F);
+	const __m256i a = _mm256_set1_epi32((255 - alpha) >> 3);
+	int i = 0;
+
+	for (; i + 16 <= width; i += 16) {
+		__m256i *p = reinterpret_cast<__m256i *>(pixels + i);
+		const __m256i d = _mm256_loadu_si256(p);
+		const __m256i lo = Blend16AVX2(_mm256_unpacklo_epi16(d, d), c, a, mask);
+		const __m256i hi = Blend16AVX2(_mm256_unpackhi_epi16(d, d), c, a, mask);
+		_mm256_storeu_si256(p, _mm256_packs_epi32(lo, hi));
+	}
+	BlendSpan16SSE2(pixels + i, width - i, color, alpha);
+}
+
+/**
+**  Blend a span of 32-bit pixels, 8 pixels at a time.
+*/
+__attribute__((target("avx2")))
+static void BlendSpan32AVX2(Uint32 *pixels, int width, Uint32 color, unsigned char alpha)
+{
+	const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+	const __m256i c1 = _mm256_set1_epi32(color & 0x00FF00FF);
+	const __m256i c2 = _mm256_set1_epi32((color & 0xFF00FF00) >> 8);
+	const __m256i a = _mm256_set1_epi32(255 - alpha);
+	int i = 0;
+
+	for (; i + 8 <= width; i += 8) {
+		__m256i *p = reinterpret_cast<__m256i *>(pixels + i);
+		const __m256i d = _mm256_loadu_si256(p);
+		__m256i d1 = _mm256_and_si256(d, mask);
+		__m256i d2 = _mm256_and_si256(_mm256_srli_epi32(d, 8), mask);
+
+		d1 = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(d1, c1), a), 8), c1);
+		d2 = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(d2, c2), a), 8), c2);
+		d1 = _mm256_and_si256(d1, mask);
+		d2 = _mm256_and_si256(d2, mask);
+		_mm256_storeu_si256(p, _mm256_or_si256(d1, _mm256_slli_epi32(d2, 8)));
+	}
+	BlendSpan32SSE2(pixels + i, width - i, color, alpha);
+}
+
+#endif // BLEND_X86
+
+/**
+**  Get the blending kernels supported by the CPU.
+**
+**  @return  The kernels, the portable ones first and the fastest last.
+*/
+std::vector<BlendKernels> GetBlendKernels()
+{
+	std::vector<BlendKernels> kernels;
+	BlendKernels scalar = { "scalar", BlendSpan16Scalar, BlendSpan32Scalar };
+
+	kernels.push_back(scalar);
+#ifdef BLEND_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		BlendKernels sse2 = { "sse2", BlendSpan16SSE2, BlendSpan32SSE2 };
+		kernels.push_back(sse2);
+	}
+	if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("avx2")) {
+		BlendKernels avx2 = { "avx2", BlendSpan16AVX2, BlendSpan32AVX2 };
+		kernels.push_back(avx2);
+	}
+#endif
+	return kernels;
+}
+
+/**
+**  Select the fastest blending kernels supported by the CPU.
+*/
+void InitBlendKernels()
+{
+	const std::vector<BlendKernels> kernels = GetBlendKernels();
+
+	BlendSpan16 = kernels.back().Span16;
+	BlendSpan32 = kernels.back().Span32;
+}
+
+//@}
@@ -39,6 +39,8 @@
 #include <string>
 #include <map>
 #include <list>
+#include <vector>
+#include <limits.h>
 
 #include "video.h"
 #include "player.h"
@@ -55,6 +57,21 @@ static int HashCount;
 static std::map<std::string, CGraphic *> GraphicHash;
 static std::list<CGraphic *> Graphics;
 
+/**
+**  Surface with player colors in the cache.
+*/
+struct PlayerColorSurfaceEntry {
+	CPlayerColorGraphic *Graphic;  /// Graphic of the surface
+	int Player;                    /// Player of the colors
+	int Flip;                      /// Flipped surface
+	size_t Size;                   /// Size of the surface in bytes
+};
+
+size_t PlayerColorSurfaceCacheSize = 64 * 1024 * 1024;  /// Size of the cache in bytes
+static std::vector<PlayerColorSurfaceEntry> PlayerColorSurfaceCache;  /// Cached surfaces
+static size_t PlayerColorSurfaceCacheUsed;                /// Bytes used by the cached surfaces
+static unsigned long PlayerColorSurfaceClock;             /// Counter of the uses of the cache
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -279,8 +296,23 @@ void CPlayerColorGraphic::DrawPlayerColorFrameClip(int player, unsigned frame,
 	} else
 #endif
 	{
-		GraphicPlayerPixels(Players[player], *this);
-		DrawFrameClip(frame, x, y);
+		SDL_Surface *surface = GetPlayerColorSurface(player, 0);
+		if (!surface) {
+			GraphicPlayerPixels(Players[player], *this);
+			DrawFrameClip(frame, x, y);
+			return;
+		}
+		SDL_Rect srect = {frame_map[frame].x, frame_map[frame].y, Uint16(Width), Uint16(Height)};
+
+		const int oldx = x;
+		const int oldy = y;
+		CLIP_RECTANGLE(x, y, srect.w, srect.h);
+		srect.x += x - oldx;
+		srect.y += y - oldy;
+
+		SDL_Rect drect = {Sint16(x), Sint16(y), 0, 0};
+
+		SDL_BlitSurface(surface, &srect, TheScreen, &drect);
 	}
 }
 
@@ -432,8 +464,23 @@ void CPlayerColorGraphic::DrawPlayerColorFrameClipX(int player, unsigned frame,
 	} else
 #endif
 	{
-		GraphicPlayerPixels(Players[player], *this);
-		DrawFrameClipX(frame, x, y);
+		SDL_Surface *surface = GetPlayerColorSurface(player, 1);
+		if (!surface) {
+			GraphicPlayerPixels(Players[player], *this);
+			DrawFrameClipX(frame, x, y);
+			return;
+		}
+		SDL_Rect srect = {frameFlip_map[frame].x, frameFlip_map[frame].y, Uint16(Width), Uint16(Height)};
+
+		const int oldx = x;
+		const int oldy = y;
+		CLIP_RECTANGLE(x, y, srect.w, srect.h);
+		srect.x += x - oldx;
+		srect.y += y - oldy;
+
+		SDL_Rect drect = {Sint16(x), Sint16(y), 0, 0};
+
+		SDL_BlitSurface(surface, &srect, TheScreen, &drect);
 	}
 }
 
@@ -769,6 +816,10 @@ void CGraphic::Free(CGraphic *g)
 			Graphics.remove(g);
 		}
 #endif
+		CPlayerColorGraphic *cg = dynamic_cast<CPlayerColorGraphic *>(g);
+		if (cg) {
+			cg->FreePlayerColorSurfaces();
+		}
 
 		FreeSurface(&g->Surface);
 		delete[] g->frame_map;
@@ -790,6 +841,140 @@ void CGraphic::Free(CGraphic *g)
 	}
 }
 
+/**
+**  Free the cached surfaces with player colors of the graphic.
+**
+**  Must be called when the surfaces of the graphic change.
+*/
+void CPlayerColorGraphic::FreePlayerColorSurfaces()
+{
+	for (size_t i = 0; i != PlayerColorSurfaceCache.size();) {
+		PlayerColorSurfaceEntry &entry = PlayerColorSurfaceCache[i];
+
+		if (entry.Graphic != this) {
+			++i;
+			continue;
+		}
+		SDL_FreeSurface(PlayerColorSurfaces[entry.Player][entry.Flip]);
+		PlayerColorSurfaces[entry.Player][entry.Flip] = NULL;
+		PlayerColorSurfaceCacheUsed -= entry.Size;
+		entry = PlayerColorSurfaceCache.back();
+		PlayerColorSurfaceCache.pop_back();
+	}
+}
+
+/**
+**  Free the cached surfaces with player colors of all graphics.
+**
+**  Must be called when the player colors change.
+*/
+void FreeAllPlayerColorSurfaces()
+{
+	for (size_t i = 0; i != PlayerColorSurfaceCache.size(); ++i) {
+		const PlayerColorSurfaceEntry &entry = PlayerColorSurfaceCache[i];
+
+		SDL_FreeSurface(entry.Graphic->PlayerColorSurfaces[entry.Player][entry.Flip]);
+		entry.Graphic->PlayerColorSurfaces[entry.Player][entry.Flip] = NULL;
+	}
+	PlayerColorSurfaceCache.clear();
+	PlayerColorSurfaceCacheUsed = 0;
+}
+
+/**
+**  Free the cached surfaces with player colors of a graphic, if any.
+**
+**  @param g  The graphic.
+*/
+static void FreePlayerColorSurfaces(CGraphic *g)
+{
+	if (PlayerColorSurfaceCache.empty()) {
+		return;
+	}
+	CPlayerColorGraphic *cg = dynamic_cast<CPlayerColorGraphic *>(g);
+	if (cg) {
+		cg->FreePlayerColorSurfaces();
+	}
+}
+
+/**
+**  Free the least recently used surfaces of the cache until size bytes
+**  more fit in it.
+**
+**  @param size  Size in bytes of the new surface.
+*/
+static void EvictPlayerColorSurfaces(size_t size)
+{
+	while (!PlayerColorSurfaceCache.empty()
+		   && PlayerColorSurfaceCacheUsed + size > PlayerColorSurfaceCacheSize) {
+		size_t oldest = 0;
+		unsigned long oldestUse = ULONG_MAX;
+
+		for (size_t i = 0; i != PlayerColorSurfaceCache.size(); ++i) {
+			const PlayerColorSurfaceEntry &entry = PlayerColorSurfaceCache[i];
+			const unsigned long use = entry.Graphic->PlayerColorSurfaceUses[entry.Player][entry.Flip];
+
+			if (use < oldestUse) {
+				oldestUse = use;
+				oldest = i;
+			}
+		}
+		PlayerColorSurfaceEntry &entry = PlayerColorSurfaceCache[oldest];
+		SDL_FreeSurface(entry.Graphic->PlayerColorSurfaces[entry.Player][entry.Flip]);
+		entry.Graphic->PlayerColorSurfaces[entry.Player][entry.Flip] = NULL;
+		PlayerColorSurfaceCacheUsed -= entry.Size;
+		entry = PlayerColorSurfaceCache.back();
+		PlayerColorSurfaceCache.pop_back();
+	}
+}
+
+/**
+**  Get the surface of the graphic with the player colors, in the display
+**  format, converting it on the first use.
+**
+**  Only the paletted graphics have player colors, the others are drawn
+**  directly. Nothing is cached while the color cycling changes the
+**  palettes of all the graphics, the copies wouldn't follow them.
+**
+**  @param player  Player number.
+**  @param flip    1 for the flipped surface, 0 otherwise.
+**
+**  @return        The surface, or NULL if the graphic isn't cached.
+*/
+SDL_Surface *CPlayerColorGraphic::GetPlayerColorSurface(int player, int flip)
+{
+	SDL_Surface *surface = PlayerColorSurfaces[player][flip];
+
+	if (surface) {
+		PlayerColorSurfaceUses[player][flip] = ++PlayerColorSurfaceClock;
+		return surface;
+	}
+	SDL_Surface *source = flip ? SurfaceFlip : Surface;
+	if (!source || source->format->BytesPerPixel != 1 || !PlayerColorIndexCount || IsColorCycleAll()) {
+		return NULL;
+	}
+	const size_t size = source->w * source->h * TheScreen->format->BytesPerPixel;
+	if (size > PlayerColorSurfaceCacheSize) {
+		return NULL;
+	}
+	EvictPlayerColorSurfaces(size);
+
+	GraphicPlayerPixels(Players[player], *this);
+	surface = SDL_DisplayFormat(source);
+	if (!surface) {
+		return NULL;
+	}
+	if (surface->flags & SDL_SRCCOLORKEY) {
+		SDL_SetColorKey(surface, SDL_SRCCOLORKEY | SDL_RLEACCEL, surface->format->colorkey);
+	}
+	PlayerColorSurfaces[player][flip] = surface;
+	PlayerColorSurfaceUses[player][flip] = ++PlayerColorSurfaceClock;
+
+	PlayerColorSurfaceEntry entry = {this, player, flip, size};
+	PlayerColorSurfaceCache.push_back(entry);
+	PlayerColorSurfaceCacheUsed += size;
+	return surface;
+}
+
 #if defined(USE_OPENGL) || defined(USE_GLES)
 
 /**
@@ -958,6 +1143,7 @@ void CGraphic::UseDisplayFormat()
 	if (UseOpenGL) { return; }
 #endif
 
+	FreePlayerColorSurfaces(this);
 	SDL_Surface *s = Surface;
 
 	if (s->format->Amask != 0) {
@@ -1212,6 +1398,7 @@ void CGraphic::Resize(int w, int h)
 		}
 	}
 
+	FreePlayerColorSurfaces(this);
 	Resized = true;
 	Uint32 ckey = Surface->format->colorkey;
 	int useckey = Surface->flags & SDL_SRCCOLORKEY;
@@ -1335,7 +1522,7 @@ void CGraphic::SetOriginalSize()
 		return;
 	}
 
-	
+	FreePlayerColorSurfaces(this);
 	if (Surface) {
 		FreeSurface(&Surface);
 		Surface = NULL;
@@ -1416,6 +1603,7 @@ void CGraphic::MakeShadow()
 	// Set all colors in the palette to black and use 50% alpha
 	memset(colors, 0, sizeof(colors));
 
+	FreePlayerColorSurfaces(this);
 	SDL_SetPalette(Surface, SDL_LOGPAL | SDL_PHYSPAL, colors, 0, 256);
 	SDL_SetAlpha(Surface, SDL_SRCALPHA | SDL_RLEACCEL, 128);
 
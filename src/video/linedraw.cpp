@@ -37,6 +37,7 @@
 #include "stratagus.h"
 #include "video.h"
 
+#include "blend.h"
 #include "intern_video.h"
 
 
@@ -62,6 +63,7 @@ void (*VideoDrawPixel)(Uint32 color, int x, int y);
 static void (*VideoDoDrawPixel)(Uint32 color, int x, int y);
 void (*VideoDrawTransPixel)(Uint32 color, int x, int y, unsigned char alpha);
 static void (*VideoDoDrawTransPixel)(Uint32 color, int x, int y, unsigned char alpha);
+static void (*VideoDoDrawTransSpan)(Uint32 color, int x, int y, int width, unsigned char alpha);
 
 /**
 **  Draw a 16-bit pixel
@@ -104,15 +106,7 @@ void VideoDrawPixel32(Uint32 color, int x, int y)
 */
 static void VideoDoDrawTransPixel16(Uint32 color, int x, int y, unsigned char alpha)
 {
-	// Loses precision for speed
-	alpha = (255 - alpha) >> 3;
-
-	Uint16 *p = &((Uint16 *)TheScreen->pixels)[x + y * Video.Width];
-	color = (((color << 16) | color) & 0x07E0F81F);
-	unsigned long dp = *p;
-	dp = ((dp << 16) | dp) & 0x07E0F81F;
-	dp = ((((dp - color) * alpha) >> 5) + color) & 0x07E0F81F;
-	*p = (Uint16)((dp >> 16) | dp);
+	BlendPixel16(&((Uint16 *)TheScreen->pixels)[x + y * Video.Width], color, alpha);
 }
 
 /**
@@ -130,20 +124,7 @@ void VideoDrawTransPixel16(Uint32 color, int x, int y, unsigned char alpha)
 */
 static void VideoDoDrawTransPixel32(Uint32 color, int x, int y, unsigned char alpha)
 {
-	alpha = 255 - alpha;
-
-	Uint32 *p = &((Uint32 *)TheScreen->pixels)[x + y * Video.Width];
-
-	const unsigned long sp2 = (color & 0xFF00FF00) >> 8;
-	color &= 0x00FF00FF;
-
-	unsigned long dp1 = *p;
-	unsigned long dp2 = (dp1 & 0xFF00FF00) >> 8;
-	dp1 &= 0x00FF00FF;
-
-	dp1 = ((((dp1 - color) * alpha) >> 8) + color) & 0x00FF00FF;
-	dp2 = ((((dp2 - sp2) * alpha) >> 8) + sp2) & 0x00FF00FF;
-	*p = (dp1 | (dp2 << 8));
+	BlendPixel32(&((Uint32 *)TheScreen->pixels)[x + y * Video.Width], color, alpha);
 }
 
 /**
@@ -156,6 +137,22 @@ void VideoDrawTransPixel32(Uint32 color, int x, int y, unsigned char alpha)
 	Video.UnlockScreen();
 }
 
+/**
+**  Draw a transparent 16-bit horizontal span
+*/
+static void VideoDoDrawTransSpan16(Uint32 color, int x, int y, int width, unsigned char alpha)
+{
+	BlendSpan16(&((Uint16 *)TheScreen->pixels)[x + y * Video.Width], width, color, alpha);
+}
+
+/**
+**  Draw a transparent 32-bit horizontal span
+*/
+static void VideoDoDrawTransSpan32(Uint32 color, int x, int y, int width, unsigned char alpha)
+{
+	BlendSpan32(&((Uint32 *)TheScreen->pixels)[x + y * Video.Width], width, color, alpha);
+}
+
 /**
 **  Draw a clipped pixel
 */
@@ -273,9 +270,7 @@ void DrawTransHLine(Uint32 color, int x, int y,
 					int width, unsigned char alpha)
 {
 	Video.LockScreen();
-	for (int i = 0; i < width; ++i) {
-		VideoDoDrawTransPixel(color, x + i, y, alpha);
-	}
+	VideoDoDrawTransSpan(color, x, y, width, alpha);
 	Video.UnlockScreen();
 }
 
@@ -285,10 +280,21 @@ void DrawTransHLine(Uint32 color, int x, int y,
 void DrawTransHLineClip(Uint32 color, int x, int y,
 						int width, unsigned char alpha)
 {
-	Video.LockScreen();
-	for (int i = 0; i < width; ++i) {
-		VideoDoDrawTransPixelClip(color, x + i, y, alpha);
+	if (y < ClipY1 || y > ClipY2) {
+		return;
+	}
+	if (x < ClipX1) {
+		width -= ClipX1 - x;
+		x = ClipX1;
 	}
+	if (x + width > ClipX2 + 1) {
+		width = ClipX2 + 1 - x;
+	}
+	if (width <= 0) {
+		return;
+	}
+	Video.LockScreen();
+	VideoDoDrawTransSpan(color, x, y, width, alpha);
 	Video.UnlockScreen();
 }
 
@@ -595,15 +601,14 @@ void FillRectangleClip(Uint32 color, int x, int y,
 void FillTransRectangle(Uint32 color, int x, int y,
 						int w, int h, unsigned char alpha)
 {
-	int ex = x + w;
-	int ey = y + h;
-	int sx = x;
+	if (w <= 0) {
+		return;
+	}
+	const int ey = y + h;
 
 	Video.LockScreen();
 	for (; y < ey; ++y) {
-		for (x = sx; x < ex; ++x) {
-			VideoDoDrawTransPixel(color, x, y, alpha);
-		}
+		VideoDoDrawTransSpan(color, x, y, w, alpha);
 	}
 	Video.UnlockScreen();
 }
@@ -883,18 +888,21 @@ void FillTransCircleClip(Uint32 color, int x, int y,
 */
 void InitLineDraw()
 {
+	InitBlendKernels();
 	switch (Video.Depth) {
 		case 16:
 			VideoDrawPixel = VideoDrawPixel16;
 			VideoDoDrawPixel = VideoDoDrawPixel16;
 			VideoDrawTransPixel = VideoDrawTransPixel16;
 			VideoDoDrawTransPixel = VideoDoDrawTransPixel16;
+			VideoDoDrawTransSpan = VideoDoDrawTransSpan16;
 			break;
 		case 32:
 			VideoDrawPixel = VideoDrawPixel32;
 			VideoDoDrawPixel = VideoDoDrawPixel32;
 			VideoDrawTransPixel = VideoDrawTransPixel32;
 			VideoDoDrawTransPixel = VideoDoDrawTransPixel32;
+			VideoDoDrawTransSpan = VideoDoDrawTransSpan32;
 	}
 }
 
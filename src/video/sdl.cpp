@@ -463,6 +463,10 @@ void InitVideoSdl()
 		// Fix tablet input in full-screen mode
 		SDL_putenv(strdup("SDL_MOUSE_RELATIVE=0"));
 #endif
+		if (HeadlessMode) {
+			// No window, the game isn't drawn
+			SDL_putenv(strdup("SDL_VIDEODRIVER=dummy"));
+		}
 		int res = SDL_Init(
 #ifdef DEBUG
 					  SDL_INIT_NOPARACHUTE |
@@ -349,9 +349,24 @@ static int CclSetVideoSyncSpeed(lua_State *l)
 	return 0;
 }
 
+/**
+**  Set the size of the cache of the surfaces with player colors, used
+**  without OpenGL.
+**
+**  @param l  Lua state.
+*/
+static int CclSetPlayerColorSurfaceCacheSize(lua_State *l)
+{
+	LuaCheckArgs(l, 1);
+	PlayerColorSurfaceCacheSize = LuaToNumber(l, 1) * 1024 * 1024;
+	FreeAllPlayerColorSurfaces();
+	return 0;
+}
+
 void VideoCclRegister()
 {
 	lua_register(Lua, "SetVideoSyncSpeed", CclSetVideoSyncSpeed);
+	lua_register(Lua, "SetPlayerColorSurfaceCacheSize", CclSetPlayerColorSurfaceCacheSize);
 }
 
 #if 1 // color cycling
@@ -395,16 +410,48 @@ void VideoPaletteListRemove(SDL_Surface *surface)
 void ClearAllColorCyclingRange()
 {
 	CColorCycling::GetInstance().ColorIndexRanges.clear();
+	// The terrain cache knows which tiles use the cycled colors
+	FreeTerrainCache();
 }
 
 void AddColorCyclingRange(unsigned int begin, unsigned int end)
 {
 	CColorCycling::GetInstance().ColorIndexRanges.push_back(ColorIndexRange(begin, end));
+	FreeTerrainCache();
+}
+
+/**
+**  Check if the color cycling changes a color of the palettes.
+**
+**  @param index  Index of the color in the palette.
+*/
+bool IsColorCycled(unsigned int index)
+{
+	const CColorCycling &colorCycling = CColorCycling::GetInstance();
+
+	for (std::vector<ColorIndexRange>::const_iterator it = colorCycling.ColorIndexRanges.begin(); it != colorCycling.ColorIndexRanges.end(); ++it) {
+		if (it->begin <= index && index <= it->end) {
+			return true;
+		}
+	}
+	return false;
 }
 
 void SetColorCycleAll(bool value)
 {
 	CColorCycling::GetInstance().ColorCycleAll = value;
+	if (value) {
+		// The cached copies wouldn't follow the palettes of their graphics
+		FreeAllPlayerColorSurfaces();
+	}
+}
+
+/**
+**  Check if the color cycling changes the palettes of all the graphics.
+*/
+bool IsColorCycleAll()
+{
+	return CColorCycling::GetInstance().ColorCycleAll;
 }
 
 /**
@@ -471,6 +518,7 @@ void ColorCycle()
 		++colorCycling.cycleCount;
 		ColorCycleSurface(*Map.TileGraphic->Surface);
 	}
+	RedrawTerrainCycledTiles();
 }
 
 void RestoreColorCyclingSurface()
@@ -486,6 +534,7 @@ void RestoreColorCyclingSurface()
 		ColorCycleSurface_Reverse(*Map.TileGraphic->Surface, colorCycling.cycleCount);
 	}
 	colorCycling.cycleCount = 0;
+	RedrawTerrainCycledTiles();
 }
 
 
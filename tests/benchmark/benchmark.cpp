@@ -0,0 +1,1001 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name benchmark.cpp - The deterministic simulation benchmark. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+/**
+**  The benchmark creates a synthetic map of the requested size, fills it
+**  with the units of the players and sends every unit to attack the start
+**  position of the opposite player. Then it runs the game cycles without
+**  display, sound and input, and prints the time spent per cycle by each
+**  subsystem and the final SyncHash. With -f, it then times the drawing
+**  of a viewport covering the whole screen (-g) in the dummy video driver.
+**  With -l, it times the save and the load of the game in the binary and
+**  in the Lua script formats, and the stall of the background save. With -r, it times the replay log of the
+**  commands given by the player. With -b, it times the alpha blending
+**  kernels supported by the CPU on the rows of the screen. With -a, it
+**  compares the expansions per second of a bare a* over a grid of the map
+**  size with the binary heap open set and with the former sorted array.
+**
+**  With -k, it checks the replay seek instead: a game where the units get
+**  orders is logged with keyframes, then its replay is played from the
+**  start and from the last keyframe, and both must end with the same
+**  SyncHash.
+**
+**  Two runs with the same parameters give the same SyncHash, so the
+**  benchmark also checks that an optimization doesn't change the game.
+**
+**  The unit types and the tileset come from the game data (-d).
+*/
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "SDL.h"
+
+#include "stratagus.h"
+
+#include "actions.h"
+#include "ai.h"
+#include "astar_openset.h"
+#include "blend.h"
+#include "commands.h"
+#include "cursor.h"
+#include "game.h"
+#include "iocompat.h"
+#include "interface.h"
+#include "iolib.h"
+#include "map.h"
+#include "menus.h"
+#include "missile.h"
+#include "parameters.h"
+#include "player.h"
+#include "replay.h"
+#include "script.h"
+#include "settings.h"
+#include "tileset.h"
+#include "ui.h"
+#include "unit.h"
+#include "unit_find.h"
+#include "unit_manager.h"
+#include "unittype.h"
+#include "util.h"
+#include "video.h"
+#include "viewport.h"
+#include "widgets.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef USE_WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, int minrange, int maxrange,
+						 char *path, int pathlen, const CUnit &unit);
+extern void CleanGame();
+extern void StartMap(const std::string &filename, bool clean);
+extern void StartReplay(const std::string &filename, bool reveal);
+extern int SaveReplay(const std::string &filename);
+extern bool IsReplayGame();
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+static int BenchmarkWidth = 128;         /// Width of the synthetic map
+static int BenchmarkHeight = 128;        /// Height of the synthetic map
+static int BenchmarkPlayers = 2;         /// Number of players
+static int BenchmarkUnits = 100;         /// Units of each player
+static int BenchmarkObstacles = 10;      /// Percent of unpassable fields
+static unsigned long BenchmarkCycles = 1000; /// Game cycles to run
+static int BenchmarkQueries = 16;        /// Path, sight and terrain queries each cycle
+static int BenchmarkFrames = 0;          /// Frames drawn with a full screen viewport
+static bool BenchmarkSaveLoad = false;   /// Time the save and the load of the game
+static int BenchmarkCommands = 0;        /// Commands written in the replay log
+static int BenchmarkBlends = 0;          /// Screens blended by each blending kernel
+static int BenchmarkSearches = 0;        /// Searches of the a* open set comparison
+static unsigned long BenchmarkKeyframes = 0; /// Cycles between the keyframes of the seek check, 0 for none
+static int BenchmarkScreenWidth = 0;     /// Width of the screen, 0 for the configured one
+static int BenchmarkScreenHeight = 0;    /// Height of the screen, 0 for the configured one
+static unsigned BenchmarkSeed = 0x5eed;  /// Seed of the map generator
+static unsigned BenchmarkRandState;      /// State of the map generator
+static std::string BenchmarkUnitType = "unit-footman";               /// Ident of the units
+static std::string BenchmarkTileset = "scripts/tilesets/summer.lua"; /// Tileset of the map
+
+static Vec2i BenchmarkTarget[PlayerMax]; /// Attack position of each player
+static unsigned long BenchmarkOrderCycle; /// Last cycle BenchmarkOrders gave an order
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Get the time in milliseconds, with a sub millisecond precision.
+*/
+static double BenchmarkTime()
+{
+#ifdef USE_WIN32
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return counter.QuadPart * 1000. / frequency.QuadPart;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000. + tv.tv_usec / 1000.;
+#endif
+}
+
+/**
+**  Random number generator of the map, independent of the game's one.
+*/
+static unsigned BenchmarkRand()
+{
+	BenchmarkRandState = BenchmarkRandState * 1103515245 + 12345;
+	return (BenchmarkRandState >> 16) & 0x7FFF;
+}
+
+/**
+**  Place a new unit on the first free field near a position.
+*/
+static void PlaceBenchmarkUnit(const CUnitType &type, CPlayer &player, const Vec2i &pos)
+{
+	CUnit *unit = MakeUnit(type, &player);
+	if (unit == NULL) {
+		DebugPrint("Unable to allocate unit");
+		return;
+	}
+	if (UnitCanBeAt(*unit, pos)) {
+		unit->Place(pos);
+	} else {
+		Vec2i resPos;
+
+		FindNearestDrop(type, pos, resPos, 0);
+		unit->Place(resPos);
+	}
+	UpdateForNewUnit(*unit, 0);
+}
+
+/**
+**  Fill the synthetic map, called by the map setup once the tileset is loaded.
+**
+**  @param l  Lua state.
+*/
+static int CclBenchmarkSetupMap(lua_State *l)
+{
+	LuaCheckArgs(l, 0);
+
+	// The save games, the keyframes of the replays included, have the map.
+	if (SaveGameLoading) {
+		return 0;
+	}
+	// The same map each time, for the replays.
+	BenchmarkRandState = BenchmarkSeed;
+
+	CUnitType *type = UnitTypeByIdent(BenchmarkUnitType);
+	if (type == NULL) {
+		LuaError(l, "Unit type not found: %s" _C_ BenchmarkUnitType.c_str());
+	}
+
+	// Start positions on a circle, each player attacks the opposite one.
+	const Vec2i center(Map.Info.MapWidth / 2, Map.Info.MapHeight / 2);
+	const int radius = std::min(Map.Info.MapWidth, Map.Info.MapHeight) * 3 / 8;
+	for (int i = 0; i < BenchmarkPlayers; ++i) {
+		const double angle = 2 * M_PI * i / BenchmarkPlayers;
+		const Vec2i pos(center.x + int(radius * cos(angle)), center.y + int(radius * sin(angle)));
+
+		Players[i].SetStartView(pos);
+	}
+	for (int i = 0; i < BenchmarkPlayers; ++i) {
+		BenchmarkTarget[i] = Players[(i + (BenchmarkPlayers + 1) / 2) % BenchmarkPlayers].StartPos;
+	}
+
+	// Terrain with obstacles, but free around the start positions.
+	const int defaultTile = Map.Tileset->getDefaultTileIndex();
+	Vec2i pos;
+	for (pos.y = 0; pos.y < Map.Info.MapHeight; ++pos.y) {
+		for (pos.x = 0; pos.x < Map.Info.MapWidth; ++pos.x) {
+			CMapField &mf = *Map.Field(pos);
+
+			mf.setTileIndex(*Map.Tileset, defaultTile, 0);
+			if ((int)(BenchmarkRand() % 100) >= BenchmarkObstacles) {
+				continue;
+			}
+			bool nearStart = false;
+			for (int i = 0; i < BenchmarkPlayers; ++i) {
+				if (SquareDistance(pos, Players[i].StartPos) < BenchmarkUnits * 2) {
+					nearStart = true;
+					break;
+				}
+			}
+			if (!nearStart) {
+				mf.Flags |= MapFieldUnpassable | MapFieldNoBuilding;
+			}
+		}
+	}
+
+	for (int i = 0; i < BenchmarkPlayers; ++i) {
+		for (int j = 0; j < BenchmarkUnits; ++j) {
+			PlaceBenchmarkUnit(*type, Players[i], Players[i].StartPos);
+		}
+	}
+	return 0;
+}
+
+/**
+**  Write the presentation and the setup of the synthetic map.
+**
+**  @param smp  Name of the presentation file, the setup is next to it.
+**
+**  @return     true if the files are written, false otherwise.
+*/
+static bool WriteBenchmarkMap(const std::string &smp)
+{
+	std::string sms = smp;
+	sms.replace(sms.size() - 4, 4, ".sms");
+
+	FILE *fd = fopen(smp.c_str(), "wb");
+	if (!fd) {
+		fprintf(stderr, "Can't write the map presentation '%s'\n", smp.c_str());
+		return false;
+	}
+	fprintf(fd, "DefinePlayerTypes(");
+	for (int i = 0; i < BenchmarkPlayers; ++i) {
+		fprintf(fd, "%s\"person\"", i ? ", " : "");
+	}
+	fprintf(fd, ")\n");
+	fprintf(fd, "PresentMap(\"Benchmark\", %d, %d, %d, 1)\n",
+			BenchmarkPlayers, BenchmarkWidth, BenchmarkHeight);
+	fprintf(fd, "DefineMapSetup(\"benchmark.sms\")\n");
+	fclose(fd);
+
+	fd = fopen(sms.c_str(), "wb");
+	if (!fd) {
+		fprintf(stderr, "Can't write the map setup '%s'\n", sms.c_str());
+		return false;
+	}
+	fprintf(fd, "LoadTileModels(\"%s\")\n", BenchmarkTileset.c_str());
+	fprintf(fd, "BenchmarkSetupMap()\n");
+	fclose(fd);
+	return true;
+}
+
+/**
+**  Time the path finder: search the path of some units to their target.
+**
+**  @param first  Index of the first unit of the queries.
+*/
+static void BenchmarkPathQueries(unsigned int first)
+{
+	const unsigned int count = UnitManager.end() - UnitManager.begin();
+	if (count == 0) {
+		return;
+	}
+	for (int i = 0; i < BenchmarkQueries; ++i) {
+		const CUnit &unit = *UnitManager.begin()[(first + i) % count];
+
+		if (!unit.IsAliveOnMap()) {
+			continue;
+		}
+		AStarFindPath(unit.tilePos, BenchmarkTarget[unit.Player->Index], 1, 1,
+					  unit.Type->TileWidth, unit.Type->TileHeight, 0, 1, NULL, 0, unit);
+	}
+}
+
+/**
+**  Time the sight: mark and unmark the sight of some units on the radar,
+**  which doesn't change the game.
+**
+**  @param first  Index of the first unit of the queries.
+*/
+static void BenchmarkSightQueries(unsigned int first)
+{
+	const unsigned int count = UnitManager.end() - UnitManager.begin();
+	if (count == 0) {
+		return;
+	}
+	for (int i = 0; i < BenchmarkQueries; ++i) {
+		const CUnit &unit = *UnitManager.begin()[(first + i) % count];
+
+		if (!unit.IsAliveOnMap()) {
+			continue;
+		}
+		MapSight(*unit.Player, unit.tilePos, unit.Type->TileWidth, unit.Type->TileHeight,
+				 unit.CurrentSightRange, MapMarkTileRadar);
+		MapSight(*unit.Player, unit.tilePos, unit.Type->TileWidth, unit.Type->TileHeight,
+				 unit.CurrentSightRange, MapUnmarkTileRadar);
+	}
+}
+
+/**
+**  Time the terrain traversal: the short range wood search of some units,
+**  as done by the harvesters.
+**
+**  @param first  Index of the first unit of the queries.
+*/
+static void BenchmarkTerrainQueries(unsigned int first)
+{
+	const unsigned int count = UnitManager.end() - UnitManager.begin();
+	if (count == 0) {
+		return;
+	}
+	for (int i = 0; i < BenchmarkQueries; ++i) {
+		const CUnit &unit = *UnitManager.begin()[(first + i) % count];
+		Vec2i pos;
+
+		if (!unit.IsAliveOnMap()) {
+			continue;
+		}
+		FindTerrainType(unit.Type->MovementMask, MapFieldForest, 3, *unit.Player, unit.tilePos, &pos);
+	}
+}
+
+/**
+**  Time the drawing of a viewport covering the whole screen, scrolling
+**  diagonally one pixel each frame.
+**
+**  @return  Time spent drawing the frames in milliseconds.
+*/
+static double BenchmarkDraw()
+{
+	if (!BenchmarkFrames) {
+		return 0;
+	}
+	UI.MapArea.X = 0;
+	UI.MapArea.Y = 0;
+	UI.MapArea.EndX = Video.Width - 1;
+	UI.MapArea.EndY = Video.Height - 1;
+	SetViewportMode(VIEWPORT_SINGLE);
+
+	CViewport &vp = UI.Viewports[0];
+	double drawTime = 0;
+	for (int i = 0; i < BenchmarkFrames; ++i) {
+		vp.Set(Vec2i(0, 0), PixelDiff(i, i));
+
+		const double start = BenchmarkTime();
+		vp.Draw();
+		drawTime += BenchmarkTime() - start;
+		++FrameCounter;
+	}
+	return drawTime;
+}
+
+/**
+**  Time the blending kernels supported by the CPU: blend each row of the
+**  screen with a color, in 16 and in 32 bits.
+*/
+static void BenchmarkBlendKernels()
+{
+	const std::vector<BlendKernels> kernels = GetBlendKernels();
+	std::vector<Uint16> pixels16(Video.Width * Video.Height, 0x1234);
+	std::vector<Uint32> pixels32(Video.Width * Video.Height, 0x12345678);
+
+	for (size_t k = 0; k != kernels.size(); ++k) {
+		double start = BenchmarkTime();
+		for (int i = 0; i < BenchmarkBlends; ++i) {
+			for (int y = 0; y < Video.Height; ++y) {
+				kernels[k].Span16(&pixels16[y * Video.Width], Video.Width, 0x4080, 128);
+			}
+		}
+		const double time16 = BenchmarkTime() - start;
+
+		start = BenchmarkTime();
+		for (int i = 0; i < BenchmarkBlends; ++i) {
+			for (int y = 0; y < Video.Height; ++y) {
+				kernels[k].Span32(&pixels32[y * Video.Width], Video.Width, 0x00406080, 128);
+			}
+		}
+		const double time32 = BenchmarkTime() - start;
+
+		fprintf(stdout, "  Blend %-6s 16bpp %8.4f ms/screen, 32bpp %8.4f ms/screen (%dx%d)\n",
+				kernels[k].Name, time16 / BenchmarkBlends, time32 / BenchmarkBlends, Video.Width, Video.Height);
+	}
+}
+
+/**
+**  The former open set of the a* path finder: a sorted array whose end
+**  holds the best node. Kept as the reference of BenchmarkOpenSets.
+**  Decrease orders the node by its new costs, as the heap does, so both
+**  expand the same nodes.
+*/
+class SortedArrayOpenSet
+{
+public:
+	void Init(unsigned int) { m_nodes.clear(); }
+	bool Empty() const { return m_nodes.empty(); }
+	const AStarOpenSet::Node &Top() const { return m_nodes.back(); }
+	void Pop() { m_nodes.pop_back(); }
+
+	void Push(const Vec2i &pos, int o, int costs, int costToGoal, int dist)
+	{
+		AStarOpenSet::Node node;
+		node.pos = pos;
+		node.O = o;
+		node.Costs = costs;
+		node.CostToGoal = costToGoal;
+		node.Dist = dist;
+
+		int bigi = 0;
+		int smalli = m_nodes.size();
+		while (bigi < smalli) {
+			const int midi = (smalli + bigi) >> 1;
+			if (IsOrdered(m_nodes[midi], node)) {
+				smalli = midi;
+			} else {
+				bigi = midi + 1;
+			}
+		}
+		m_nodes.insert(m_nodes.begin() + bigi, node);
+	}
+
+	int Find(int o) const
+	{
+		for (size_t i = 0; i != m_nodes.size(); ++i) {
+			if (m_nodes[i].O == o) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	void Decrease(unsigned int i, int costs, int costToGoal)
+	{
+		const AStarOpenSet::Node node = m_nodes[i];
+		m_nodes.erase(m_nodes.begin() + i);
+		Push(node.pos, node.O, costs, costToGoal, node.Dist);
+	}
+
+private:
+	static bool IsOrdered(const AStarOpenSet::Node &lhs, const AStarOpenSet::Node &rhs)
+	{
+		if (lhs.Costs != rhs.Costs) {
+			return lhs.Costs < rhs.Costs;
+		}
+		if (lhs.CostToGoal != rhs.CostToGoal) {
+			return lhs.CostToGoal < rhs.CostToGoal;
+		}
+		return lhs.Dist <= rhs.Dist;
+	}
+
+	std::vector<AStarOpenSet::Node> m_nodes;
+};
+
+/**
+**  Bare a* over an 8-connected grid of the map size, from the top left
+**  corner to the bottom right one, driven by the open set OPENSET.
+**
+**  @param blocked     Unpassable fields of the grid.
+**  @param expansions  Incremented by each expanded node.
+**
+**  @return            Cost of the path found, or -1.
+*/
+template <typename OPENSET>
+static int BenchmarkGridAStar(const std::vector<char> &blocked, long &expansions)
+{
+	const int xs[8] = {  0, +1, +1, +1, 0, -1, -1, -1 };
+	const int ys[8] = { -1, -1, 0, +1, +1, +1, 0, -1 };
+	const Vec2i goal(BenchmarkWidth - 1, BenchmarkHeight - 1);
+	std::vector<int> costFromStart(blocked.size(), 0);
+	OPENSET openSet;
+
+	openSet.Init(blocked.size());
+	costFromStart[0] = 1;
+	openSet.Push(Vec2i(0, 0), 0, 1 + std::max(goal.x, goal.y), std::max(goal.x, goal.y), goal.x + goal.y);
+	while (!openSet.Empty()) {
+		const AStarOpenSet::Node node = openSet.Top();
+		openSet.Pop();
+		++expansions;
+		if (node.pos == goal) {
+			return costFromStart[node.O];
+		}
+		for (int i = 0; i != 8; ++i) {
+			const Vec2i pos(node.pos.x + xs[i], node.pos.y + ys[i]);
+			if (pos.x < 0 || pos.x >= BenchmarkWidth || pos.y < 0 || pos.y >= BenchmarkHeight) {
+				continue;
+			}
+			const int o = pos.y * BenchmarkWidth + pos.x;
+			if (blocked[o]) {
+				continue;
+			}
+			const int newCost = costFromStart[node.O] + 1;
+			const int costToGoal = std::max(abs(goal.x - pos.x), abs(goal.y - pos.y));
+			const int dist = abs(goal.x - pos.x) + abs(goal.y - pos.y);
+			if (costFromStart[o] == 0) {
+				costFromStart[o] = newCost;
+				openSet.Push(pos, o, newCost + costToGoal, costToGoal, dist);
+			} else if (newCost < costFromStart[o]) {
+				costFromStart[o] = newCost;
+				const int j = openSet.Find(o);
+				if (j == -1) {
+					openSet.Push(pos, o, newCost + costToGoal, costToGoal, dist);
+				} else {
+					openSet.Decrease(j, newCost + costToGoal, costToGoal);
+				}
+			}
+		}
+	}
+	return -1;
+}
+
+/**
+**  Time BenchmarkSearches searches of BenchmarkGridAStar with an open set.
+*/
+template <typename OPENSET>
+static int BenchmarkOpenSet(const char *name, const std::vector<char> &blocked)
+{
+	long expansions = 0;
+	int cost = -1;
+	const double start = BenchmarkTime();
+
+	for (int i = 0; i < BenchmarkSearches; ++i) {
+		cost = BenchmarkGridAStar<OPENSET>(blocked, expansions);
+	}
+	const double time = BenchmarkTime() - start;
+
+	fprintf(stdout, "  A* %-12s %12.0f expansions/s (%ld expansions in %.2f ms)\n",
+			name, time > 0 ? expansions * 1000. / time : 0., expansions, time);
+	return cost;
+}
+
+/**
+**  Compare the a* open sets, the binary heap against the former sorted
+**  array, on a grid of the map size with the obstacles of the map and
+**  walls with gaps to make the search wander.
+*/
+static void BenchmarkOpenSets()
+{
+	std::vector<char> blocked(BenchmarkWidth * BenchmarkHeight, 0);
+
+	BenchmarkRandState = BenchmarkSeed;
+	for (size_t i = 0; i != blocked.size(); ++i) {
+		blocked[i] = (int)(BenchmarkRand() % 100) < BenchmarkObstacles;
+	}
+	for (int x = 16; x < BenchmarkWidth; x += 32) {
+		for (int y = 0; y != BenchmarkHeight; ++y) {
+			blocked[y * BenchmarkWidth + x] = y != ((x / 32) * 8) % BenchmarkHeight;
+		}
+	}
+	blocked[0] = 0;
+	blocked[blocked.size() - 1] = 0;
+
+	const int sortedCost = BenchmarkOpenSet<SortedArrayOpenSet>("sorted array", blocked);
+	const int heapCost = BenchmarkOpenSet<AStarOpenSet>("binary heap", blocked);
+	if (sortedCost != heapCost) {
+		fprintf(stdout, "  A* path costs differ: %d, %d\n", sortedCost, heapCost);
+	}
+}
+
+/**
+**  Time the save game in the background: the stall of the game thread in
+**  SaveGameAsync, then the time until the thread has written the file.
+*/
+static void BenchmarkSaveGameAsync()
+{
+	double start = BenchmarkTime();
+	const int ret = SaveGameAsync("benchmark.async.sav", NULL);
+	const double stallTime = BenchmarkTime() - start;
+
+	CheckAsyncSaveGame(true);
+	const double totalTime = BenchmarkTime() - start;
+
+	fprintf(stdout, "  SaveGameAsync  %8.2f ms game thread, %8.2f ms in all%s\n",
+			stallTime, totalTime, ret ? " (failed)" : "");
+}
+
+/**
+**  Time the save and the load of the game in a format.
+**
+**  The game is cleaned before loading, so it can't go on afterwards.
+**
+**  @param name    Name of the format.
+**  @param binary  Save the binary format, else a Lua script.
+*/
+static void BenchmarkSaveGame(const char *name, bool binary)
+{
+	const std::string filename = binary ? "benchmark.sav" : "benchmark.lua.sav";
+	const std::string path = Parameters::Instance.GetUserDirectory() + "/save/" + filename;
+	const unsigned int syncHash = SyncHash;
+
+	double start = BenchmarkTime();
+	const int ret = binary ? SaveGame(filename) : ExportSaveGame(filename);
+	const double saveTime = BenchmarkTime() - start;
+	struct stat st;
+	const long size = stat(path.c_str(), &st) == 0 ? long(st.st_size) : 0L;
+
+	CleanGame();
+	start = BenchmarkTime();
+	SaveGameLoading = true;
+	CleanPlayers();
+	LoadGame(path);
+	const double loadTime = BenchmarkTime() - start;
+
+	fprintf(stdout, "  SaveGame %-7s %8.2f ms (%ld bytes%s)\n", name, saveTime, size, ret ? ", failed" : "");
+	fprintf(stdout, "  LoadGame %-7s %8.2f ms%s\n", name, loadTime, SyncHash != syncHash ? " (SyncHash differs)" : "");
+}
+
+/**
+**  Time the replay log: log the commands of the player, 4 each cycle,
+**  until they are written to the log file.
+**
+**  @return  Time spent logging the commands in milliseconds.
+*/
+static double BenchmarkCommandLog()
+{
+	const unsigned long gameCycle = GameCycle;
+	const double start = BenchmarkTime();
+
+	for (int i = 0; i < BenchmarkCommands; ++i) {
+		GameCycle = gameCycle + i / 4;
+		CommandLog("move", NULL, FlushCommands, i % Map.Info.MapWidth, i % Map.Info.MapHeight, NULL, NULL, -1);
+	}
+	FlushReplayLog();
+	const double logTime = BenchmarkTime() - start;
+
+	GameCycle = gameCycle;
+	return logTime;
+}
+
+/**
+**  Give an order to a unit each cycle, as the player would.
+**
+**  Called where the input is handled, so the orders are logged like the
+**  ones of the user interface. The replays give the logged orders.
+*/
+static void BenchmarkOrders()
+{
+	if (IsReplayGame() || GameCycle == BenchmarkOrderCycle) {
+		return;
+	}
+	BenchmarkOrderCycle = GameCycle;
+
+	const unsigned int count = UnitManager.end() - UnitManager.begin();
+	if (count == 0) {
+		return;
+	}
+	CUnit &unit = *UnitManager.begin()[GameCycle % count];
+
+	if (!unit.IsAliveOnMap() || unit.Player->Index >= BenchmarkPlayers) {
+		return;
+	}
+	// Attack the target, then go back to the start, and so on.
+	const Vec2i &pos = (GameCycle / count) % 2 ? unit.Player->StartPos : BenchmarkTarget[unit.Player->Index];
+	SendCommandAttack(unit, pos, NoUnitP, FlushCommands);
+}
+
+/**
+**  Check that a replay started from a keyframe ends like the replay
+**  played from its start.
+**
+**  The keyframe is the last one of the game, so its cycle has orders.
+**
+**  @param smp  Presentation of the synthetic map.
+**
+**  @return     true if both replays end with the same SyncHash.
+*/
+static bool BenchmarkReplaySeek(const std::string &smp)
+{
+	const unsigned long seekCycle = (BenchmarkCycles - 1) / BenchmarkKeyframes * BenchmarkKeyframes;
+	char command[64];
+
+	snprintf(command, sizeof(command), "SetReplayKeyframeInterval(%lu)", BenchmarkKeyframes);
+	CclCommand(command);
+	InterfaceState = IfaceStateMenu;
+	GameCursor = UI.Point.Cursor;
+	HeadlessCycles = BenchmarkCycles;
+
+	HeadlessCycleCallback = BenchmarkOrders;
+	StartMap(smp, true);
+	HeadlessCycleCallback = NULL;
+	if (SaveReplay("benchmark.rpl") == -1) {
+		fprintf(stderr, "Can't save the replay\n");
+		return false;
+	}
+
+	StartReplay("~logs/benchmark.rpl", false);
+	const unsigned int straightHash = SyncHash;
+	const unsigned long straightCycle = GameCycle;
+	StartReplayAt("~logs/benchmark.rpl", seekCycle, false);
+	const unsigned int seekHash = SyncHash;
+	const unsigned long seekEndCycle = GameCycle;
+
+	const bool same = straightHash == seekHash && straightCycle == seekEndCycle;
+	fprintf(stdout, "Replay seek: %lu cycles, keyframes every %lu cycles\n", BenchmarkCycles, BenchmarkKeyframes);
+	fprintf(stdout, "  From the start   SyncHash %u at %lu\n", straightHash, straightCycle);
+	fprintf(stdout, "  From %-10lu  SyncHash %u at %lu\n", seekCycle, seekHash, seekEndCycle);
+	fprintf(stdout, "%s\n", same ? "OK" : "FAILED");
+	return same;
+}
+
+/**
+**  Print the benchmark usage.
+*/
+static void Usage(const char *name)
+{
+	fprintf(stderr,
+			"Usage: %s [OPTIONS]\n"
+			"\t-a searches\tCompare the a* open sets on searches\n"
+			"\t-b screens\tTime the blending kernels on screens\n"
+			"\t-c cycles\tGame cycles to run (default %lu)\n"
+			"\t-d datapath\tPath to the game data\n"
+			"\t-f frames\tFrames drawn with a full screen viewport (default %d)\n"
+			"\t-g WxH\t\tScreen size of the drawn frames\n"
+			"\t-h height\tMap height (default %d)\n"
+			"\t-k cycles\tCheck the replay seek with keyframes every cycles\n"
+			"\t-l\t\tTime the save and the load of the game\n"
+			"\t-o percent\tPercent of unpassable fields (default %d)\n"
+			"\t-p players\tNumber of players (default %d)\n"
+			"\t-q queries\tPath, sight and terrain queries each cycle (default %d)\n"
+			"\t-r commands\tTime the replay log of commands\n"
+			"\t-s seed\t\tSeed of the map generator\n"
+			"\t-t unittype\tIdent of the units (default %s)\n"
+			"\t-T tileset\tTileset script of the map (default %s)\n"
+			"\t-u units\tUnits of each player (default %d)\n"
+			"\t-w width\tMap width (default %d)\n",
+			name, BenchmarkCycles, BenchmarkFrames, BenchmarkHeight, BenchmarkObstacles, BenchmarkPlayers,
+			BenchmarkQueries, BenchmarkUnitType.c_str(), BenchmarkTileset.c_str(),
+			BenchmarkUnits, BenchmarkWidth);
+}
+
+/**
+**  Parse the benchmark options.
+**
+**  @return  true if the options are valid, false otherwise.
+*/
+static bool ParseBenchmarkOptions(int argc, char **argv)
+{
+	for (;;) {
+		switch (getopt(argc, argv, "a:b:c:d:f:g:h:k:lo:p:q:r:s:t:T:u:w:?")) {
+			case 'a':
+				BenchmarkSearches = atoi(optarg);
+				continue;
+			case 'b':
+				BenchmarkBlends = atoi(optarg);
+				continue;
+			case 'c':
+				BenchmarkCycles = strtoul(optarg, NULL, 0);
+				continue;
+			case 'd':
+				StratagusLibPath = optarg;
+				continue;
+			case 'f':
+				BenchmarkFrames = atoi(optarg);
+				continue;
+			case 'g':
+				if (sscanf(optarg, "%dx%d", &BenchmarkScreenWidth, &BenchmarkScreenHeight) != 2) {
+					return false;
+				}
+				continue;
+			case 'h':
+				BenchmarkHeight = atoi(optarg);
+				continue;
+			case 'k':
+				BenchmarkKeyframes = strtoul(optarg, NULL, 0);
+				continue;
+			case 'l':
+				BenchmarkSaveLoad = true;
+				continue;
+			case 'o':
+				BenchmarkObstacles = atoi(optarg);
+				continue;
+			case 'p':
+				BenchmarkPlayers = atoi(optarg);
+				continue;
+			case 'q':
+				BenchmarkQueries = atoi(optarg);
+				continue;
+			case 'r':
+				BenchmarkCommands = atoi(optarg);
+				continue;
+			case 's':
+				BenchmarkSeed = strtoul(optarg, NULL, 0);
+				continue;
+			case 't':
+				BenchmarkUnitType = optarg;
+				continue;
+			case 'T':
+				BenchmarkTileset = optarg;
+				continue;
+			case 'u':
+				BenchmarkUnits = atoi(optarg);
+				continue;
+			case 'w':
+				BenchmarkWidth = atoi(optarg);
+				continue;
+			case -1:
+				break;
+			case '?':
+			default:
+				return false;
+		}
+		break;
+	}
+	if (optind < argc) {
+		return false;
+	}
+	if (BenchmarkWidth < 32 || BenchmarkWidth > MaxMapWidth
+		|| BenchmarkHeight < 32 || BenchmarkHeight > MaxMapHeight) {
+		fprintf(stderr, "The map size must be from 32x32 to %dx%d\n", MaxMapWidth, MaxMapHeight);
+		return false;
+	}
+	if (BenchmarkPlayers < 1 || BenchmarkPlayers > PlayerMax - 1) {
+		fprintf(stderr, "The number of players must be from 1 to %d\n", PlayerMax - 1);
+		return false;
+	}
+	if (BenchmarkUnits < 0 || BenchmarkObstacles < 0 || BenchmarkObstacles > 100 || BenchmarkQueries < 0
+		|| BenchmarkFrames < 0 || BenchmarkCommands < 0 || BenchmarkBlends < 0 || BenchmarkSearches < 0
+		|| BenchmarkScreenWidth < 0 || BenchmarkScreenHeight < 0) {
+		return false;
+	}
+	if (BenchmarkKeyframes && BenchmarkKeyframes >= BenchmarkCycles) {
+		fprintf(stderr, "The keyframes must be closer than the game cycles\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	StratagusLibPath = ".";
+	Parameters &parameters = Parameters::Instance;
+	parameters.SetDefaultValues();
+	if (argc > 0) {
+		parameters.applicationName = argv[0];
+	}
+	if (!ParseBenchmarkOptions(argc, argv)) {
+		Usage(argv[0]);
+		return 1;
+	}
+	HeadlessMode = true;
+#if defined(USE_OPENGL) || defined(USE_GLES)
+	ForceUseOpenGL = 1;
+	UseOpenGL = 0;
+#endif
+	InitSyncRand();
+	makedir(parameters.GetUserDirectory().c_str(), 0777);
+
+	InitLua();
+	LuaRegisterModules();
+	lua_register(Lua, "BenchmarkSetupMap", CclBenchmarkSetupMap);
+	InitAiModule();
+	LoadCcl(parameters.luaStartFilename);
+
+	if (BenchmarkScreenWidth && BenchmarkScreenHeight) {
+		Video.Width = BenchmarkScreenWidth;
+		Video.Height = BenchmarkScreenHeight;
+	}
+	InitVideo();
+	LoadFonts();
+	UnitManager.Init();
+	PreMenuSetup();
+	initGuichan();
+
+	const std::string smp = parameters.GetUserDirectory() + "/benchmark.smp";
+	if (!WriteBenchmarkMap(smp)) {
+		return 1;
+	}
+	if (BenchmarkKeyframes) {
+		Exit(BenchmarkReplaySeek(smp) ? 0 : 1);
+	}
+	CleanPlayers();
+	CreateGame(smp, &Map);
+
+	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
+		CUnit &unit = **it;
+
+		CommandAttack(unit, BenchmarkTarget[unit.Player->Index], NULL, FlushCommands);
+	}
+
+	const int units = UnitManager.end() - UnitManager.begin();
+	double unitTime = 0;
+	double missileTime = 0;
+	double playerTime = 0;
+	double pathTime = 0;
+	double sightTime = 0;
+	double terrainTime = 0;
+
+	for (unsigned long i = 0; i < BenchmarkCycles; ++i) {
+		++GameCycle;
+
+		double start = BenchmarkTime();
+		UnitActions();
+		double end = BenchmarkTime();
+		unitTime += end - start;
+
+		start = end;
+		MissileActions();
+		end = BenchmarkTime();
+		missileTime += end - start;
+
+		start = end;
+		PlayersEachCycle();
+		end = BenchmarkTime();
+		playerTime += end - start;
+
+		start = end;
+		BenchmarkPathQueries(i * BenchmarkQueries);
+		end = BenchmarkTime();
+		pathTime += end - start;
+
+		start = end;
+		BenchmarkSightQueries(i * BenchmarkQueries);
+		end = BenchmarkTime();
+		sightTime += end - start;
+
+		start = end;
+		BenchmarkTerrainQueries(i * BenchmarkQueries);
+		end = BenchmarkTime();
+		terrainTime += end - start;
+	}
+
+	const double drawTime = BenchmarkDraw();
+	const double cycles = BenchmarkCycles ? BenchmarkCycles : 1;
+	fprintf(stdout, "Benchmark: %dx%d map, %d players, %d units, %lu cycles\n",
+			BenchmarkWidth, BenchmarkHeight, BenchmarkPlayers, units, BenchmarkCycles);
+	fprintf(stdout, "  UnitActions      %8.4f ms/cycle\n", unitTime / cycles);
+	fprintf(stdout, "  MissileActions   %8.4f ms/cycle\n", missileTime / cycles);
+	fprintf(stdout, "  PlayersEachCycle %8.4f ms/cycle\n", playerTime / cycles);
+	fprintf(stdout, "  AStarFindPath    %8.4f ms/cycle (%d queries)\n", pathTime / cycles, BenchmarkQueries);
+	fprintf(stdout, "  MapSight         %8.4f ms/cycle (%d queries)\n", sightTime / cycles, BenchmarkQueries);
+	fprintf(stdout, "  FindTerrainType  %8.4f ms/cycle (%d queries)\n", terrainTime / cycles, BenchmarkQueries);
+	fprintf(stdout, "  Simulation       %8.4f ms/cycle\n", (unitTime + missileTime + playerTime) / cycles);
+	if (BenchmarkFrames) {
+		fprintf(stdout, "  CViewport::Draw  %8.4f ms/frame (%dx%d, %d frames)\n",
+				drawTime / BenchmarkFrames, Video.Width, Video.Height, BenchmarkFrames);
+	}
+	if (BenchmarkBlends) {
+		BenchmarkBlendKernels();
+	}
+	if (BenchmarkSearches) {
+		BenchmarkOpenSets();
+	}
+	if (BenchmarkCommands) {
+		const double logTime = BenchmarkCommandLog();
+
+		fprintf(stdout, "  CommandLog       %8.4f ms/1000 commands (%d commands)\n",
+				logTime * 1000 / BenchmarkCommands, BenchmarkCommands);
+	}
+	fprintf(stdout, "SyncHash %u\n", SyncHash);
+	if (BenchmarkSaveLoad) {
+		BenchmarkSaveGameAsync();
+		// Each load replaces the game by the saved one, which is the same.
+		BenchmarkSaveGame("binary", true);
+		BenchmarkSaveGame("script", false);
+	}
+
+	Exit(0);
+	return 0;
+}
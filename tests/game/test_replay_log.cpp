@@ -0,0 +1,128 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_replay_log.cpp - The test file for the replay command log. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "replay.h"
+
+#include "iocompat.h"
+#include "parameters.h"
+#include "player.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+
+/**
+**  Make a new empty directory in the temporary directory.
+**
+**  @return  Path of the directory, empty if it can't be made.
+*/
+std::string MakeTemporaryDirectory()
+{
+#ifdef USE_WIN32
+	char *name = _tempnam(NULL, "stratagus");
+	const std::string path = name ? name : "";
+
+	free(name);
+	if (path.empty() || makedir(path.c_str(), 0777) != 0) {
+		return "";
+	}
+	return path;
+#else
+	const char *tmpdir = getenv("TMPDIR");
+	std::string path = tmpdir && *tmpdir ? tmpdir : "/tmp";
+
+	path += "/stratagus-XXXXXX";
+	std::vector<char> name(path.begin(), path.end());
+	name.push_back('\0');
+	return mkdtemp(&name[0]) ? &name[0] : "";
+#endif
+}
+
+/**
+**  Count the Log lines of the command log of player 0, and remove it.
+**
+**  @param directory  User directory of the log.
+**  @param lastCycle  Set to the GameCycle of the last Log line.
+*/
+int CountLoggedCommands(const std::string &directory, unsigned long *lastCycle)
+{
+	const std::string path = directory + "/logs/log_of_stratagus_0.log";
+	FILE *fd = fopen(path.c_str(), "r");
+	if (fd == NULL) {
+		return -1;
+	}
+	char line[256];
+	int count = 0;
+	while (fgets(line, sizeof(line), fd)) {
+		if (!strncmp(line, "Log( {", 6)) {
+			++count;
+			sscanf(line, "Log( { GameCycle = %lu", lastCycle);
+		}
+	}
+	fclose(fd);
+	remove(path.c_str());
+	rmdir((directory + "/logs").c_str());
+	return count;
+}
+
+}
+
+TEST(REPLAY_LOG_COMMANDS)
+{
+	// Enough commands to write the log buffer several times
+	const int commandCount = 2000;
+	const std::string directory = MakeTemporaryDirectory();
+	const std::string userDirectory = Parameters::Instance.GetUserDirectory();
+	unsigned long lastCycle = 0;
+
+	CHECK(!directory.empty());
+	Parameters::Instance.SetUserDirectory(directory);
+	ThisPlayer = &Players[0];
+	CleanReplayLog();
+
+	for (int i = 0; i < commandCount; ++i) {
+		GameCycle = i / 4;
+		CommandLog("move", NULL, 1, i % 128, i % 96, NULL, NULL, -1);
+	}
+	EndReplayLog();
+	CleanReplayLog();
+
+	CHECK_EQUAL(commandCount, CountLoggedCommands(directory, &lastCycle));
+	CHECK_EQUAL((unsigned long)(commandCount - 1) / 4, lastCycle);
+	rmdir(directory.c_str());
+	Parameters::Instance.SetUserDirectory(userDirectory);
+	GameCycle = 0;
+	ThisPlayer = NULL;
+}
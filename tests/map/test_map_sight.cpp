@@ -0,0 +1,166 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_map_sight.cpp - The test file for the sight planes. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "map.h"
+#include "player.h"
+#include "tile.h"
+
+namespace
+{
+
+const int MapWidth = 64;
+const int MapHeight = 64;
+
+/// Times each field was given to CountField
+std::vector<int> MarkedFields;
+
+void CountField(const CPlayer &, const unsigned int index)
+{
+	++MarkedFields[index];
+}
+
+/**
+**  An empty map of MapWidth x MapHeight fields for the duration of a test.
+*/
+struct TestMap {
+	TestMap()
+	{
+		Map.Info.MapWidth = MapWidth;
+		Map.Info.MapHeight = MapHeight;
+		Map.Create();
+		MarkedFields.assign(MapWidth * MapHeight, 0);
+		Player.Index = 0;
+	}
+
+	~TestMap()
+	{
+		delete[] Map.Fields;
+		Map.Fields = NULL;
+		Map.Sight.Clean();
+		Map.UnitBuckets.Clear();
+		Map.Info.MapWidth = Map.Info.MapHeight = 0;
+	}
+
+	CPlayer Player;
+};
+
+/**
+**  Check if a 1x1 unit sees a field.
+**
+**  The rows below the unit have the width of the row above them, as the
+**  sight always had.
+*/
+bool IsInSight(const Vec2i &pos, int range, int x, int y)
+{
+	const int dy = y > pos.y ? y - pos.y - 1 : pos.y - y;
+
+	return y <= pos.y + range && square(x - pos.x) + square(dy) < square(range + 1);
+}
+
+}
+
+TEST(MAP_SIGHT_ROWS)
+{
+	CMapSightPlanes planes;
+
+	planes.Visible[0].assign(8, 2);
+	planes.Visible[0][5] = 1;
+
+	// A row with an unseen field is left to the field markers.
+	CHECK(!planes.MarkSeenRow(0, 2, 6));
+	CHECK_EQUAL(2, planes.Visible[0][2]);
+	CHECK(planes.MarkSeenRow(0, 0, 5));
+	CHECK_EQUAL(3, planes.Visible[0][4]);
+	CHECK_EQUAL(1, planes.Visible[0][5]);
+
+	// Fields going back to fog are left to the field unmarkers.
+	CHECK(!planes.UnmarkSeenRow(0, 3, 3));
+	CHECK(planes.UnmarkSeenRow(0, 0, 5));
+	CHECK_EQUAL(2, planes.Visible[0][0]);
+}
+
+TEST(MAP_SIGHT_CIRCLE)
+{
+	TestMap testMap;
+
+	// In the middle, then clipped by the corners of the map
+	const Vec2i positions[3] = { Vec2i(30, 30), Vec2i(0, 0), Vec2i(MapWidth - 2, MapHeight - 1) };
+	for (int i = 0; i != 3; ++i) {
+		MarkedFields.assign(MapWidth * MapHeight, 0);
+		MapSight(testMap.Player, positions[i], 1, 1, 6, CountField);
+		for (int y = 0; y != MapHeight; ++y) {
+			for (int x = 0; x != MapWidth; ++x) {
+				CHECK_EQUAL(IsInSight(positions[i], 6, x, y) ? 1 : 0, MarkedFields[y * MapWidth + x]);
+			}
+		}
+	}
+}
+
+TEST(MAP_SIGHT_SEEN_ROWS)
+{
+	TestMap testMap;
+	const Vec2i pos(20, 25);
+
+	// The whole map is already seen, the sight only moves the counters.
+	Map.Sight.Visible[0].assign(MapWidth * MapHeight, 2);
+	MapSight(testMap.Player, pos, 2, 2, 5, CountField);
+	MapSight(testMap.Player, pos, 2, 2, 5, MapMarkTileSight);
+	for (int i = 0; i != MapWidth * MapHeight; ++i) {
+		CHECK_EQUAL(2 + MarkedFields[i], Map.Sight.Visible[0][i]);
+	}
+	MapSight(testMap.Player, pos, 2, 2, 5, MapUnmarkTileSight);
+	for (int i = 0; i != MapWidth * MapHeight; ++i) {
+		CHECK_EQUAL(2, Map.Sight.Visible[0][i]);
+	}
+}
+
+TEST(MAP_SIGHT_DELTA)
+{
+	TestMap testMap;
+	const Vec2i pos(30, 30);
+	const Vec2i otherPos(33, 29);
+
+	// The fields in the sight at pos but not at otherPos
+	MapSight(testMap.Player, pos, 1, 1, 7, CountField);
+	std::vector<int> expected(MarkedFields);
+	for (int y = 0; y != MapHeight; ++y) {
+		for (int x = 0; x != MapWidth; ++x) {
+			if (IsInSight(otherPos, 7, x, y)) {
+				expected[y * MapWidth + x] = 0;
+			}
+		}
+	}
+	MarkedFields.assign(MapWidth * MapHeight, 0);
+	MapSightDelta(testMap.Player, pos, otherPos, 1, 1, 7, CountField);
+	CHECK(expected == MarkedFields);
+}
@@ -63,18 +63,20 @@ void FillCustomValue(CNetworkCommandQuit *obj)
 {
 	obj->player = 0x0123;
 }
-void FillCustomValue(CNetworkSelection *obj)
+void FillCustomValue(CNetworkCommandGroup *obj)
 {
-	for (int i = 0; i != 10; ++i) {
+	obj->Type = MessageCommandMove | 0x80;
+	obj->X = 0x1234;
+	obj->Y = 0x5678;
+	obj->Dest = 0xFFFF;
+	for (int i = 0; i != 50; ++i) {
 		obj->Units.push_back(0x0123 * i);
 	}
 }
-
-void FillCustomValue(CNetworkPacketHeader *obj)
+void FillCustomValue(CNetworkSelection *obj)
 {
-	obj->Cycle = 42;
-	for (int i = 0; i != MaxNetworkCommands; ++i) {
-		obj->Type[i] = 0x05 + i * 0x12;
+	for (int i = 0; i != 10; ++i) {
+		obj->Units.push_back(0x0123 * i);
 	}
 }
 
@@ -89,6 +91,12 @@ bool Comp(const CNetworkChat &lhs, const CNetworkChat &rhs)
 	return lhs.Text == rhs.Text;
 }
 
+bool Comp(const CNetworkCommandGroup &lhs, const CNetworkCommandGroup &rhs)
+{
+	return lhs.Type == rhs.Type && lhs.X == rhs.X && lhs.Y == rhs.Y
+		   && lhs.Dest == rhs.Dest && lhs.Units == rhs.Units;
+}
+
 bool Comp(const CNetworkSelection &lhs, const CNetworkSelection &rhs)
 {
 	return lhs.Units == rhs.Units;
@@ -131,13 +139,83 @@ TEST(CNetworkCommandQuit)
 {
 	CHECK(CheckSerialization<CNetworkCommandQuit>());
 }
+TEST(CNetworkCommandGroup)
+{
+	CHECK(CheckSerialization<CNetworkCommandGroup>());
+}
+TEST(CNetworkCommandGroup_Contains)
+{
+	CNetworkCommandGroup group;
+	FillCustomValue(&group);
+
+	CNetworkCommand nc;
+	nc.Unit = group.Units[7];
+	nc.X = group.X;
+	nc.Y = group.Y;
+	nc.Dest = group.Dest;
+	CHECK(group.Contains(group.Type, nc));
+	CHECK(!group.Contains(group.Type & 0x7F, nc));
+	CHECK(!group.Contains(MessageCommandAttack | 0x80, nc));
+	nc.Unit = 0x0123 * 50;
+	CHECK(!group.Contains(group.Type, nc));
+	nc.Unit = group.Units[7];
+	nc.Y = group.Y + 1;
+	CHECK(!group.Contains(group.Type, nc));
+	CHECK(!IsNetworkUnitCommand(MessageCommandGroup));
+}
 TEST(CNetworkSelection)
 {
 	CHECK(CheckSerialization<CNetworkSelection>());
 }
 TEST(CNetworkPacketHeader)
 {
-	CHECK(CheckSerialization<CNetworkPacketHeader>());
+	CNetworkPacketHeader header1;
+	header1.Cycle = 42;
+	header1.OrigPlayer = 3;
+	for (int i = 0; i != 20; ++i) {
+		header1.Type.push_back(0x05 + i * 0x05);
+	}
+	std::vector<unsigned char> buffer(header1.Size());
+	CHECK_EQUAL(header1.Size(), header1.Serialize(&buffer[0]));
+
+	CNetworkPacketHeader header2;
+	CHECK_EQUAL(buffer.size(), header2.Deserialize(&buffer[0], buffer.size()));
+	CHECK(header1.Type == header2.Type);
+	CHECK_EQUAL(42, header2.Cycle);
+	CHECK_EQUAL(3, header2.OrigPlayer);
+	CHECK_EQUAL(0u, header2.Deserialize(&buffer[0], buffer.size() - 1));
+}
+
+TEST(CNetworkPacket)
+{
+	CNetworkPacket packet1;
+	packet1.Header.Cycle = 7;
+	for (int i = 0; i != 100; ++i) {
+		CNetworkCommand nc;
+		nc.Unit = 0x0100 + i * 3;
+		nc.X = (i & 1) ? 0 : 0xFFFF - i;
+		nc.Y = 12 - i;
+		nc.Dest = (i & 2) ? 0xFFFF : i;
+		std::vector<unsigned char> command(nc.Size());
+		nc.Serialize(&command[0]);
+		packet1.Add(MessageCommandMove | ((i & 4) ? 0x80 : 0), command);
+	}
+	CNetworkChat chat;
+	chat.Text = "hello";
+	std::vector<unsigned char> command(chat.Size());
+	chat.Serialize(&command[0]);
+	packet1.Add(MessageChat, command);
+	packet1.Add(MessageResend, std::vector<unsigned char>());
+
+	std::vector<unsigned char> buffer(packet1.Size());
+	CHECK_EQUAL(buffer.size(), packet1.Serialize(&buffer[0]));
+	// Delta encoding is far smaller than the commands
+	CHECK(buffer.size() < 100 * CNetworkCommand::Size());
+
+	CNetworkPacket packet2;
+	CHECK(packet2.Deserialize(&buffer[0], buffer.size()));
+	CHECK(packet1.Header.Type == packet2.Header.Type);
+	CHECK(packet1.Command == packet2.Command);
+	CHECK(!packet2.Deserialize(&buffer[0], buffer.size() - 1));
 }
-//TEST(CNetworkPacket)
 
@@ -0,0 +1,110 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_astar_openset.cpp - The test file for astar_openset.h. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "astar_openset.h"
+
+namespace
+{
+
+bool IsOrdered(const AStarOpenSet::Node &lhs, const AStarOpenSet::Node &rhs)
+{
+	if (lhs.Costs != rhs.Costs) {
+		return lhs.Costs < rhs.Costs;
+	}
+	if (lhs.CostToGoal != rhs.CostToGoal) {
+		return lhs.CostToGoal < rhs.CostToGoal;
+	}
+	return lhs.Dist <= rhs.Dist;
+}
+
+}
+
+TEST(ASTAR_OPENSET_ORDER)
+{
+	AStarOpenSet openSet;
+
+	// Costs in a scrambled order, with many ties to check the tie breaks
+	openSet.Init(1000);
+	for (int i = 0; i != 1000; ++i) {
+		openSet.Push(Vec2i(i % 100, i / 100), i, (i * 37) % 64, (i * 11) % 8, (i * 13) % 7);
+	}
+	AStarOpenSet::Node previous = openSet.Top();
+	openSet.Pop();
+	while (!openSet.Empty()) {
+		CHECK(IsOrdered(previous, openSet.Top()));
+		previous = openSet.Top();
+		openSet.Pop();
+	}
+}
+
+TEST(ASTAR_OPENSET_DECREASE)
+{
+	AStarOpenSet openSet;
+
+	openSet.Init(10);
+	openSet.Push(Vec2i(0, 0), 0, 10, 5, 5);
+	openSet.Push(Vec2i(1, 0), 1, 12, 5, 5);
+	openSet.Push(Vec2i(2, 0), 2, 14, 5, 5);
+	CHECK_EQUAL(-1, openSet.Find(3));
+
+	const int pos = openSet.Find(2);
+	CHECK(pos != -1);
+	openSet.Decrease(pos, 8, 5);
+	CHECK_EQUAL(2, openSet.Top().O);
+	CHECK_EQUAL(8, openSet.Top().Costs);
+
+	openSet.Pop();
+	CHECK_EQUAL(-1, openSet.Find(2));
+	CHECK_EQUAL(0, openSet.Top().O);
+	CHECK_EQUAL(2u, openSet.Size());
+}
+
+TEST(ASTAR_OPENSET_DECREASE_REORDERS)
+{
+	AStarOpenSet openSet;
+
+	// A cheaper path to an open node must be expanded before the nodes it
+	// now beats, not at the position of its old costs.
+	openSet.Init(10);
+	openSet.Push(Vec2i(0, 0), 0, 20, 4, 4);
+	openSet.Push(Vec2i(1, 0), 1, 30, 4, 4);
+	openSet.Push(Vec2i(2, 0), 2, 40, 4, 4);
+	openSet.Push(Vec2i(3, 0), 3, 50, 4, 4);
+	openSet.Decrease(openSet.Find(3), 25, 4);
+
+	CHECK_EQUAL(0, openSet.Top().O);
+	openSet.Pop();
+	CHECK_EQUAL(3, openSet.Top().O);
+	CHECK_EQUAL(25, openSet.Top().Costs);
+	openSet.Pop();
+	CHECK_EQUAL(1, openSet.Top().O);
+}
@@ -0,0 +1,128 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_terrain_traversal.cpp - The test file for TerrainTraversal. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "pathfinder.h"
+
+namespace
+{
+
+const int MapWidth = 256;
+const int MapHeight = 256;
+
+/**
+**  Visit the fields up to a distance, and count them.
+*/
+class RangeCounter
+{
+public:
+	explicit RangeCounter(int maxDist) : maxDist(maxDist), count(0) {}
+
+	VisitResult Visit(TerrainTraversal &terrainTraversal, const Vec2i &pos, const Vec2i &)
+	{
+		++count;
+		return terrainTraversal.Get(pos) <= maxDist ? VisitResult_Ok : VisitResult_DeadEnd;
+	}
+
+	int maxDist;
+	int count;
+};
+
+int CountRange(const Vec2i &start, int maxDist)
+{
+	TerrainTraversal terrainTraversal;
+	RangeCounter counter(maxDist);
+
+	terrainTraversal.SetSize(MapWidth, MapHeight);
+	terrainTraversal.Init();
+	terrainTraversal.PushPos(start);
+	terrainTraversal.Run(counter);
+	return counter.count;
+}
+
+}
+
+TEST(TERRAIN_TRAVERSAL_RANGE)
+{
+	// 7x7 fields up to 3 fields from the start
+	CHECK_EQUAL(49, CountRange(Vec2i(100, 100), 3));
+	// The border stops the traversal in the corner
+	CHECK_EQUAL(16, CountRange(Vec2i(0, 0), 3));
+	CHECK_EQUAL(16, CountRange(Vec2i(MapWidth - 1, MapHeight - 1), 3));
+}
+
+TEST(TERRAIN_TRAVERSAL_INIT)
+{
+	TerrainTraversal terrainTraversal;
+	RangeCounter counter(2);
+
+	terrainTraversal.SetSize(MapWidth, MapHeight);
+	terrainTraversal.Init();
+	terrainTraversal.PushPos(Vec2i(10, 10));
+	terrainTraversal.Run(counter);
+	CHECK(terrainTraversal.IsReached(Vec2i(10, 10)));
+	CHECK(terrainTraversal.IsVisited(Vec2i(12, 12)));
+
+	// The previous traversal is forgotten, the border is kept
+	terrainTraversal.Init();
+	CHECK(!terrainTraversal.IsVisited(Vec2i(10, 10)));
+	CHECK(!terrainTraversal.IsVisited(Vec2i(12, 12)));
+	CHECK_EQUAL(-1, terrainTraversal.Get(Vec2i(-1, 5)));
+	CHECK_EQUAL(-1, terrainTraversal.Get(Vec2i(MapWidth, MapHeight)));
+
+	// Many generations, through the clear of the fields
+	for (int i = 0; i != 70000; ++i) {
+		terrainTraversal.Init();
+		terrainTraversal.PushPos(Vec2i(i % MapWidth, 20));
+		CHECK_EQUAL(1, terrainTraversal.Get(Vec2i(i % MapWidth, 20)));
+		if (i % MapWidth != 0) {
+			CHECK_EQUAL(0, terrainTraversal.Get(Vec2i(i % MapWidth - 1, 20)));
+		}
+	}
+}
+
+TEST(TERRAIN_TRAVERSAL_REUSE)
+{
+	// The searches of the workers reuse the traversal, each must see a
+	// map as clear as a new traversal.
+	TerrainTraversal terrainTraversal;
+
+	terrainTraversal.SetSize(MapWidth, MapHeight);
+	for (int i = 0; i != 1000; ++i) {
+		const Vec2i start(i % MapWidth, (i * 7) % MapHeight);
+		RangeCounter counter(3);
+
+		terrainTraversal.Init();
+		terrainTraversal.PushPos(start);
+		terrainTraversal.Run(counter);
+		CHECK_EQUAL(CountRange(start, 3), counter.count);
+	}
+}
@@ -0,0 +1,167 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_unit_buckets.cpp - The test file for the unit cache buckets. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "map.h"
+#include "player.h"
+#include "unit.h"
+#include "unit_cache.h"
+#include "unit_find.h"
+#include "unittype.h"
+
+#include <algorithm>
+
+namespace
+{
+
+const int MapWidth = 100;
+const int MapHeight = 100;
+
+/// Units of the players of a bitmask
+class HasPlayerInMask
+{
+public:
+	explicit HasPlayerInMask(unsigned int mask) : mask(mask) {}
+	bool operator()(const CUnit *unit) const { return (mask >> unit->Player->Index) & 1; }
+private:
+	unsigned int mask;
+};
+
+/// Check if a unit has a tile in a rectangle
+bool IsInRectangle(const CUnit &unit, const Vec2i &ltPos, const Vec2i &rbPos)
+{
+	return unit.tilePos.x <= rbPos.x && unit.tilePos.x + unit.Type->TileWidth > ltPos.x
+		   && unit.tilePos.y <= rbPos.y && unit.tilePos.y + unit.Type->TileHeight > ltPos.y;
+}
+
+/**
+**  Check that SelectFixed finds the units of the players of mask which
+**  are in a rectangle, looking at all the units.
+*/
+bool SelectsAll(const std::vector<CUnit *> &units, const Vec2i &ltPos, const Vec2i &rbPos, unsigned int mask)
+{
+	std::vector<CUnit *> expected;
+	std::vector<CUnit *> found;
+
+	for (size_t i = 0; i != units.size(); ++i) {
+		if (!units[i]->Removed && HasPlayerInMask(mask)(units[i]) && IsInRectangle(*units[i], ltPos, rbPos)) {
+			expected.push_back(units[i]);
+		}
+	}
+	SelectFixed(ltPos, rbPos, found, HasPlayerInMask(mask), mask);
+	std::sort(expected.begin(), expected.end());
+	std::sort(found.begin(), found.end());
+	return expected == found;
+}
+
+}
+
+TEST(UNIT_BUCKETS_MASK)
+{
+	CUnitBuckets buckets;
+
+	buckets.Init(20, 20);
+	CHECK_EQUAL(0u, buckets.GetPlayerMask(Vec2i(0, 0)));
+
+	// A 2x2 unit across four buckets
+	buckets.Insert(Vec2i(7, 7), Vec2i(2, 2), 3);
+	buckets.Insert(Vec2i(1, 1), Vec2i(1, 1), 3);
+	CHECK_EQUAL(1u << 3, buckets.GetPlayerMask(Vec2i(0, 0)));
+	CHECK_EQUAL(1u << 3, buckets.GetPlayerMask(Vec2i(8, 0)));
+	CHECK_EQUAL(1u << 3, buckets.GetPlayerMask(Vec2i(15, 15)));
+	CHECK_EQUAL(0u, buckets.GetPlayerMask(Vec2i(16, 16)));
+
+	buckets.Remove(Vec2i(7, 7), Vec2i(2, 2), 3);
+	CHECK_EQUAL(1u << 3, buckets.GetPlayerMask(Vec2i(7, 7)));
+	CHECK_EQUAL(0u, buckets.GetPlayerMask(Vec2i(8, 8)));
+	buckets.Remove(Vec2i(1, 1), Vec2i(1, 1), 3);
+	CHECK_EQUAL(0u, buckets.GetPlayerMask(Vec2i(7, 7)));
+
+	CHECK_EQUAL(7, CUnitBuckets::GetBucketLastX(0));
+	CHECK_EQUAL(15, CUnitBuckets::GetBucketLastX(8));
+}
+
+TEST(UNIT_BUCKETS_SELECT)
+{
+	CUnitType smallType;
+	CUnitType bigType;
+	CPlayer players[4];
+	std::vector<CUnit *> units;
+
+	smallType.TileWidth = smallType.TileHeight = 1;
+	bigType.TileWidth = bigType.TileHeight = 2;
+	for (int i = 0; i != 4; ++i) {
+		players[i].Index = i;
+	}
+	Map.Info.MapWidth = MapWidth;
+	Map.Info.MapHeight = MapHeight;
+	Map.Create();
+
+	// Two armies in their corner, and a few units scattered on the map,
+	// some across the borders of the buckets and of the map
+	for (int i = 0; i != 300; ++i) {
+		CUnit *unit = new CUnit;
+		const Vec2i base = i % 2 ? Vec2i(70, 75) : Vec2i(10, 5);
+
+		unit->Type = i % 5 ? &smallType : &bigType;
+		unit->Player = &players[i < 280 ? i % 2 : 2 + i % 2];
+		unit->tilePos = i < 280 ? base + Vec2i((i * 7) % 20, (i * 13) % 20) : Vec2i((i * 37) % MapWidth, (i * 53) % MapHeight);
+		unit->Offset = Map.getIndex(unit->tilePos);
+		Map.Insert(*unit);
+		units.push_back(unit);
+	}
+
+	const Vec2i ltPos[4] = { Vec2i(0, 0), Vec2i(7, 7), Vec2i(60, 70), Vec2i(30, 0) };
+	const Vec2i rbPos[4] = { Vec2i(MapWidth - 1, MapHeight - 1), Vec2i(24, 16), Vec2i(99, 99), Vec2i(40, 99) };
+	for (int r = 0; r != 4; ++r) {
+		for (unsigned int mask = 1; mask != 16; ++mask) {
+			CHECK(SelectsAll(units, ltPos[r], rbPos[r], mask));
+		}
+	}
+
+	// The buckets follow the units leaving the map
+	for (size_t i = 0; i < units.size(); i += 3) {
+		Map.Remove(*units[i]);
+		units[i]->Removed = 1;
+	}
+	for (int r = 0; r != 4; ++r) {
+		CHECK(SelectsAll(units, ltPos[r], rbPos[r], 0xF));
+	}
+
+	for (size_t i = 0; i != units.size(); ++i) {
+		delete units[i];
+	}
+	delete[] Map.Fields;
+	Map.Fields = NULL;
+	Map.Sight.Clean();
+	Map.UnitBuckets.Clear();
+	Map.Info.MapWidth = Map.Info.MapHeight = 0;
+}
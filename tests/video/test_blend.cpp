@@ -0,0 +1,108 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_blend.cpp - The test file for blend.cpp. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "blend.h"
+
+#include "util.h"
+
+namespace
+{
+
+Uint32 RandomPixel()
+{
+	return (Uint32(SyncRand()) << 16) ^ SyncRand();
+}
+
+/// Alpha of the spans, the ends of the range included
+unsigned char RandomAlpha()
+{
+	switch (SyncRand(8)) {
+		case 0: return 0;
+		case 1: return 255;
+		default: return SyncRand(256);
+	}
+}
+
+}
+
+TEST(BLEND_PIXEL)
+{
+	Uint32 pixel32 = 0x00FF8000;
+	BlendPixel32(&pixel32, 0x000000FF, 255);
+	CHECK_EQUAL(0x000000FFu, pixel32);
+
+	Uint16 pixel16 = 0xF800;
+	BlendPixel16(&pixel16, 0x001F, 255);
+	CHECK_EQUAL(0x001F, pixel16);
+}
+
+TEST(BLEND_KERNELS_EXACT)
+{
+	const std::vector<BlendKernels> kernels = GetBlendKernels();
+
+	CHECK(!kernels.empty());
+	InitSyncRand();
+	for (int run = 0; run != 500; ++run) {
+		// Odd widths and offsets to hit the misaligned heads and the tails
+		const int width = SyncRand(100);
+		const int offset = SyncRand(4);
+		const Uint32 color = RandomPixel();
+		const unsigned char alpha = RandomAlpha();
+		std::vector<Uint16> source16(width + offset);
+		std::vector<Uint32> source32(width + offset);
+
+		for (int i = 0; i != width + offset; ++i) {
+			source32[i] = RandomPixel();
+			source16[i] = Uint16(source32[i]);
+		}
+		std::vector<Uint16> expected16(source16);
+		std::vector<Uint32> expected32(source32);
+		for (int i = offset; i != width + offset; ++i) {
+			BlendPixel16(&expected16[i], color & 0xFFFF, alpha);
+			BlendPixel32(&expected32[i], color, alpha);
+		}
+		for (size_t k = 0; k != kernels.size(); ++k) {
+			std::vector<Uint16> pixels16(source16);
+			std::vector<Uint32> pixels32(source32);
+
+			// Guard the empty spans, &v[0] is invalid for an empty vector
+			pixels16.push_back(0);
+			pixels32.push_back(0);
+			kernels[k].Span16(&pixels16[offset], width, color & 0xFFFF, alpha);
+			kernels[k].Span32(&pixels32[offset], width, color, alpha);
+			pixels16.pop_back();
+			pixels32.pop_back();
+			CHECK(pixels16 == expected16);
+			CHECK(pixels32 == expected32);
+		}
+	}
+}